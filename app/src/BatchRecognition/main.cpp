@@ -0,0 +1,55 @@
+#include "batchrecognizer.h"
+#include "stageprofiler.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || argc > 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <images directory> [annotated images directory]" << std::endl;
+		return 1;
+	}
+
+	std::error_code error;
+	if (!std::filesystem::is_directory(argv[1], error))
+	{
+		std::cerr << "Not a directory: " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::vector<std::string> imagePaths;
+	for (const auto& entry : std::filesystem::directory_iterator(argv[1]))
+	{
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		if (entry.is_regular_file() && (extension == ".jpg" || extension == ".jpeg" || extension == ".png"))
+			imagePaths.push_back(entry.path().string());
+	}
+	std::sort(imagePaths.begin(), imagePaths.end());
+
+	std::string saveDirectory = argc == 3 ? argv[2] : "";
+
+	BatchRecognizer recognizer;
+	BatchReport report;
+	std::vector<PlateResult> results = recognizer.recognize(imagePaths, saveDirectory, report);
+
+	for (size_t i = 0; i < results.size(); i++)
+		std::cout << std::filesystem::path(imagePaths[i]).filename().string() << "\t" << results[i].plate << "\t" << results[i].confidence << std::endl;
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::endl << report.recognized << " of " << report.images << " plates recognized in " << report.seconds << " s ("
+		<< report.imagesPerSecond << " images/s)" << std::endl;
+
+	for (const StageUtilization& stage : report.stages)
+		std::cout << std::left << std::setw(16) << stage.stage << stage.workers << " workers, " << stage.busySeconds << " s busy, "
+		<< stage.utilization * 100 << "% utilization" << std::endl;
+
+	std::cout << std::endl << StageProfiler::getInstance().toJson() << std::endl;
+
+	return 0;
+}
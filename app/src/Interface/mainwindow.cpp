@@ -5,6 +5,7 @@
 #include "ticketprinter.h"
 
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QVBoxLayout>
 #include <QGraphicsView>
 #include <QGraphicsPixmapItem>
@@ -22,6 +23,11 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 	setupTicketCallback();
 }
 
+MainWindow::~MainWindow()
+{
+	stopStream();
+}
+
 void MainWindow::setupUI()
 {
 	graphicsView = new QGraphicsView(this);
@@ -71,6 +77,7 @@ void MainWindow::setupUI()
 	connect(ticketsHistoryLogEdit, &QLineEdit::textChanged, this, &MainWindow::searchTickets);
 	connect(statisticsButton, &QPushButton::clicked, this, &MainWindow::showStatistics);
 	connect(chooseLanguage, &QComboBox::currentIndexChanged, this, &MainWindow::setLanguage);
+	connect(cameraButton, &QPushButton::clicked, this, &MainWindow::toggleCamera);
 
 	uploadDataBase();
 }
@@ -118,6 +125,18 @@ void MainWindow::setupButtons()
 		chooseLanguage->setCurrentIndex(0);
 	else if (translator.language() == "ro")
 		chooseLanguage->setCurrentIndex(1);
+
+	cameraEdit = new QLineEdit(this);
+	cameraEdit->setValidator(new QIntValidator(0, 99, this));
+	cameraEdit->setText("0");
+	cameraEdit->setFixedWidth(40);
+
+	cameraDirection = new QComboBox(this);
+	cameraDirection->addItem(tr("Entrance"));
+	cameraDirection->addItem(tr("Exit"));
+	cameraDirection->setCurrentIndex(streamDirection ? 1 : 0);
+
+	cameraButton = new QPushButton(streamThread ? tr("Stop") : tr("Start"), this);
 }
 
 void MainWindow::setupLayouts()
@@ -154,6 +173,7 @@ void MainWindow::setupLayouts()
 	QLabel* reservedLabel = new QLabel(tr("Reserved:"), this);
 	QLabel* occupiedParkingLotsLabel = new QLabel(tr("Occupancy:"), this);
 	QLabel* feeLabel = new QLabel(tr("Fee:"), this);
+	QLabel* cameraLabel = new QLabel(tr("Camera:"), this);
 
 	nameEdit = new QLineEdit(this);
 
@@ -184,6 +204,10 @@ void MainWindow::setupLayouts()
 	topLayout->addWidget(occupiedParkingLotsEdit);
 	topLayout->addWidget(feeLabel);
 	topLayout->addWidget(feeEdit);
+	topLayout->addWidget(cameraLabel);
+	topLayout->addWidget(cameraEdit);
+	topLayout->addWidget(cameraDirection);
+	topLayout->addWidget(cameraButton);
 
 	QVBoxLayout* vehiclesLeftLayout = new QVBoxLayout();
 	vehiclesLeftLayout->addWidget(graphicsView);
@@ -436,18 +460,135 @@ void MainWindow::uploadImage()
 	if (!verifyCapacity())
 		return;
 
-	QString imagePath = QFileDialog::getOpenFileName(this, tr("Upload Image"), "", "Images (*.png *.jpg *.bmp *.gif)");
+	QString imagePath = QFileDialog::getOpenFileName(this, tr("Upload Image"), "", "Images (*.png *.jpg *.bmp *.gif);;Videos (*.mp4 *.avi *.mkv *.mov)");
 
 	if (imagePath.isEmpty())
 		return;
 
+	QString extension = QFileInfo(imagePath).suffix().toLower();
+	if (extension == "mp4" || extension == "avi" || extension == "mkv" || extension == "mov")
+	{
+		uploadVideo(imagePath);
+		return;
+	}
+
 	std::string savePath;
-	vehicleManager.getVehicle(imagePath.toStdString(), savePath);
-	image = QImage(QString::fromStdString(savePath));
+	cv::Mat annotatedImage;
+	vehicleManager.getVehicle(imagePath.toStdString(), savePath, annotatedImage);
+	image = QImage(annotatedImage.data, annotatedImage.cols, annotatedImage.rows, static_cast<qsizetype>(annotatedImage.step), QImage::Format_BGR888).copy();
 
 	processLastVehicle();
 }
 
+void MainWindow::uploadVideo(const QString& videoPath)
+{
+	startStream(videoPath, pressedButton);
+}
+
+bool MainWindow::startStream(const QString& source, const bool& direction)
+{
+	stopStream();
+
+	if (!vehicleManager.openStream(source.toStdString()))
+	{
+		QMessageBox::warning(this, tr("Stream"), tr("The video source could not be opened."));
+		return false;
+	}
+
+	streamDirection = direction;
+
+	streamThread = new QThread(this);
+	streamWorker = new StreamWorker(vehicleManager);
+	streamWorker->moveToThread(streamThread);
+
+	connect(streamThread, &QThread::started, streamWorker, &StreamWorker::run);
+	connect(streamWorker, &StreamWorker::passRecognized, this, &MainWindow::processStreamVehicle);
+	connect(streamWorker, &StreamWorker::finished, streamThread, &QThread::quit);
+	connect(streamThread, &QThread::finished, streamWorker, &QObject::deleteLater);
+	connect(streamThread, &QThread::finished, this, &MainWindow::streamFinished);
+
+	streamThread->start();
+	cameraButton->setText(tr("Stop"));
+
+	return true;
+}
+
+void MainWindow::stopStream()
+{
+	streamPasses.clear();
+
+	if (!streamThread)
+		return;
+
+	// The worker checks its flag before every frame, so the thread ends without waiting for the next vehicle.
+	streamWorker->stop();
+	streamThread->quit();
+	streamThread->wait();
+
+	delete streamThread;
+	streamThread = nullptr;
+	streamWorker = nullptr;
+
+	cameraButton->setText(tr("Start"));
+}
+
+void MainWindow::streamFinished()
+{
+	// A stream stopped and replaced by a new one may still report its end, which must not stop the new one.
+	if (sender() == streamThread)
+		stopStream();
+}
+
+void MainWindow::toggleCamera()
+{
+	if (streamThread)
+	{
+		stopStream();
+		return;
+	}
+
+	pressedButton = cameraDirection->currentIndex() == 1;
+	if (!verifyCapacity())
+		return;
+
+	startStream(cameraEdit->text(), pressedButton);
+}
+
+void MainWindow::processStreamVehicle(const PlateResult& result)
+{
+	// The passes of a stream already stopped are dropped.
+	if (!streamWorker || sender() != streamWorker)
+		return;
+
+	streamPasses.push_back(result);
+
+	// A pass reported while a dialog of the previous vehicle is open waits for it, so the vehicles are processed in order.
+	if (processingStream)
+		return;
+
+	processingStream = true;
+	while (!streamPasses.empty())
+	{
+		PlateResult pass = std::move(streamPasses.front());
+		streamPasses.pop_front();
+
+		pressedButton = streamDirection;
+		if (!verifyCapacity())
+		{
+			stopStream();
+			break;
+		}
+
+		std::string savePath;
+		cv::Mat annotatedImage;
+		vehicleManager.setStreamVehicle(pass, savePath, annotatedImage);
+		image = QImage(annotatedImage.data, annotatedImage.cols, annotatedImage.rows, static_cast<qsizetype>(annotatedImage.step), QImage::Format_BGR888).copy();
+
+		processLastVehicle();
+	}
+	processingStream = false;
+}
+
 void MainWindow::showImage(QListWidgetItem* item)
 {
 	int id = item->data(Qt::UserRole).toInt();
@@ -1,7 +1,9 @@
 ﻿#pragma once
 
 #include "vehiclemanager.h"
+#include "streamworker.h"
 
+#include <deque>
 #include <fstream>
 #include <QApplication>
 #include <QMainWindow>
@@ -13,6 +15,7 @@
 #include <QLineEdit>
 #include <QComboBox>
 #include <QTabWidget>
+#include <QThread>
 
 /**
  * @class MainWindow
@@ -36,6 +39,12 @@ public:
 	 */
 	MainWindow(QWidget* parent = nullptr);
 
+	/**
+	 * @brief Destroys the MainWindow object.
+	 * @details Stops the stream being read, if any, before the vehicle manager it reads is destroyed.
+	 */
+	~MainWindow();
+
 private slots:
 	/**
 	 * @brief Handles the image upload process.
@@ -119,6 +128,30 @@ private slots:
 	 */
 	void setLanguage(const int& choise);
 
+	/**
+	 * @brief Starts or stops reading the capture device.
+	 * @details This function reads the capture device whose index is entered, as an entrance or an exit camera depending on
+	 *          the selected direction, or stops the stream being read.
+	 * @return void
+	 */
+	void toggleCamera();
+
+	/**
+	 * @brief Processes a vehicle recognized in the stream.
+	 * @details This function is called on the interface thread for every pass reported by the stream worker. The passes are
+	 *          processed one at a time and in order, even when a dialog of a previous vehicle is still open. The stream is stopped
+	 *          once the parking lot capacity is reached.
+	 * @param[in] result The recognition result of the pass.
+	 * @return void
+	 */
+	void processStreamVehicle(const PlateResult& result);
+
+	/**
+	 * @brief Releases the stream worker once it has finished reading.
+	 * @return void
+	 */
+	void streamFinished();
+
 private:
 	/**
 	 * @brief Sets up the user interface for the main window.
@@ -128,6 +161,30 @@ private:
 	 */
 	void setupUI();
 
+	/**
+	 * @brief Processes every vehicle passing in a video file.
+	 * @details This function reads the video on a worker thread, which reports the vehicles one pass at a time. Each of them
+	 *          is processed as an uploaded image, until the video ends or the parking lot capacity is reached.
+	 * @param[in] videoPath The path of the video file.
+	 * @return void
+	 */
+	void uploadVideo(const QString& videoPath);
+
+	/**
+	 * @brief Starts reading a video file or a capture device on a worker thread.
+	 * @details The stream being read, if any, is stopped first. A warning is shown if the source cannot be opened.
+	 * @param[in] source The path of a video file, or the index of a capture device, such as "0".
+	 * @param[in] direction Whether the vehicles of the stream exit (true) or enter (false) the parking lot.
+	 * @return Returns true if the source was opened, false otherwise.
+	 */
+	bool startStream(const QString& source, const bool& direction);
+
+	/**
+	 * @brief Stops reading the stream and waits for the worker thread, dropping the passes not yet processed.
+	 * @return void
+	 */
+	void stopStream();
+
 	/**
 	 * @brief Configures paths based on the build environment.
 	 * @details This function sets the paths for assets and translations based on whether the application
@@ -236,7 +293,15 @@ private:
 	QListWidget* ticketsListWidget;
 	QLineEdit* ticketsHistoryLogEdit;
 	QListWidget* ticketsHistoryLogListWidget;
+	QLineEdit* cameraEdit;
+	QComboBox* cameraDirection;
+	QPushButton* cameraButton;
 	VehicleManager vehicleManager;
+	QThread* streamThread = nullptr;
+	StreamWorker* streamWorker = nullptr;
+	std::deque<PlateResult> streamPasses;
+	bool streamDirection = false;
+	bool processingStream = false;
 	std::string assetsPath;
 	std::string translationsPath;
 	bool isPassword;
@@ -0,0 +1,25 @@
+#include "streamworker.h"
+
+StreamWorker::StreamWorker(VehicleManager& vehicleManager, QObject* parent) : QObject(parent), vehicleManager(vehicleManager)
+{
+	qRegisterMetaType<PlateResult>();
+}
+
+void StreamWorker::stop()
+{
+	stopped = true;
+}
+
+void StreamWorker::run()
+{
+	auto isCancelled = [this]()
+		{
+			return stopped.load();
+		};
+
+	PlateResult result;
+	while (!isCancelled() && vehicleManager.readStream(result, isCancelled))
+		emit passRecognized(result);
+
+	emit finished();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "vehiclemanager.h"
+
+#include <atomic>
+#include <QObject>
+#include <QMetaType>
+
+Q_DECLARE_METATYPE(PlateResult)
+
+/**
+ * @class StreamWorker
+ * @brief Reads a video file or a capture device on a worker thread and reports every vehicle passing in it.
+ *
+ * The frames of a stream are decoded and recognized away from the interface thread, so the main window stays responsive
+ * for the whole video, or for as long as a camera is watched. The worker only reads the stream of the vehicle manager;
+ * every pass is sent to the interface thread through a signal, where the vehicle is processed like an uploaded image.
+ */
+class StreamWorker : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * @brief Constructor for the StreamWorker class.
+	 * @param[in] vehicleManager The vehicle manager whose opened stream is read. It must outlive the worker.
+	 * @param[in] parent A pointer to the parent object (default is nullptr).
+	 */
+	StreamWorker(VehicleManager& vehicleManager, QObject* parent = nullptr);
+
+	/**
+	 * @brief Asks the worker to stop reading.
+	 * @details This function can be called from any thread. The reading stops before the next frame.
+	 * @return void
+	 */
+	void stop();
+
+public slots:
+	/**
+	 * @brief Reads the stream until it ends or the worker is stopped, emitting passRecognized for every vehicle.
+	 * @return void
+	 */
+	void run();
+
+signals:
+	void passRecognized(const PlateResult& result);
+
+	void finished();
+
+private:
+	VehicleManager& vehicleManager;
+	std::atomic<bool> stopped{ false };
+};
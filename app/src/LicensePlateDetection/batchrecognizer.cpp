@@ -0,0 +1,267 @@
+#include "batchrecognizer.h"
+#include "imagedecoder.h"
+#include "platerecognizer.h"
+#include "stageprofiler.h"
+#include "tesseractpool.h"
+#include "workerpool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	// Adds the time a worker spends processing, as opposed to waiting on its queues, to the busy time of its stage.
+	class BusyTimer
+	{
+	public:
+		explicit BusyTimer(std::atomic<int64_t>& busy) : busy(busy), start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~BusyTimer()
+		{
+			busy.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+
+	private:
+		std::atomic<int64_t>& busy;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	enum BatchStage
+	{
+		Decode,
+		Proposal,
+		Rectification,
+		Ocr,
+		BatchStageCount
+	};
+}
+
+BatchRecognizer::BatchRecognizer(const BatchOptions& options) : options(options)
+{
+	int cores = std::max(static_cast<int>(std::thread::hardware_concurrency()), 4);
+
+	// OCR is by far the most expensive stage, followed by the rectification of the candidates, so they get most of the cores.
+	if (this->options.decodeWorkers <= 0)
+		this->options.decodeWorkers = std::max(1, cores / 8);
+
+	if (this->options.proposalWorkers <= 0)
+		this->options.proposalWorkers = std::max(1, cores / 8);
+
+	if (this->options.rectificationWorkers <= 0)
+		this->options.rectificationWorkers = std::max(1, cores / 4);
+
+	if (this->options.ocrWorkers <= 0)
+		this->options.ocrWorkers = std::max(1, cores - this->options.decodeWorkers - this->options.proposalWorkers - this->options.rectificationWorkers);
+
+	if (this->options.queueCapacity <= 0)
+		this->options.queueCapacity = 1;
+}
+
+const BatchOptions& BatchRecognizer::getOptions() const
+{
+	return options;
+}
+
+std::vector<PlateResult> BatchRecognizer::recognize(const std::vector<std::string>& imagePaths, const std::string& saveDirectory, BatchReport& report)
+{
+	struct Frame
+	{
+		size_t index = 0;
+		std::chrono::steady_clock::time_point start;
+		cv::Mat image;
+		std::unique_ptr<PlateRecognizer> recognizer;
+		bool valid = false;
+		std::vector<char> rectified;
+	};
+
+	report = BatchReport();
+	report.images = imagePaths.size();
+
+	std::vector<PlateResult> results(imagePaths.size());
+	if (imagePaths.empty())
+		return results;
+
+	TesseractPool::getInstance().warmUp(options.ocrWorkers);
+
+	if (!saveDirectory.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(saveDirectory, error);
+	}
+
+	std::array<std::atomic<int64_t>, BatchStageCount> busy{};
+
+	// The recognizers of the images whose result was produced, reused by the next images.
+	std::mutex recognizersMutex;
+	std::vector<std::unique_ptr<PlateRecognizer>> idleRecognizers;
+
+	auto acquireRecognizer = [&]()
+		{
+			std::lock_guard<std::mutex> lock(recognizersMutex);
+			if (idleRecognizers.empty())
+			{
+				std::unique_ptr<PlateRecognizer> recognizer = std::make_unique<PlateRecognizer>();
+				recognizer->setProfile(options.profile);
+				return recognizer;
+			}
+
+			std::unique_ptr<PlateRecognizer> recognizer = std::move(idleRecognizers.back());
+			idleRecognizers.pop_back();
+			return recognizer;
+		};
+
+	auto releaseRecognizer = [&](std::unique_ptr<PlateRecognizer> recognizer)
+		{
+			std::lock_guard<std::mutex> lock(recognizersMutex);
+			idleRecognizers.push_back(std::move(recognizer));
+		};
+
+	// Every stage is a worker pool whose workers wait for a free place in the queue of the next stage, so a slow stage slows down
+	// the ones before it and the number of images in flight stays bounded. The pools run every worker with a thread budget of 1,
+	// since the stages already keep every core busy. The stages are built from the last one, which the others feed.
+	using FramePool = WorkerPool<std::unique_ptr<Frame>>;
+
+	FramePool ocrPool(options.ocrWorkers, options.queueCapacity, [&]() -> FramePool::Handler
+		{
+			return [&](std::unique_ptr<Frame>& frame, const double&)
+				{
+					BusyTimer timer(busy[Ocr]);
+					StageProfiler& profiler = StageProfiler::getInstance();
+					PlateRecognizer& recognizer = *frame->recognizer;
+
+					PlateResult result;
+					if (!frame->valid)
+						result = PlateRecognizer::invalidResult();
+					else
+					{
+						// The candidates are read in the order of their rank, so the same one wins as in a single frame.
+						int best = recognizer.candidateCount;
+						for (int i = 0; i < recognizer.candidateCount && best == recognizer.candidateCount; i++)
+							if (frame->rectified[i] && PlateRecognizer::readCandidate(recognizer.candidates[i]))
+								best = i;
+
+						result = recognizer.annotate(best);
+
+						if (!saveDirectory.empty())
+							cv::imwrite((std::filesystem::path(saveDirectory) / std::filesystem::path(imagePaths[frame->index]).filename()).string(), result.annotated);
+
+						result.annotated.release();
+					}
+
+					if (profiler.isEnabled())
+						profiler.record(PipelineStage::Total, std::chrono::steady_clock::now() - frame->start, false);
+
+					results[frame->index] = std::move(result);
+					releaseRecognizer(std::move(frame->recognizer));
+				};
+		});
+
+	// Unlike a single frame, where the candidates ranked after the one that is read are cancelled, every candidate is straightened here,
+	// since its result is only known in the OCR stage. The candidates rejected early are cheap, so little work is wasted.
+	FramePool rectificationPool(options.rectificationWorkers, options.queueCapacity, [&]() -> FramePool::Handler
+		{
+			std::function<bool()> notCancelled = []()
+				{
+					return false;
+				};
+
+			return [&, notCancelled](std::unique_ptr<Frame>& frame, const double&)
+				{
+					{
+						BusyTimer timer(busy[Rectification]);
+						PlateRecognizer& recognizer = *frame->recognizer;
+
+						frame->rectified.assign(recognizer.candidateCount, false);
+						for (int i = 0; i < recognizer.candidateCount; i++)
+							frame->rectified[i] = PlateRecognizer::rectifyCandidate(recognizer.candidates[i], recognizer.cropped, recognizer.gauss, notCancelled, recognizer.profile);
+					}
+					ocrPool.submit(frame);
+				};
+		});
+
+	FramePool proposalPool(options.proposalWorkers, options.queueCapacity, [&]() -> FramePool::Handler
+		{
+			return [&](std::unique_ptr<Frame>& frame, const double&)
+				{
+					{
+						BusyTimer timer(busy[Proposal]);
+						frame->recognizer = acquireRecognizer();
+						frame->valid = frame->recognizer->propose(frame->image, 2);
+						frame->image.release();
+					}
+					rectificationPool.submit(frame);
+				};
+		});
+
+	// The images are decoded directly at the half resolution the pipeline works at, so the decoding workers never hold a full image.
+	FramePool decodePool(options.decodeWorkers, options.queueCapacity, [&]() -> FramePool::Handler
+		{
+			return [&, buffer = std::vector<uchar>()](std::unique_ptr<Frame>& frame, const double&) mutable
+				{
+					{
+						BusyTimer timer(busy[Decode]);
+						frame->start = std::chrono::steady_clock::now();
+						if (ImageDecoder::readFile(imagePaths[frame->index], buffer))
+							ImageDecoder::decode(buffer, frame->image, 2);
+					}
+					proposalPool.submit(frame);
+				};
+		});
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t index = 0; index < imagePaths.size(); index++)
+	{
+		auto frame = std::make_unique<Frame>();
+		frame->index = index;
+		decodePool.submit(frame);
+	}
+
+	// Every stage is closed once the one before it has processed its last image, so every image goes through the whole pipeline.
+	decodePool.close();
+	proposalPool.close();
+	rectificationPool.close();
+	ocrPool.close();
+
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	report.imagesPerSecond = report.seconds > 0 ? report.images / report.seconds : 0;
+	report.recognized = std::count_if(results.begin(), results.end(), [](const PlateResult& result)
+		{
+			return result.plate != "N/A";
+		});
+
+	const std::array<std::pair<std::string, int>, BatchStageCount> stages =
+	{ {
+		{ "decode", options.decodeWorkers },
+		{ "proposal", options.proposalWorkers },
+		{ "rectification", options.rectificationWorkers },
+		{ "ocr", options.ocrWorkers }
+	} };
+
+	for (int i = 0; i < BatchStageCount; i++)
+	{
+		StageUtilization stage;
+		stage.stage = stages[i].first;
+		stage.workers = stages[i].second;
+		stage.busySeconds = busy[i].load() / 1e9;
+		stage.utilization = report.seconds > 0 ? stage.busySeconds / (stage.workers * report.seconds) : 0;
+		report.stages.push_back(stage);
+	}
+
+	return results;
+}
+
+std::vector<PlateResult> textFromImages(const std::vector<std::string>& imagePaths, const std::string& saveDirectory, BatchReport& report)
+{
+	BatchRecognizer recognizer;
+	return recognizer.recognize(imagePaths, saveDirectory, report);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include "licenseplatedetection.h"
+#include "pipelinepolicy.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @struct BatchOptions
+ * @brief Holds the number of workers of each stage of the batch pipeline and the capacity of the queues between them.
+ *
+ * A number of workers of 0 lets the recognizer split the available cores between the stages.
+ * The threshold profile applies to every image of the batch.
+ */
+struct BatchOptions
+{
+	int decodeWorkers = 0;
+	int proposalWorkers = 0;
+	int rectificationWorkers = 0;
+	int ocrWorkers = 0;
+	int queueCapacity = 8;
+	ThresholdProfile profile = ThresholdProfile::Default;
+};
+
+/**
+ * @struct StageUtilization
+ * @brief Holds how busy the workers of a stage of the batch pipeline were.
+ */
+struct StageUtilization
+{
+	std::string stage;
+	int workers = 0;
+	double busySeconds = 0;
+	double utilization = 0;
+};
+
+/**
+ * @struct BatchReport
+ * @brief Holds the throughput of a batch and the utilization of each of its stages.
+ */
+struct BatchReport
+{
+	size_t images = 0;
+	size_t recognized = 0;
+	double seconds = 0;
+	double imagesPerSecond = 0;
+	std::vector<StageUtilization> stages;
+};
+
+/**
+ * @class BatchRecognizer
+ * @brief Recognizes the license plates of many stored images with all the cores, by pipelining the recognition in stages.
+ *
+ * The images go through four stages, each a WorkerPool with its own workers and bounded queue: decoding,
+ * colour analysis and candidate proposal, rectification of the candidates, and OCR. While one image is read,
+ * the previous ones are straightened and proposed, so every core is busy even though a single image
+ * is processed sequentially. Every image in flight owns a PlateRecognizer, which is reused for the next images
+ * once its result is produced, and the bounded queues keep the number of images in flight, and thus the memory, bounded.
+ * The images are decoded at half resolution, and the results are identical to the ones of plateFromImage for their encoded bytes.
+ */
+class LICENSEPLATEDETECTION_API BatchRecognizer
+{
+public:
+	explicit BatchRecognizer(const BatchOptions& options = BatchOptions());
+
+	BatchRecognizer(const BatchRecognizer&) = delete;
+
+	BatchRecognizer& operator=(const BatchRecognizer&) = delete;
+
+public:
+	/**
+	 * @brief Recognizes the license plates of a list of image files.
+	 * @details The annotated images are written to the destination directory, under the name of their source file,
+	 *          and are not kept in the results, so that the memory does not grow with the size of the batch.
+	 * @param[in] imagePaths The paths of the source images.
+	 * @param[in] saveDirectory The directory where the annotated images are written, or an empty string to not write them.
+	 * @param[out] report The throughput of the batch and the utilization of each stage.
+	 * @return The recognition results, in the order of the source paths. An image that cannot be read has the "N/A" plate.
+	 */
+	std::vector<PlateResult> recognize(const std::vector<std::string>& imagePaths, const std::string& saveDirectory, BatchReport& report);
+
+	/**
+	 * @brief Returns the options of the recognizer, with the number of workers of each stage resolved.
+	 * @return The resolved options.
+	 */
+	const BatchOptions& getOptions() const;
+
+private:
+	BatchOptions options;
+};
+
+/**
+ * @brief Extracts the text from a list of image files and optionally saves the annotated images.
+ * @details The images are recognized with a BatchRecognizer that splits the available cores between its stages.
+ * @param[in] imagePaths The paths of the source images.
+ * @param[in] saveDirectory The directory where the annotated images are written, or an empty string to not write them.
+ * @param[out] report The throughput of the batch and the utilization of each stage.
+ * @return The recognition results, in the order of the source paths, without the annotated images.
+ */
+std::vector<PlateResult> LICENSEPLATEDETECTION_API textFromImages(const std::vector<std::string>& imagePaths, const std::string& saveDirectory, BatchReport& report);
@@ -0,0 +1,202 @@
+#include "cameracalibration.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <filesystem>
+
+bool CameraCalibration::load(const std::string& path)
+{
+	cv::FileStorage storage;
+	try
+	{
+		if (!storage.open(path, cv::FileStorage::READ))
+			return false;
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	std::string cameraName;
+	int width = 0, height = 0;
+	cv::Mat cameraMatrix, distortion;
+	std::vector<double> angles;
+
+	storage["name"] >> cameraName;
+	storage["image_width"] >> width;
+	storage["image_height"] >> height;
+	storage["camera_matrix"] >> cameraMatrix;
+	storage["distortion_coefficients"] >> distortion;
+	storage["mounting_angles"] >> angles;
+
+	cv::Vec3d mountingAngles;
+	if (!angles.empty())
+	{
+		if (angles.size() != 3)
+			return false;
+
+		mountingAngles = cv::Vec3d(angles[0], angles[1], angles[2]);
+	}
+
+	if (!create(cameraName, cv::Size(width, height), cameraMatrix, distortion, mountingAngles))
+		return false;
+
+	cv::FileNode bounds = storage["plate_bounds"];
+	if (!bounds.empty())
+	{
+		PlateBounds plateBounds;
+		bounds["min_area"] >> plateBounds.minArea;
+		bounds["max_area"] >> plateBounds.maxArea;
+		bounds["min_height"] >> plateBounds.minHeight;
+		bounds["max_height"] >> plateBounds.maxHeight;
+
+		if (!setPlateBounds(plateBounds))
+		{
+			map1.release();
+			map2.release();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CameraCalibration::create(const std::string& name, const cv::Size& imageSize, const cv::Mat& cameraMatrix, const cv::Mat& distortion, const cv::Vec3d& mountingAngles)
+{
+	if (imageSize.width < 2 || imageSize.height < 2 || cameraMatrix.rows != 3 || cameraMatrix.cols != 3)
+		return false;
+
+	// The pipeline works at half the resolution of the camera, so the tables are computed for the halved frames.
+	cv::Size halvedSize(imageSize.width / 2, imageSize.height / 2);
+	cv::Mat halvedMatrix;
+	cameraMatrix.convertTo(halvedMatrix, CV_64F);
+	cv::Mat scaled = halvedMatrix.rowRange(0, 2);
+	scaled *= 0.5;
+
+	// The camera sees the lane turned by its pitch, then its yaw, then its roll, so the frame is turned back by the inverse rotation.
+	cv::Mat pitch, yaw, roll;
+	cv::Rodrigues(cv::Vec3d(mountingAngles[0] * CV_PI / 180, 0, 0), pitch);
+	cv::Rodrigues(cv::Vec3d(0, mountingAngles[1] * CV_PI / 180, 0), yaw);
+	cv::Rodrigues(cv::Vec3d(0, 0, mountingAngles[2] * CV_PI / 180), roll);
+	cv::Mat rotation = roll * yaw * pitch;
+
+	try
+	{
+		cv::initUndistortRectifyMap(halvedMatrix, distortion, rotation.t(), halvedMatrix, halvedSize, CV_16SC2, map1, map2);
+	}
+	catch (const cv::Exception&)
+	{
+		map1.release();
+		map2.release();
+		return false;
+	}
+
+	this->name = name;
+	hasPlateBounds = false;
+
+	return true;
+}
+
+bool CameraCalibration::setPlateBounds(const PlateBounds& bounds)
+{
+	if (bounds.minArea < 0 || bounds.minArea >= bounds.maxArea || bounds.maxArea > 1 ||
+		bounds.minHeight < 0 || bounds.minHeight >= bounds.maxHeight)
+		return false;
+
+	plateBounds = bounds;
+	hasPlateBounds = true;
+
+	return true;
+}
+
+bool CameraCalibration::isLoaded() const
+{
+	return !map1.empty();
+}
+
+const std::string& CameraCalibration::getName() const
+{
+	return name;
+}
+
+bool CameraCalibration::getPlateBounds(PlateBounds& bounds) const
+{
+	if (!hasPlateBounds)
+		return false;
+
+	bounds = plateBounds;
+
+	return true;
+}
+
+bool CameraCalibration::normalize(const cv::Mat& src, cv::Mat& dst) const
+{
+	// A frame decoded at half its resolution may be one pixel larger than a frame halved by the pipeline.
+	if (!isLoaded() || src.empty() || src.type() != CV_8UC3 ||
+		std::abs(src.cols - map1.cols) > 1 || std::abs(src.rows - map1.rows) > 1)
+		return false;
+
+	cv::remap(src, dst, map1, map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+
+	return true;
+}
+
+cv::Rect CameraCalibration::toSource(const cv::Rect& roi) const
+{
+	if (!isLoaded() || roi.empty())
+		return roi;
+
+	cv::Rect frame(0, 0, map1.cols, map1.rows);
+	cv::Rect clamped = roi & frame;
+	if (clamped.empty())
+		return clamped;
+
+	// The distortion bends the edges of the region, so the source of a side may reach further than its corners. The extremes
+	// of the source lie on the edges of the region, so every pixel of its edges is sampled. Every pixel of the tables holds
+	// the integer part of its source, which is close enough for a bounding box.
+	cv::Point minSource(INT_MAX, INT_MAX), maxSource(INT_MIN, INT_MIN);
+	auto include = [&](const int& x, const int& y)
+		{
+			const cv::Vec2s& source = map1.at<cv::Vec2s>(y, x);
+			minSource = cv::Point(std::min(minSource.x, static_cast<int>(source[0])), std::min(minSource.y, static_cast<int>(source[1])));
+			maxSource = cv::Point(std::max(maxSource.x, static_cast<int>(source[0])), std::max(maxSource.y, static_cast<int>(source[1])));
+		};
+
+	for (int x = clamped.x; x < clamped.br().x; x++)
+	{
+		include(x, clamped.y);
+		include(x, clamped.br().y - 1);
+	}
+	for (int y = clamped.y; y < clamped.br().y; y++)
+	{
+		include(clamped.x, y);
+		include(clamped.br().x - 1, y);
+	}
+
+	return cv::Rect(minSource, maxSource + cv::Point(1, 1)) & frame;
+}
+
+bool loadCalibrations(const std::string& directory, std::map<std::string, CameraCalibration>& calibrations)
+{
+	std::error_code error;
+	std::filesystem::directory_iterator iterator(directory, error);
+	if (error)
+		return false;
+
+	for (const auto& entry : iterator)
+	{
+		std::string extension = entry.path().extension().string();
+		if (!entry.is_regular_file() || (extension != ".yml" && extension != ".yaml" && extension != ".json" && extension != ".xml"))
+			continue;
+
+		CameraCalibration calibration;
+		if (!calibration.load(entry.path().string()))
+			continue;
+
+		std::string name = calibration.getName().empty() ? entry.path().stem().string() : calibration.getName();
+		calibrations[name] = calibration;
+	}
+
+	return true;
+}
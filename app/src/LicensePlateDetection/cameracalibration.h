@@ -0,0 +1,145 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include <map>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @struct PlateBounds
+ * @brief Holds the size of the plates expected from a camera, as in the threshold profiles.
+ * @details The areas are fractions of the search region and the heights are fractions of the width of a plate.
+ */
+struct PlateBounds
+{
+	float minArea = 0.01f;
+	float maxArea = 0.15f;
+	float minHeight = 0.2f;
+	float maxHeight = 0.9f;
+};
+
+/**
+ * @class CameraCalibration
+ * @brief Holds the calibration profile of a gate camera, which normalizes its frames before the plates are searched.
+ *
+ * The lens distortion and the mounting angles of a gate camera never change, so the frames are undistorted and rotated back
+ * to a camera facing the lane with lookup tables computed once, when the profile is loaded, at the resolution the pipeline
+ * works at. The tables are fixed-point, so remapping a frame costs one pass over its pixels, and the candidates found in the
+ * normalized frame are already close to rectangles. The profile may also hold the size of the plates seen by the camera,
+ * which replaces the size thresholds of the threshold profile. A loaded profile is never modified, so it may be shared
+ * by the threads that process the frames of its camera.
+ *
+ * The profiles are stored with cv::FileStorage, in the format written by the calibration tools of OpenCV:
+ * @code
+ * %YAML:1.0
+ * name: entrance
+ * image_width: 4624
+ * image_height: 3468
+ * camera_matrix: !!opencv-matrix
+ *    rows: 3
+ *    cols: 3
+ *    dt: d
+ *    data: [ 3300., 0., 2312., 0., 3300., 1734., 0., 0., 1. ]
+ * distortion_coefficients: !!opencv-matrix
+ *    rows: 1
+ *    cols: 5
+ *    dt: d
+ *    data: [ -0.12, 0.03, 0., 0., 0. ]
+ * mounting_angles: [ 3., 0., 6. ]
+ * plate_bounds: { min_area: 0.01, max_area: 0.15, min_height: 0.2, max_height: 0.9 }
+ * @endcode
+ * The mounting angles are the pitch, yaw and roll of the camera in degrees, and the plate bounds are optional.
+ */
+class LICENSEPLATEDETECTION_API CameraCalibration
+{
+public:
+	CameraCalibration() = default;
+
+public:
+	/**
+	 * @brief Loads a calibration profile and computes its lookup tables.
+	 * @param[in] path The path of the profile, a YAML, JSON or XML file.
+	 * @return Returns false if the file cannot be read or its calibration is invalid, true otherwise.
+	 */
+	bool load(const std::string& path);
+
+	/**
+	 * @brief Builds a calibration profile from its parameters and computes its lookup tables.
+	 * @param[in] name The name of the camera.
+	 * @param[in] imageSize The full resolution of the frames of the camera.
+	 * @param[in] cameraMatrix The 3x3 intrinsic matrix of the camera, at full resolution.
+	 * @param[in] distortion The distortion coefficients of the lens, or an empty matrix for none.
+	 * @param[in] mountingAngles The pitch, yaw and roll of the camera, in degrees.
+	 * @return Returns false if the parameters are invalid, true otherwise.
+	 */
+	bool create(const std::string& name, const cv::Size& imageSize, const cv::Mat& cameraMatrix, const cv::Mat& distortion, const cv::Vec3d& mountingAngles);
+
+	/**
+	 * @brief Sets the size of the plates expected from the camera.
+	 * @param[in] bounds The bounds that replace the size thresholds of the threshold profile.
+	 * @return Returns false if the bounds are not increasing fractions, true otherwise.
+	 */
+	bool setPlateBounds(const PlateBounds& bounds);
+
+	/**
+	 * @brief Checks whether the lookup tables of the profile were computed.
+	 * @return Returns true if the profile was loaded or created, false otherwise.
+	 */
+	bool isLoaded() const;
+
+	/**
+	 * @brief Returns the name of the camera.
+	 * @return The name of the camera, empty if the profile has none.
+	 */
+	const std::string& getName() const;
+
+	/**
+	 * @brief Returns the size of the plates expected from the camera.
+	 * @param[out] bounds The bounds of the profile.
+	 * @return Returns true if the profile holds plate bounds, false otherwise.
+	 */
+	bool getPlateBounds(PlateBounds& bounds) const;
+
+	/**
+	 * @brief Undistorts and rotates back a frame halved as in the pipeline.
+	 * @param[in] src The halved frame, in BGR format.
+	 * @param[out] dst The normalized frame, of the size of the lookup tables.
+	 * @return Returns false if the profile was not loaded or the frame is not halved from the resolution of the camera, true otherwise.
+	 */
+	bool normalize(const cv::Mat& src, cv::Mat& dst) const;
+
+	/**
+	 * @brief Returns the region of a halved frame from which a region of its normalized frame was computed.
+	 * @details The box covers the sources of every pixel on the edges of the region, which the lens distortion may bend beyond its corners.
+	 * @param[in] roi The region, in the coordinates of the normalized frame, clamped to the frame.
+	 * @return The bounding box of the source of the region, in the coordinates of the halved frame, or the region itself if the profile was not loaded.
+	 */
+	cv::Rect toSource(const cv::Rect& roi) const;
+
+private:
+	std::string name;
+	cv::Mat map1, map2;
+	PlateBounds plateBounds;
+	bool hasPlateBounds = false;
+};
+
+/**
+ * @brief Loads the calibration profiles of every camera from a directory, at startup.
+ * @details Every YAML, JSON or XML file of the directory is loaded as a profile, and its name is the name of the camera,
+ *          or the name of the file if it has none. The files that cannot be loaded are skipped.
+ * @param[in] directory The directory of the profiles.
+ * @param[out] calibrations The loaded profiles, by camera.
+ * @return Returns false if the directory cannot be read, true otherwise, even if no profile was loaded.
+ */
+bool LICENSEPLATEDETECTION_API loadCalibrations(const std::string& directory, std::map<std::string, CameraCalibration>& calibrations);
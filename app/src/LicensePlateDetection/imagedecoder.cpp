@@ -0,0 +1,116 @@
+#include "imagedecoder.h"
+
+#include <algorithm>
+#include <fstream>
+
+bool ImageDecoder::readFile(const std::string& path, std::vector<uchar>& buffer)
+{
+	buffer.clear();
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	buffer.resize(static_cast<size_t>(size));
+	file.seekg(0);
+
+	if (!file.read(reinterpret_cast<char*>(buffer.data()), size))
+	{
+		buffer.clear();
+		return false;
+	}
+
+	return true;
+}
+
+cv::Size ImageDecoder::encodedSize(const std::vector<uchar>& buffer)
+{
+	static const uchar pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	auto readUint16 = [&buffer](const size_t& offset)
+		{
+			return buffer[offset] << 8 | buffer[offset + 1];
+		};
+
+	// The IHDR chunk comes first in a PNG file, with the width and height stored after its length and type.
+	if (buffer.size() >= 24 && std::equal(pngSignature, pngSignature + 8, buffer.begin()))
+		return cv::Size(readUint16(16) << 16 | readUint16(18), readUint16(20) << 16 | readUint16(22));
+
+	if (buffer.size() < 4 || buffer[0] != 0xFF || buffer[1] != 0xD8)
+		return cv::Size();
+
+	// The segments of a JPEG file are walked until the start of frame, which holds the height and then the width.
+	size_t i = 2;
+	while (i + 9 <= buffer.size())
+	{
+		if (buffer[i] != 0xFF)
+			return cv::Size();
+
+		uchar marker = buffer[i + 1];
+		if (marker == 0xFF)
+		{
+			i++;
+			continue;
+		}
+
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+		{
+			i += 2;
+			continue;
+		}
+
+		bool startOfFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+		if (startOfFrame)
+			return cv::Size(readUint16(i + 7), readUint16(i + 5));
+
+		i += 2 + readUint16(i + 2);
+	}
+
+	return cv::Size();
+}
+
+int ImageDecoder::reductionFor(const cv::Size& size, const int& minSide)
+{
+	if (size.empty())
+		return 1;
+
+	int longerSide = std::max(size.width, size.height);
+
+	int reduction = 1;
+	while (reduction < 8 && longerSide / (reduction * 2) >= minSide)
+		reduction *= 2;
+
+	return reduction;
+}
+
+bool ImageDecoder::decode(const std::vector<uchar>& buffer, cv::Mat& dst, const int& reduction, const bool& grayscale)
+{
+	int flags;
+	switch (reduction)
+	{
+	case 2:
+		flags = grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+		break;
+	case 4:
+		flags = grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+		break;
+	case 8:
+		flags = grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+		break;
+	default:
+		flags = grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+		break;
+	}
+
+	if (buffer.empty() || cv::imdecode(buffer, flags, &dst).empty())
+	{
+		dst.release();
+		return false;
+	}
+
+	return true;
+}
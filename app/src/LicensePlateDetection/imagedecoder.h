@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @class ImageDecoder
+ * @brief Decodes the stored and uploaded images directly at the resolution the pipelines work at.
+ *
+ * The recognition pipelines never use the full resolution of a photo: the plate recognition halves every frame and
+ * the QR detection works on images of at most 1080 pixels. JPEG images can be decoded at 1/2, 1/4 or 1/8 of their size
+ * by scaling the inverse DCT, which is much faster than decoding every pixel and shrinking the result afterwards,
+ * and never allocates the full-resolution image. Other formats are decoded fully and then shrunk by the codec.
+ */
+class LICENSEPLATEDETECTION_API ImageDecoder
+{
+public:
+	/**
+	 * @brief Reads the encoded bytes of an image file, without decoding them.
+	 * @param[in] path The path of the image file.
+	 * @param[out] buffer The encoded image.
+	 * @return Returns true if the file was read and is not empty, false otherwise.
+	 */
+	static bool readFile(const std::string& path, std::vector<uchar>& buffer);
+
+	/**
+	 * @brief Reads the size of an encoded image from its header, without decoding it.
+	 * @details The JPEG and PNG headers are supported. The size is the stored one, before the EXIF orientation is applied.
+	 * @param[in] buffer The encoded image.
+	 * @return The size of the image, or an empty size if the format is not supported or the header is truncated.
+	 */
+	static cv::Size encodedSize(const std::vector<uchar>& buffer);
+
+	/**
+	 * @brief Chooses the largest reduction at which the longer side of an image is still at least a given length.
+	 * @param[in] size The size of the encoded image, as returned by encodedSize.
+	 * @param[in] minSide The length the longer side must keep.
+	 * @return The reduction, 1, 2, 4 or 8. An empty size is never reduced.
+	 */
+	static int reductionFor(const cv::Size& size, const int& minSide);
+
+	/**
+	 * @brief Decodes an image reduced by a power of two.
+	 * @details The destination is reused when it already has the decoded size and type, as between the frames of a camera.
+	 * @param[in] buffer The encoded image.
+	 * @param[out] dst The decoded image, in BGR format, or in grayscale if requested.
+	 * @param[in] reduction The reduction, 1, 2, 4 or 8. Any other value decodes the full image.
+	 * @param[in] grayscale True to decode the luminance only, false to decode the colours.
+	 * @return Returns true if the image was decoded, false if the buffer is empty or not a supported image.
+	 */
+	static bool decode(const std::vector<uchar>& buffer, cv::Mat& dst, const int& reduction, const bool& grayscale = false);
+};
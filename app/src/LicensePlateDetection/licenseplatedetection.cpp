@@ -1,44 +1,411 @@
 ﻿#include "licenseplatedetection.h"
+#include "tesseractpool.h"
+#include "platerecognizer.h"
+#include "imagedecoder.h"
+#include "ocrbackend.h"
+#include "workerpool.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/core/hal/hal.hpp>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <map>
+#include <mutex>
+
+namespace
+{
+	// The character types of the three words of a plate: the county letters, the digits and the letters.
+	const std::array<bool, 3> plateCharTypes = { false, true, false };
+
+	struct ColourTables
+	{
+		double normalized[256];
+		uchar value[256];
+		uchar saturation[256 * 256];
+		double hueTerm[256];
+		int hueSector[256];
+	};
+
+	const ColourTables& colourTables()
+	{
+		static const std::unique_ptr<ColourTables> tables = []()
+			{
+				auto tables = std::make_unique<ColourTables>();
+
+				for (int i = 0; i < 256; i++)
+				{
+					tables->normalized[i] = i / 255.0;
+					tables->value[i] = static_cast<uchar>(tables->normalized[i] * 255);
+					tables->hueTerm[i] = 1 - std::abs(fmod(i / 30.0, 2) - 1);
+					tables->hueSector[i] = static_cast<int>(i / 30.0);
+				}
+
+				for (int max = 0; max < 256; max++)
+					for (int min = 0; min <= max; min++)
+					{
+						double difference = tables->normalized[max] - tables->normalized[min];
+						tables->saturation[max * 256 + min] = max ? static_cast<uchar>((difference / tables->normalized[max]) * 255) : 0;
+					}
+
+				return tables;
+			}();
+
+		return *tables;
+	}
+
+	thread_local int threadBudget = 0;
+
+	// Splits the rows of an image into bands processed in parallel, at most as many as the thread budget of the calling thread.
+	// Every row is written by a single band and does not depend on the others, so the result does not depend on the number of bands.
+	void parallelRows(const int& rows, const int& cols, const std::function<void(const cv::Range&)>& kernel)
+	{
+		const int64_t bandPixels = 1 << 16;
+
+		int budget = getThreadBudget();
+		int bands = static_cast<int>(std::min<int64_t>({ static_cast<int64_t>(budget), static_cast<int64_t>(rows) * cols / bandPixels, static_cast<int64_t>(rows) }));
+
+		if (bands <= 1)
+		{
+			kernel(cv::Range(0, rows));
+			return;
+		}
+
+		cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range)
+			{
+				kernel(cv::Range(rows * range.start / bands, rows * range.end / bands));
+			}, bands);
+	}
+
+	void packBits(const cv::Mat& src, std::vector<uchar>& bits)
+	{
+		int rowBytes = (src.cols + 7) / 8;
+		bits.assign(static_cast<size_t>(rowBytes) * src.rows, 0);
+
+		for (int y = 0; y < src.rows; y++)
+		{
+			const uchar* srcRow = src.ptr<uchar>(y);
+			uchar* bitsRow = bits.data() + static_cast<size_t>(y) * rowBytes;
+
+			for (int x = 0; x < src.cols; x++)
+				if (srcRow[x])
+					bitsRow[x >> 3] |= static_cast<uchar>(1 << (x & 7));
+		}
+	}
+
+	// The neighbours compared along each quantized gradient direction, as { dy, dx } offsets in the order of the suppression test.
+	const int suppressionOffsets[4][4][2] =
+	{
+		{ { 0, -1 }, { 0, -2 }, { 0, 1 }, { 0, 2 } },
+		{ { -1, -1 }, { -2, -2 }, { 1, 1 }, { 2, 2 } },
+		{ { -1, 0 }, { -2, 0 }, { 1, 0 }, { 2, 0 } },
+		{ { -1, 1 }, { -2, 2 }, { 1, -1 }, { 2, -2 } }
+	};
+
+	// Maps gradient directions in degrees, as returned by cv::cartToPolar, to the 4 bins of the suppression:
+	// 0 for [0, 22.5) and [157.5, 180], 1 for [22.5, 67.5), 2 for [67.5, 112.5) and 3 for [112.5, 157.5), modulo 180.
+	void quantizeDirections(const float* directions, uchar* bins, const int& cols)
+	{
+		int x = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+		const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+		const cv::v_float32 halfTurn = cv::vx_setall_f32(180.f);
+		const cv::v_float32 bound1 = cv::vx_setall_f32(22.5f), bound2 = cv::vx_setall_f32(67.5f);
+		const cv::v_float32 bound3 = cv::vx_setall_f32(112.5f), bound4 = cv::vx_setall_f32(157.5f);
+		const cv::v_int32 wrap = cv::vx_setall_s32(3);
+
+		// Every bound passed sets a comparison mask to -1, so the negated sum of the masks is the bin, with 4 wrapping back to 0.
+		auto quantize = [&](const float* src)
+			{
+				cv::v_float32 direction = cv::vx_load(src);
+				direction = cv::v_sub(direction, cv::v_and(cv::v_ge(direction, halfTurn), halfTurn));
+
+				cv::v_int32 passed = cv::v_add(
+					cv::v_add(cv::v_reinterpret_as_s32(cv::v_ge(direction, bound1)), cv::v_reinterpret_as_s32(cv::v_ge(direction, bound2))),
+					cv::v_add(cv::v_reinterpret_as_s32(cv::v_ge(direction, bound3)), cv::v_reinterpret_as_s32(cv::v_ge(direction, bound4))));
+
+				return cv::v_and(cv::v_sub(cv::vx_setzero_s32(), passed), wrap);
+			};
+
+		for (; x <= cols - lanes * 4; x += lanes * 4)
+		{
+			cv::v_int16 low = cv::v_pack(quantize(directions + x), quantize(directions + x + lanes));
+			cv::v_int16 high = cv::v_pack(quantize(directions + x + lanes * 2), quantize(directions + x + lanes * 3));
+			cv::v_store(bins + x, cv::v_pack_u(low, high));
+		}
+#endif
+		for (; x < cols; x++)
+		{
+			float direction = directions[x] >= 180 ? directions[x] - 180 : directions[x];
+			bins[x] = ((direction >= 22.5f) + (direction >= 67.5f) + (direction >= 112.5f) + (direction >= 157.5f)) & 3;
+		}
+	}
+
+#if (CV_SIMD_64F || CV_SIMD_SCALABLE_64F)
+	// Widens the bytes of a vector to 32-bit integers, in order, a quarter of the vector in each result.
+	void widenBytes(const cv::v_uint8& bytes, cv::v_int32& first, cv::v_int32& second, cv::v_int32& third, cv::v_int32& fourth)
+	{
+		cv::v_uint16 low, high;
+		cv::v_expand(bytes, low, high);
+
+		cv::v_uint32 a, b, c, d;
+		cv::v_expand(low, a, b);
+		cv::v_expand(high, c, d);
+
+		first = cv::v_reinterpret_as_s32(a);
+		second = cv::v_reinterpret_as_s32(b);
+		third = cv::v_reinterpret_as_s32(c);
+		fourth = cv::v_reinterpret_as_s32(d);
+	}
+
+	// Narrows 4 quarters of 32-bit integers in [0, 255] back to one vector of bytes.
+	cv::v_uint8 narrowWords(const cv::v_int32& first, const cv::v_int32& second, const cv::v_int32& third, const cv::v_int32& fourth)
+	{
+		return cv::v_pack(cv::v_pack_u(first, second), cv::v_pack_u(third, fourth));
+	}
+#endif
+
+	// Converts a row of BGR pixels to HSV. The vector path repeats the double precision operations of the scalar loop in the
+	// same order, with the branches turned into selections, so both write the same bytes for every colour.
+	void BGR2HSVRow(const uchar* src, uchar* dst, const int& cols, const ColourTables& tables)
+	{
+		int x = 0;
+
+#if (CV_SIMD_64F || CV_SIMD_SCALABLE_64F)
+		const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+		const cv::v_float64 zero = cv::vx_setzero_f64(), two = cv::vx_setall_f64(2.0), sixty = cv::vx_setall_f64(60.0), scale = cv::vx_setall_f64(255.0);
+		const cv::v_float64 redOffset = cv::vx_setall_f64(360.0), greenOffset = cv::vx_setall_f64(120.0), blueOffset = cv::vx_setall_f64(240.0);
+
+		// Converts the pixels of a vector of doubles, returning their hue, saturation and value in the low half of each result.
+		auto convert = [&](const cv::v_float64& b, const cv::v_float64& g, const cv::v_float64& r, cv::v_int32& h, cv::v_int32& s, cv::v_int32& v)
+			{
+				cv::v_float64 max = cv::v_max(b, cv::v_max(g, r));
+				cv::v_float64 min = cv::v_min(b, cv::v_min(g, r));
+				cv::v_float64 maxIsRed = cv::v_eq(max, r), maxIsGreen = cv::v_eq(max, g);
+
+				cv::v_float64 normalizedB = cv::v_div(b, scale), normalizedG = cv::v_div(g, scale), normalizedR = cv::v_div(r, scale);
+				cv::v_float64 normalizedMax = cv::v_div(max, scale);
+				cv::v_float64 difference = cv::v_sub(normalizedMax, cv::v_div(min, scale));
+
+				cv::v_float64 numerator = cv::v_select(maxIsRed, cv::v_sub(normalizedG, normalizedB),
+					cv::v_select(maxIsGreen, cv::v_sub(normalizedB, normalizedR), cv::v_sub(normalizedR, normalizedG)));
+				cv::v_float64 offset = cv::v_select(maxIsRed, redOffset, cv::v_select(maxIsGreen, greenOffset, blueOffset));
+
+				// Only the hues of red maxima can reach 360, and grey pixels divide by a zero difference, so both are fixed afterwards.
+				cv::v_float64 hue = cv::v_add(cv::v_mul(sixty, cv::v_div(numerator, difference)), offset);
+				hue = cv::v_sub(hue, cv::v_and(cv::v_ge(hue, redOffset), redOffset));
+				hue = cv::v_select(cv::v_eq(max, min), zero, hue);
+
+				cv::v_float64 saturation = cv::v_select(cv::v_eq(max, zero), zero, cv::v_mul(cv::v_div(difference, normalizedMax), scale));
+
+				h = cv::v_trunc(cv::v_div(hue, two));
+				s = cv::v_trunc(saturation);
+				v = cv::v_trunc(cv::v_mul(normalizedMax, scale));
+			};
+
+		// Converts a quarter of the pixels of a vector, widened to 32-bit integers, as two vectors of doubles.
+		auto convertQuarter = [&](const cv::v_int32& b, const cv::v_int32& g, const cv::v_int32& r, cv::v_int32& h, cv::v_int32& s, cv::v_int32& v)
+			{
+				cv::v_int32 lowH, lowS, lowV, highH, highS, highV;
+				convert(cv::v_cvt_f64(b), cv::v_cvt_f64(g), cv::v_cvt_f64(r), lowH, lowS, lowV);
+				convert(cv::v_cvt_f64_high(b), cv::v_cvt_f64_high(g), cv::v_cvt_f64_high(r), highH, highS, highV);
+
+				h = cv::v_combine_low(lowH, highH);
+				s = cv::v_combine_low(lowS, highS);
+				v = cv::v_combine_low(lowV, highV);
+			};
+
+		for (; x <= cols - lanes; x += lanes)
+		{
+			cv::v_uint8 blue, green, red;
+			cv::v_load_deinterleave(src + x * 3, blue, green, red);
+
+			cv::v_int32 b0, b1, b2, b3, g0, g1, g2, g3, r0, r1, r2, r3;
+			widenBytes(blue, b0, b1, b2, b3);
+			widenBytes(green, g0, g1, g2, g3);
+			widenBytes(red, r0, r1, r2, r3);
+
+			cv::v_int32 h0, h1, h2, h3, s0, s1, s2, s3, v0, v1, v2, v3;
+			convertQuarter(b0, g0, r0, h0, s0, v0);
+			convertQuarter(b1, g1, r1, h1, s1, v1);
+			convertQuarter(b2, g2, r2, h2, s2, v2);
+			convertQuarter(b3, g3, r3, h3, s3, v3);
+
+			cv::v_store_interleave(dst + x * 3, narrowWords(h0, h1, h2, h3), narrowWords(s0, s1, s2, s3), narrowWords(v0, v1, v2, v3));
+		}
+#endif
+		for (; x < cols; x++)
+		{
+			int b = src[x * 3];
+			int g = src[x * 3 + 1];
+			int r = src[x * 3 + 2];
+
+			int max = std::max(b, std::max(g, r));
+			int min = std::min(b, std::min(g, r));
+
+			double h = 0;
+			if (max != min)
+			{
+				double difference = tables.normalized[max] - tables.normalized[min];
+
+				if (max == r)
+				{
+					h = 60 * ((tables.normalized[g] - tables.normalized[b]) / difference) + 360;
+					if (h >= 360)
+						h -= 360;
+				}
+				else if (max == g)
+					h = 60 * ((tables.normalized[b] - tables.normalized[r]) / difference) + 120;
+				else
+					h = 60 * ((tables.normalized[r] - tables.normalized[g]) / difference) + 240;
+			}
+
+			dst[x * 3] = static_cast<uchar>(h / 2);
+			dst[x * 3 + 1] = tables.saturation[max * 256 + min];
+			dst[x * 3 + 2] = tables.value[max];
+		}
+	}
+
+	// Converts a row of HSV pixels to BGR, with the same exactness as BGR2HSVRow. The sector switch of the scalar loop becomes
+	// a chain of selections on the sector of every hue.
+	void HSV2BGRRow(const uchar* src, uchar* dst, const int& cols, const ColourTables& tables)
+	{
+		int x = 0;
+
+#if (CV_SIMD_64F || CV_SIMD_SCALABLE_64F)
+		const int lanes = cv::VTraits<cv::v_uint8>::vlanes(), doubleLanes = cv::VTraits<cv::v_float64>::vlanes();
+		const cv::v_float64 zero = cv::vx_setzero_f64(), scale = cv::vx_setall_f64(255.0);
+		const cv::v_float64 sector1 = cv::vx_setall_f64(1.0), sector2 = cv::vx_setall_f64(2.0), sector3 = cv::vx_setall_f64(3.0);
+		const cv::v_float64 sector4 = cv::vx_setall_f64(4.0), sector5 = cv::vx_setall_f64(5.0);
+
+		// Converts the pixels of a vector of doubles, whose hues are read from the table indices, returning their blue, green
+		// and red in the low half of each result.
+		auto convert = [&](const int* hues, const cv::v_float64& sector, const cv::v_float64& saturation, const cv::v_float64& value,
+			cv::v_int32& b, cv::v_int32& g, cv::v_int32& r)
+			{
+				cv::v_float64 s = cv::v_div(saturation, scale), v = cv::v_div(value, scale);
+
+				cv::v_float64 chroma = cv::v_mul(s, v);
+				cv::v_float64 secondaryComponent = cv::v_mul(chroma, cv::v_lut(tables.hueTerm, hues));
+				cv::v_float64 valueAdjustment = cv::v_sub(v, chroma);
+
+				cv::v_float64 from1 = cv::v_ge(sector, sector1), from2 = cv::v_ge(sector, sector2), from3 = cv::v_ge(sector, sector3);
+				cv::v_float64 from4 = cv::v_ge(sector, sector4), from5 = cv::v_ge(sector, sector5);
+
+				cv::v_float64 blue = cv::v_select(from5, secondaryComponent, cv::v_select(from3, chroma, cv::v_select(from2, secondaryComponent, zero)));
+				cv::v_float64 green = cv::v_select(from4, zero, cv::v_select(from3, secondaryComponent, cv::v_select(from1, chroma, secondaryComponent)));
+				cv::v_float64 red = cv::v_select(from5, chroma, cv::v_select(from4, secondaryComponent,
+					cv::v_select(from2, zero, cv::v_select(from1, secondaryComponent, chroma))));
+
+				b = cv::v_trunc(cv::v_mul(cv::v_add(blue, valueAdjustment), scale));
+				g = cv::v_trunc(cv::v_mul(cv::v_add(green, valueAdjustment), scale));
+				r = cv::v_trunc(cv::v_mul(cv::v_add(red, valueAdjustment), scale));
+			};
+
+		// Converts a quarter of the pixels of a vector, widened to 32-bit integers, as two vectors of doubles.
+		auto convertQuarter = [&](const cv::v_int32& h, const cv::v_int32& s, const cv::v_int32& v, cv::v_int32& b, cv::v_int32& g, cv::v_int32& r)
+			{
+				int hues[cv::VTraits<cv::v_int32>::max_nlanes];
+				cv::v_store(hues, h);
+				cv::v_int32 sectors = cv::v_lut(tables.hueSector, hues);
+
+				cv::v_int32 lowB, lowG, lowR, highB, highG, highR;
+				convert(hues, cv::v_cvt_f64(sectors), cv::v_cvt_f64(s), cv::v_cvt_f64(v), lowB, lowG, lowR);
+				convert(hues + doubleLanes, cv::v_cvt_f64_high(sectors), cv::v_cvt_f64_high(s), cv::v_cvt_f64_high(v), highB, highG, highR);
+
+				b = cv::v_combine_low(lowB, highB);
+				g = cv::v_combine_low(lowG, highG);
+				r = cv::v_combine_low(lowR, highR);
+			};
+
+		for (; x <= cols - lanes; x += lanes)
+		{
+			cv::v_uint8 hue, saturation, value;
+			cv::v_load_deinterleave(src + x * 3, hue, saturation, value);
+
+			cv::v_int32 h0, h1, h2, h3, s0, s1, s2, s3, v0, v1, v2, v3;
+			widenBytes(hue, h0, h1, h2, h3);
+			widenBytes(saturation, s0, s1, s2, s3);
+			widenBytes(value, v0, v1, v2, v3);
+
+			cv::v_int32 b0, b1, b2, b3, g0, g1, g2, g3, r0, r1, r2, r3;
+			convertQuarter(h0, s0, v0, b0, g0, r0);
+			convertQuarter(h1, s1, v1, b1, g1, r1);
+			convertQuarter(h2, s2, v2, b2, g2, r2);
+			convertQuarter(h3, s3, v3, b3, g3, r3);
+
+			cv::v_store_interleave(dst + x * 3, narrowWords(b0, b1, b2, b3), narrowWords(g0, g1, g2, g3), narrowWords(r0, r1, r2, r3));
+		}
+#endif
+		for (; x < cols; x++)
+		{
+			int h = src[x * 3];
+			double s = tables.normalized[src[x * 3 + 1]];
+			double v = tables.normalized[src[x * 3 + 2]];
+
+			double chroma = s * v;
+			double secondaryComponent = chroma * tables.hueTerm[h];
+			double valueAdjustment = v - chroma;
+
+			double b, g, r;
+			switch (tables.hueSector[h])
+			{
+			case 0:
+				b = 0;
+				g = secondaryComponent;
+				r = chroma;
+				break;
+			case 1:
+				b = 0;
+				g = chroma;
+				r = secondaryComponent;
+				break;
+			case 2:
+				r = 0;
+				g = chroma;
+				b = secondaryComponent;
+				break;
+			case 3:
+				b = chroma;
+				g = secondaryComponent;
+				r = 0;
+				break;
+			case 4:
+				b = chroma;
+				g = 0;
+				r = secondaryComponent;
+				break;
+			default:
+				b = secondaryComponent;
+				g = 0;
+				r = chroma;
+				break;
+			}
+
+			dst[x * 3] = static_cast<uchar>((b + valueAdjustment) * 255);
+			dst[x * 3 + 1] = static_cast<uchar>((g + valueAdjustment) * 255);
+			dst[x * 3 + 2] = static_cast<uchar>((r + valueAdjustment) * 255);
+		}
+	}
+}
+
+std::atomic<int> Algorithm::ocrCalls(0);
 
 void Algorithm::BGR2HSV(const cv::Mat& src, cv::Mat& dst)
 {
 	if (src.empty() || src.type() != CV_8UC3)
 		return;
 
-	dst = cv::Mat(src.size(), CV_8UC3);
+	dst.create(src.size(), CV_8UC3);
 
-	for (int y = 0; y < src.rows; y++)
-		for (int x = 0; x < src.cols; x++)
+	const ColourTables& tables = colourTables();
+
+	parallelRows(src.rows, src.cols, [&](const cv::Range& band)
 		{
-			double b = src.ptr<uchar>(y, x)[0] / 255.0;
-			double g = src.ptr<uchar>(y, x)[1] / 255.0;
-			double r = src.ptr<uchar>(y, x)[2] / 255.0;
-
-			double max = std::max(b, std::max(g, r));
-			double min = std::min(b, std::min(g, r));
-			double difference = max - min;
-			double h, s;
-
-			if (max == min)
-				h = 0;
-			else if (max == r)
-				h = fmod(60 * ((g - b) / difference) + 360, 360) / 2;
-			else if (max == g)
-				h = fmod(60 * ((b - r) / difference) + 120, 360) / 2;
-			else if (max == b)
-				h = fmod(60 * ((r - g) / difference) + 240, 360) / 2;
-
-			if (max == 0)
-				s = 0;
-			else
-				s = (difference / max) * 255;
-
-			double v = max * 255;
-
-			dst.ptr<uchar>(y, x)[0] = h;
-			dst.ptr<uchar>(y, x)[1] = s;
-			dst.ptr<uchar>(y, x)[2] = v;
-		}
+			for (int y = band.start; y < band.end; y++)
+				BGR2HSVRow(src.ptr<uchar>(y), dst.ptr<uchar>(y), src.cols, tables);
+		});
 }
 
 void Algorithm::HSV2Binary(const cv::Mat& src, cv::Mat& dst, const uchar& threshold)
@@ -46,12 +413,92 @@ void Algorithm::HSV2Binary(const cv::Mat& src, cv::Mat& dst, const uchar& thresh
 	if (src.empty() || src.type() != CV_8UC3)
 		return;
 
-	dst = cv::Mat::zeros(src.size(), CV_8UC1);
+	dst.create(src.size(), CV_8UC1);
+	dst.setTo(0);
 
-	for (int y = 0; y < src.rows; y++)
-		for (int x = 0; x < src.cols; x++)
-			if (src.ptr<uchar>(y, x)[1] < threshold && src.ptr<uchar>(y, x)[2] > threshold)
-				dst.ptr<uchar>(y, x)[0] = 255;
+	parallelRows(src.rows, src.cols, [&](const cv::Range& band)
+		{
+			for (int y = band.start; y < band.end; y++)
+			{
+				const uchar* srcRow = src.ptr<uchar>(y);
+				uchar* dstRow = dst.ptr<uchar>(y);
+
+				int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+				const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+				cv::v_uint8 thresholds = cv::vx_setall_u8(threshold);
+
+				for (; x <= src.cols - lanes; x += lanes)
+				{
+					cv::v_uint8 h, s, v;
+					cv::v_load_deinterleave(srcRow + x * 3, h, s, v);
+					cv::v_store(dstRow + x, cv::v_and(cv::v_lt(s, thresholds), cv::v_gt(v, thresholds)));
+				}
+#endif
+				for (; x < src.cols; x++)
+					if (srcRow[x * 3 + 1] < threshold && srcRow[x * 3 + 2] > threshold)
+						dstRow[x] = 255;
+			}
+		});
+}
+
+void Algorithm::BGR2Binary(const cv::Mat& src, cv::Mat& dst, const uchar& threshold)
+{
+	if (src.empty() || src.type() != CV_8UC3)
+		return;
+
+	dst.create(src.size(), CV_8UC1);
+	dst.setTo(0);
+
+	const ColourTables& tables = colourTables();
+
+	std::array<int, 256> lowerBounds;
+	for (int max = 0; max < 256; max++)
+	{
+		lowerBounds[max] = 256;
+
+		if (tables.value[max] <= threshold)
+			continue;
+
+		const uchar* saturation = tables.saturation + max * 256;
+		lowerBounds[max] = static_cast<int>(std::partition_point(saturation, saturation + max + 1, [&threshold](const uchar& value)
+			{
+				return value >= threshold;
+			}) - saturation);
+	}
+
+	parallelRows(src.rows, src.cols, [&](const cv::Range& band)
+		{
+			std::vector<uchar> maxRow(src.cols), minRow(src.cols);
+
+			for (int y = band.start; y < band.end; y++)
+			{
+				const uchar* srcRow = src.ptr<uchar>(y);
+				uchar* dstRow = dst.ptr<uchar>(y);
+
+				int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+				const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+
+				for (; x <= src.cols - lanes; x += lanes)
+				{
+					cv::v_uint8 b, g, r;
+					cv::v_load_deinterleave(srcRow + x * 3, b, g, r);
+					cv::v_store(maxRow.data() + x, cv::v_max(b, cv::v_max(g, r)));
+					cv::v_store(minRow.data() + x, cv::v_min(b, cv::v_min(g, r)));
+				}
+#endif
+				for (; x < src.cols; x++)
+				{
+					maxRow[x] = std::max(srcRow[x * 3], std::max(srcRow[x * 3 + 1], srcRow[x * 3 + 2]));
+					minRow[x] = std::min(srcRow[x * 3], std::min(srcRow[x * 3 + 1], srcRow[x * 3 + 2]));
+				}
+
+				for (x = 0; x < src.cols; x++)
+					if (minRow[x] >= lowerBounds[maxRow[x]])
+						dstRow[x] = 255;
+			}
+		});
 }
 
 bool compareConnectedComponents(const std::pair<int, int>& a, const std::pair<int, int>& b)
@@ -60,11 +507,16 @@ bool compareConnectedComponents(const std::pair<int, int>& a, const std::pair<in
 }
 
 void Algorithm::getConnectedComponents(const cv::Mat& src, cv::Mat& stats, std::vector<std::pair<int, int>>& areas, const int& newSize)
+{
+	cv::Mat labels, cendtroids;
+	getConnectedComponents(src, labels, stats, cendtroids, areas, newSize);
+}
+
+void Algorithm::getConnectedComponents(const cv::Mat& src, cv::Mat& labels, cv::Mat& stats, cv::Mat& cendtroids, std::vector<std::pair<int, int>>& areas, const int& newSize)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return;
 
-	cv::Mat labels, cendtroids;
 	int size = cv::connectedComponentsWithStats(src, labels, stats, cendtroids);
 
 	for (int i = 1; i < size; i++)
@@ -117,6 +569,87 @@ bool Algorithm::heightBBox(const cv::Rect& roi, const float& min, const float& m
 		roi.height < roi.width * max;
 }
 
+void Algorithm::candidateFeatures(const cv::Mat& src, const cv::Mat& binary, cv::Mat& features, cv::Mat& integral)
+{
+	if (src.empty() || src.type() != CV_8UC3)
+		return;
+
+	if (binary.size() != src.size() || binary.type() != CV_8UC1)
+		return;
+
+	features.create(src.size(), CV_8UC3);
+
+	parallelRows(src.rows, src.cols, [&](const cv::Range& band)
+		{
+			for (int y = band.start; y < band.end; y++)
+			{
+				const uchar* srcRow = src.ptr<uchar>(y);
+				const uchar* binaryRow = binary.ptr<uchar>(y);
+				uchar* featuresRow = features.ptr<uchar>(y);
+
+				for (int x = 0; x < src.cols; x++)
+				{
+					const uchar* pixel = srcRow + x * 3;
+					uchar* feature = featuresRow + x * 3;
+
+					feature[0] = 0;
+					if (x > 0 && x < src.cols - 1)
+					{
+						const uchar* left = pixel - 3;
+						const uchar* right = pixel + 3;
+						int gradient = (right[0] + 2 * right[1] + right[2] - left[0] - 2 * left[1] - left[2]) / 4;
+						feature[0] = std::abs(gradient) > 40;
+					}
+
+					feature[1] = x > 0 && binaryRow[x] != binaryRow[x - 1];
+					feature[2] = pixel[0] >= pixel[2] + 60 && pixel[0] >= pixel[1] + 30;
+				}
+			}
+		});
+
+	cv::integral(features, integral, CV_32S);
+}
+
+bool Algorithm::candidateScore(const cv::Mat& integral, const cv::Rect& roi, const float& fill, float& score)
+{
+	score = 0;
+
+	if (integral.empty() || integral.type() != CV_32SC3)
+		return false;
+
+	if (roi.width <= 0 || roi.height <= 0 || (roi & cv::Rect(0, 0, integral.cols - 1, integral.rows - 1)) != roi)
+		return false;
+
+	auto sum = [&integral](const cv::Rect& rect, const int& channel)
+		{
+			return integral.ptr<cv::Vec3i>(rect.y + rect.height)[rect.x + rect.width][channel] - integral.ptr<cv::Vec3i>(rect.y)[rect.x + rect.width][channel] -
+				integral.ptr<cv::Vec3i>(rect.y + rect.height)[rect.x][channel] + integral.ptr<cv::Vec3i>(rect.y)[rect.x][channel];
+		};
+
+	float edgeDensity = static_cast<float>(sum(roi, 0)) / roi.area();
+
+	// The characters are in the middle of the plate, where every row crosses each of their strokes twice.
+	cv::Rect middle(roi.x, roi.y + roi.height * 3 / 10, roi.width, std::max(roi.height * 2 / 5, 1));
+	float transitions = static_cast<float>(sum(middle, 1)) / middle.height;
+
+	if (edgeDensity < 0.02 || transitions < 6)
+		return false;
+
+	// The blue band is on the left of the plate, and may lie outside the white region of the component.
+	int bandWidth = std::max(roi.width * 3 / 20, 1);
+	cv::Rect band(roi.x - bandWidth, roi.y, bandWidth * 2, roi.height);
+	band &= cv::Rect(0, 0, integral.cols - 1, integral.rows - 1);
+	float blueRatio = band.area() ? static_cast<float>(sum(band, 2)) / band.area() : 0;
+
+	// The plates are about 4.5 times wider than high, but the white region can include the frame of the plate.
+	float aspect = static_cast<float>(roi.width) / roi.height;
+	float aspectScore = aspect < 2 ? aspect / 2 : aspect > 6 ? 6 / aspect : 1;
+
+	score = std::min(edgeDensity / 0.1f, 1.f) + std::min(transitions / 20, 1.f) + std::min(blueRatio / 0.1f, 1.f) / 2 + aspectScore + fill;
+
+	return true;
+}
+
 void Algorithm::paddingRect(const cv::Rect& src, cv::Rect& dst, const float& percentage, const bool& square, const cv::Size& size)
 {
 	if (src.width <= 0 || src.height <= 0)
@@ -168,18 +701,45 @@ void Algorithm::blueToBlack(const cv::Mat& src, cv::Mat& dst)
 	if (src.empty() || src.type() != CV_8UC3)
 		return;
 
-	dst = src.clone();
+	src.copyTo(dst);
 
-	for (int y = 0; y < src.rows; y++)
-		for (int x = 0; x < src.cols; x++)
-			if (src.ptr<uchar>(y, x)[0] > 100 && src.ptr<uchar>(y, x)[0] < 130 &&
-				src.ptr<uchar>(y, x)[1] > 90 && src.ptr<uchar>(y, x)[1] < 230 &&
-				src.ptr<uchar>(y, x)[2] > 110 && src.ptr<uchar>(y, x)[2] < 195)
+	parallelRows(dst.rows, dst.cols, [&](const cv::Range& band)
+		{
+			for (int y = band.start; y < band.end; y++)
 			{
-				dst.ptr<uchar>(y, x)[0] = 0;
-				dst.ptr<uchar>(y, x)[1] = 0;
-				dst.ptr<uchar>(y, x)[2] = 0;
+				uchar* row = dst.ptr<uchar>(y);
+
+				int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+				const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+				cv::v_uint8 zero = cv::vx_setzero_u8();
+
+				for (; x <= dst.cols - lanes; x += lanes)
+				{
+					cv::v_uint8 h, s, v;
+					cv::v_load_deinterleave(row + x * 3, h, s, v);
+
+					cv::v_uint8 mask = cv::v_and(cv::v_gt(h, cv::vx_setall_u8(100)), cv::v_lt(h, cv::vx_setall_u8(130)));
+					mask = cv::v_and(mask, cv::v_and(cv::v_gt(s, cv::vx_setall_u8(90)), cv::v_lt(s, cv::vx_setall_u8(230))));
+					mask = cv::v_and(mask, cv::v_and(cv::v_gt(v, cv::vx_setall_u8(110)), cv::v_lt(v, cv::vx_setall_u8(195))));
+
+					cv::v_store_interleave(row + x * 3, cv::v_select(mask, zero, h), cv::v_select(mask, zero, s), cv::v_select(mask, zero, v));
+				}
+#endif
+				for (; x < dst.cols; x++)
+				{
+					uchar* pixel = row + x * 3;
+					if (pixel[0] > 100 && pixel[0] < 130 &&
+						pixel[1] > 90 && pixel[1] < 230 &&
+						pixel[2] > 110 && pixel[2] < 195)
+					{
+						pixel[0] = 0;
+						pixel[1] = 0;
+						pixel[2] = 0;
+					}
+				}
 			}
+		});
 }
 
 void Algorithm::HSV2BGR(const cv::Mat& src, cv::Mat& dst)
@@ -187,59 +747,15 @@ void Algorithm::HSV2BGR(const cv::Mat& src, cv::Mat& dst)
 	if (src.empty() || src.type() != CV_8UC3)
 		return;
 
-	dst = cv::Mat(src.size(), CV_8UC3);
+	dst.create(src.size(), CV_8UC3);
 
-	for (int y = 0; y < src.rows; y++)
-		for (int x = 0; x < src.cols; x++)
-		{
-			double h = src.ptr<uchar>(y, x)[0];
-			double s = src.ptr<uchar>(y, x)[1] / 255.0;
-			double v = src.ptr<uchar>(y, x)[2] / 255.0;
-
-			double chroma = s * v;
-			double scaledHue = h / 30.0;
-			double secondaryComponent = chroma * (1 - std::abs(fmod(scaledHue, 2) - 1));
-			double valueAdjustment = v - chroma;
-
-			double b, g, r;
-			switch (int(scaledHue))
-			{
-			case 0:
-				b = 0;
-				g = secondaryComponent;
-				r = chroma;
-				break;
-			case 1:
-				b = 0;
-				g = chroma;
-				r = secondaryComponent;
-				break;
-			case 2:
-				r = 0;
-				g = chroma;
-				b = secondaryComponent;
-				break;
-			case 3:
-				b = chroma;
-				g = secondaryComponent;
-				r = 0;
-				break;
-			case 4:
-				b = chroma;
-				g = 0;
-				r = secondaryComponent;
-				break;
-			default:
-				b = secondaryComponent;
-				g = 0;
-				r = chroma;
-				break;
-			}
+	const ColourTables& tables = colourTables();
 
-			dst.ptr<uchar>(y, x)[0] = (b + valueAdjustment) * 255;
-			dst.ptr<uchar>(y, x)[1] = (g + valueAdjustment) * 255;
-			dst.ptr<uchar>(y, x)[2] = (r + valueAdjustment) * 255;
-		}
+	parallelRows(src.rows, src.cols, [&](const cv::Range& band)
+		{
+			for (int y = band.start; y < band.end; y++)
+				HSV2BGRRow(src.ptr<uchar>(y), dst.ptr<uchar>(y), src.cols, tables);
+		});
 }
 
 void Algorithm::histogram(const cv::Mat& src, cv::Mat& hist)
@@ -262,7 +778,7 @@ void Algorithm::cumulativeHistogram(const cv::Mat& hist, cv::Mat& cumulvativeHis
 	if (hist.empty() || (hist.type() != CV_32FC1 && hist.type() != CV_8UC1))
 		return;
 
-	cumulvativeHist = cv::Mat(cv::Size(hist.rows, hist.cols), hist.type());
+	cumulvativeHist.create(cv::Size(hist.rows, hist.cols), hist.type());
 
 	float sum = 0;
 	for (int i = 0; i < hist.rows; i++)
@@ -315,18 +831,21 @@ float Algorithm::distance(const float& x, const float& y, const cv::Vec4f& line)
 	return abs((a * x + b * y + c) / sqrt(a * a + b * b));
 }
 
-void Algorithm::triangleThresholding(const cv::Mat& src, cv::Mat& dst)
+void Algorithm::triangleThresholding(const cv::Mat& src, cv::Mat& dst, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || (src.type() != CV_32FC1 && src.type() != CV_8UC1))
 		return;
 
-	cv::Mat floatSrc;
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
+
+	cv::Mat& floatSrc = scratch.floatSrc;
 	src.convertTo(floatSrc, CV_32F);
 
-	cv::Mat hist;
+	cv::Mat& hist = scratch.hist;
 	histogram(floatSrc, hist);
 
-	cv::Mat cumulvativeHist;
+	cv::Mat& cumulvativeHist = scratch.cumulativeHist;
 	cumulativeHistogram(hist, cumulvativeHist);
 
 	cv::Vec4f line;
@@ -344,23 +863,25 @@ void Algorithm::triangleThresholding(const cv::Mat& src, cv::Mat& dst)
 		}
 	}
 
-	cv::threshold(floatSrc, dst, threshold, 255, cv::THRESH_BINARY);
-	cv::convertScaleAbs(dst, dst);
+	// The float threshold has its own buffer, so that neither image changes its type from one call to the next.
+	cv::threshold(floatSrc, scratch.thresholded, threshold, 255, cv::THRESH_BINARY);
+	cv::convertScaleAbs(scratch.thresholded, dst);
 }
 
-void Algorithm::binarySobel(const cv::Mat& src, cv::Mat& dst, cv::Mat& direction)
+void Algorithm::binarySobel(const cv::Mat& src, cv::Mat& dst, cv::Mat& direction, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return;
 
-	cv::Mat x, y, magnitude;
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
 
-	cv::Sobel(src, x, CV_32F, 1, 0);
-	cv::Sobel(src, y, CV_32F, 0, 1);
+	cv::Sobel(src, scratch.sobelX, CV_32F, 1, 0);
+	cv::Sobel(src, scratch.sobelY, CV_32F, 0, 1);
 
-	cv::cartToPolar(x, y, magnitude, direction, true);
+	cv::cartToPolar(scratch.sobelX, scratch.sobelY, scratch.magnitude, direction, true);
 
-	triangleThresholding(magnitude, dst);
+	triangleThresholding(scratch.magnitude, dst, &scratch);
 }
 
 void Algorithm::nonMaximumSuppression(const cv::Mat& src, cv::Mat& dst, const cv::Mat& directions)
@@ -374,62 +895,81 @@ void Algorithm::nonMaximumSuppression(const cv::Mat& src, cv::Mat& dst, const cv
 	if (src.size() != directions.size())
 		return;
 
-	for (int y = 2; y < src.rows - 2; y++)
-		for (int x = 2; x < src.cols - 2; x++)
+	parallelRows(src.rows, src.cols, [&](const cv::Range& band)
 		{
-			float direction = fmod(directions.ptr<float>(y, x)[0], 180);
-
-			uchar pixel = src.ptr<uchar>(y, x)[0];
-			uchar pixel1, pixel2, pixel3, pixel4;
+			std::vector<uchar> bins(src.cols);
 
-			if ((direction >= 0 && direction < 22.5) || (direction >= 157.5 && direction <= 180))
-			{
-				pixel1 = src.ptr<uchar>(y, x - 1)[0];
-				pixel2 = src.ptr<uchar>(y, x - 2)[0];
-				pixel3 = src.ptr<uchar>(y, x + 1)[0];
-				pixel4 = src.ptr<uchar>(y, x + 2)[0];
-			}
-			else if (direction >= 22.5 && direction < 67.5)
-			{
-				pixel1 = src.ptr<uchar>(y - 1, x - 1)[0];
-				pixel2 = src.ptr<uchar>(y - 2, x - 2)[0];
-				pixel3 = src.ptr<uchar>(y + 1, x + 1)[0];
-				pixel4 = src.ptr<uchar>(y + 2, x + 2)[0];
-			}
-			else if (direction >= 67.5 && direction < 112.5)
-			{
-				pixel1 = src.ptr<uchar>(y - 1, x)[0];
-				pixel2 = src.ptr<uchar>(y - 2, x)[0];
-				pixel3 = src.ptr<uchar>(y + 1, x)[0];
-				pixel4 = src.ptr<uchar>(y + 2, x)[0];
-			}
-			else if (direction >= 112.5 && direction <= 157.5)
+			for (int y = std::max(band.start, 2); y < std::min(band.end, src.rows - 2); y++)
 			{
-				pixel1 = src.ptr<uchar>(y - 1, x + 1)[0];
-				pixel2 = src.ptr<uchar>(y - 2, x + 2)[0];
-				pixel3 = src.ptr<uchar>(y + 1, x - 1)[0];
-				pixel4 = src.ptr<uchar>(y + 2, x - 2)[0];
-			}
+				quantizeDirections(directions.ptr<float>(y), bins.data(), src.cols);
 
-			if (!(pixel < pixel1 || pixel <= pixel2 || pixel <= pixel3 || pixel <= pixel4))
-				dst.ptr<uchar>(y, x)[0] = 255;
-		}
+				const uchar* rows[5];
+				for (int i = 0; i < 5; i++)
+					rows[i] = src.ptr<uchar>(y - 2 + i);
+
+				const uchar* srcRow = rows[2];
+				uchar* dstRow = dst.ptr<uchar>(y);
+
+				int x = 2;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+				const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+
+				// Each direction is tested on the whole vector and the bins select which test applies to each pixel.
+				for (; x <= src.cols - 2 - lanes; x += lanes)
+				{
+					cv::v_uint8 pixel = cv::vx_load(srcRow + x);
+					cv::v_uint8 bin = cv::vx_load(bins.data() + x);
+					cv::v_uint8 maxima = cv::vx_setzero_u8();
+
+					for (int direction = 0; direction < 4; direction++)
+					{
+						const int(*offsets)[2] = suppressionOffsets[direction];
+
+						cv::v_uint8 isMaximum = cv::v_ge(pixel, cv::vx_load(rows[2 + offsets[0][0]] + x + offsets[0][1]));
+						for (int i = 1; i < 4; i++)
+							isMaximum = cv::v_and(isMaximum, cv::v_gt(pixel, cv::vx_load(rows[2 + offsets[i][0]] + x + offsets[i][1])));
+
+						maxima = cv::v_or(maxima, cv::v_and(isMaximum, cv::v_eq(bin, cv::vx_setall_u8(static_cast<uchar>(direction)))));
+					}
+
+					cv::v_store(dstRow + x, cv::v_or(cv::vx_load(dstRow + x), maxima));
+				}
+#endif
+				for (; x < src.cols - 2; x++)
+				{
+					const int(*offsets)[2] = suppressionOffsets[bins[x]];
+					uchar pixel = srcRow[x];
+
+					if (pixel >= rows[2 + offsets[0][0]][x + offsets[0][1]] && pixel > rows[2 + offsets[1][0]][x + offsets[1][1]] &&
+						pixel > rows[2 + offsets[2][0]][x + offsets[2][1]] && pixel > rows[2 + offsets[3][0]][x + offsets[3][1]])
+						dstRow[x] = 255;
+				}
+			}
+		});
 }
 
-void Algorithm::edgeDetection(const cv::Mat& src, cv::Mat& dst)
+void Algorithm::edgeDetection(const cv::Mat& src, cv::Mat& dst, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return;
 
-	cv::Mat sobel, direction;
-	binarySobel(src, sobel, direction);
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
+
+	cv::Mat& sobel = scratch.sobel;
+	cv::Mat& direction = scratch.direction;
+	binarySobel(src, sobel, direction, &scratch);
 
-	cv::Mat morphologicalGradient;
-	cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
-	cv::morphologyEx(src, morphologicalGradient, cv::MORPH_GRADIENT, kernel);
+	// The morphological gradient is the dilation minus the erosion, computed in place of morphologyEx, which allocates its erosion.
+	cv::Mat& morphologicalGradient = scratch.gradient;
+	static const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+	cv::erode(src, scratch.eroded, kernel);
+	cv::dilate(src, morphologicalGradient, kernel);
+	cv::subtract(morphologicalGradient, scratch.eroded, morphologicalGradient);
 
-	cv::Mat binary;
-	triangleThresholding(morphologicalGradient, binary);
+	cv::Mat& binary = scratch.binary;
+	triangleThresholding(morphologicalGradient, binary, &scratch);
 
 	cv::bitwise_or(sobel, binary, binary);
 
@@ -449,10 +989,18 @@ void Algorithm::bitwiseNand(cv::Mat& src, const cv::Mat& edges)
 	if (src.size() != edges.size())
 		return;
 
-	for (int y = 0; y < src.rows; y++)
-		for (int x = 0; x < src.cols; x++)
-			if (src.ptr<uchar>(y, x)[0] && edges.ptr<uchar>(y, x)[0])
-				src.ptr<uchar>(y, x)[0] = 0;
+	parallelRows(src.rows, src.cols, [&](const cv::Range& band)
+		{
+			for (int y = band.start; y < band.end; y++)
+			{
+				uchar* srcRow = src.ptr<uchar>(y);
+				const uchar* edgesRow = edges.ptr<uchar>(y);
+
+				for (int x = 0; x < src.cols; x++)
+					if (srcRow[x] && edgesRow[x])
+						srcRow[x] = 0;
+			}
+		});
 }
 
 void Algorithm::getLargestContour(const std::vector<std::vector<cv::Point>>& contours, std::vector<cv::Point>& largestContour)
@@ -472,7 +1020,7 @@ void Algorithm::getLargestContour(const std::vector<std::vector<cv::Point>>& con
 	}
 }
 
-bool Algorithm::roiContour(const cv::Mat& src, cv::Mat& dst, std::vector<cv::Point>& largestContour, const cv::Mat& edges, const float& percentage)
+bool Algorithm::roiContour(const cv::Mat& src, cv::Mat& dst, std::vector<cv::Point>& largestContour, const cv::Mat& edges, const float& percentage, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return false;
@@ -480,18 +1028,20 @@ bool Algorithm::roiContour(const cv::Mat& src, cv::Mat& dst, std::vector<cv::Poi
 	if (percentage < 0 || percentage > 1)
 		return false;
 
-	cv::Mat otsu;
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
+
+	cv::Mat& otsu = scratch.otsu;
 	cv::threshold(src, otsu, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
 
 	if (!edges.empty())
 	{
-		cv::Mat dilatedEdges;
-		cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(1, 3));
-		cv::dilate(edges, dilatedEdges, kernel);
+		static const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(1, 3));
+		cv::dilate(edges, scratch.dilatedEdges, kernel);
 		bitwiseNand(otsu, edges);
 	}
 
-	std::vector<std::vector<cv::Point>> contours;
+	std::vector<std::vector<cv::Point>>& contours = scratch.contours;
 	cv::findContours(otsu, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
 	getLargestContour(contours, largestContour);
@@ -499,8 +1049,12 @@ bool Algorithm::roiContour(const cv::Mat& src, cv::Mat& dst, std::vector<cv::Poi
 	if (!largestContour.size())
 		return false;
 
-	dst = cv::Mat::zeros(otsu.size(), otsu.type());
-	cv::drawContours(dst, std::vector<std::vector<cv::Point>>{largestContour}, 0, cv::Scalar(255), cv::FILLED);
+	scratch.largestContours.resize(1);
+	scratch.largestContours[0].assign(largestContour.begin(), largestContour.end());
+
+	dst.create(otsu.size(), otsu.type());
+	dst.setTo(0);
+	cv::drawContours(dst, scratch.largestContours, 0, cv::Scalar(255), cv::FILLED);
 
 	cv::Rect bbox = cv::boundingRect(largestContour);
 
@@ -603,11 +1157,8 @@ cv::Vec4i Algorithm::initialTerminalPoints(std::vector<cv::Vec4i>& lines, const
 	return segment;
 }
 
-#ifdef _DEBUG
+template <typename Visualization>
 bool Algorithm::lineSorting(std::vector<cv::Vec4i>& sortedLines, const std::vector<cv::Vec4i>& lines, const cv::Size& size, const cv::Mat& src)
-#else
-bool Algorithm::lineSorting(std::vector<cv::Vec4i>& sortedLines, const std::vector<cv::Vec4i>& lines, const cv::Size& size)
-#endif
 {
 	if (lines.empty())
 		return false;
@@ -668,53 +1219,51 @@ bool Algorithm::lineSorting(std::vector<cv::Vec4i>& sortedLines, const std::vect
 	sortedLines.push_back(initialTerminalPoints(rightLines, 1));
 	sortedLines.push_back(initialTerminalPoints(bottomLines, 0));
 
-#ifdef _DEBUG
-	if (src.empty() || src.type() != CV_8UC1)
-		return true;;
-
-	cv::Mat drawnReferenceLines;
-	cv::cvtColor(src, drawnReferenceLines, cv::COLOR_GRAY2BGR);
-	cv::line(drawnReferenceLines, cv::Point(horizontalLine[0], horizontalLine[1]), cv::Point(horizontalLine[2], horizontalLine[3]), cv::Scalar(0, 255, 0), 2);
-	cv::line(drawnReferenceLines, cv::Point(verticalLine[0], verticalLine[1]), cv::Point(verticalLine[2], verticalLine[3]), cv::Scalar(0, 255, 0), 2);
+	if (!Visualization::enabled || src.empty() || src.type() != CV_8UC1)
+		return true;
 
-	cv::Mat drawnHoughLines;
-	cv::cvtColor(src, drawnHoughLines, cv::COLOR_GRAY2BGR);
-	for (const cv::Vec4i& line : leftLines)
-	{
-		cv::Point start(line[0], line[1]);
-		cv::Point end(line[2], line[3]);
-		cv::line(drawnHoughLines, start, end, cv::Scalar(255, 0, 0), 2);
-	}
-	for (const cv::Vec4i& line : topLines)
-	{
-		cv::Point start(line[0], line[1]);
-		cv::Point end(line[2], line[3]);
-		cv::line(drawnHoughLines, start, end, cv::Scalar(0, 255, 0), 2);
-	}
-	for (const cv::Vec4i& line : rightLines)
-	{
-		cv::Point start(line[0], line[1]);
-		cv::Point end(line[2], line[3]);
-		cv::line(drawnHoughLines, start, end, cv::Scalar(0, 0, 255), 2);
-	}
-	for (const cv::Vec4i& line : bottomLines)
-	{
-		cv::Point start(line[0], line[1]);
-		cv::Point end(line[2], line[3]);
-		cv::line(drawnHoughLines, start, end, cv::Scalar(0, 255, 255), 2);
-	}
+	auto drawLines = [&src](const std::vector<std::pair<cv::Vec4i, cv::Scalar>>& coloredLines)
+		{
+			cv::Mat drawn;
+			cv::cvtColor(src, drawn, cv::COLOR_GRAY2BGR);
+			for (const auto& coloredLine : coloredLines)
+				cv::line(drawn, cv::Point(coloredLine.first[0], coloredLine.first[1]), cv::Point(coloredLine.first[2], coloredLine.first[3]), coloredLine.second, 2);
+			return drawn;
+		};
+
+	Visualization::dump("referenceLines", [&]()
+		{
+			return drawLines({ { horizontalLine, cv::Scalar(0, 255, 0) }, { verticalLine, cv::Scalar(0, 255, 0) } });
+		});
 
-	cv::Mat drawnSortedLines;
-	cv::cvtColor(src, drawnSortedLines, cv::COLOR_GRAY2BGR);
-	cv::line(drawnSortedLines, cv::Point(sortedLines[0][0], sortedLines[0][1]), cv::Point(sortedLines[0][2], sortedLines[0][3]), cv::Scalar(255, 0, 0), 2);
-	cv::line(drawnSortedLines, cv::Point(sortedLines[1][0], sortedLines[1][1]), cv::Point(sortedLines[1][2], sortedLines[1][3]), cv::Scalar(0, 255, 0), 2);
-	cv::line(drawnSortedLines, cv::Point(sortedLines[2][0], sortedLines[2][1]), cv::Point(sortedLines[2][2], sortedLines[2][3]), cv::Scalar(0, 0, 255), 2);
-	cv::line(drawnSortedLines, cv::Point(sortedLines[3][0], sortedLines[3][1]), cv::Point(sortedLines[3][2], sortedLines[3][3]), cv::Scalar(0, 255, 255), 2);
-#endif
+	Visualization::dump("houghLines", [&]()
+		{
+			std::vector<std::pair<cv::Vec4i, cv::Scalar>> coloredLines;
+			const std::array<std::pair<const std::vector<cv::Vec4i>*, cv::Scalar>, 4> sides =
+			{ {
+				{ &leftLines, cv::Scalar(255, 0, 0) },
+				{ &topLines, cv::Scalar(0, 255, 0) },
+				{ &rightLines, cv::Scalar(0, 0, 255) },
+				{ &bottomLines, cv::Scalar(0, 255, 255) }
+			} };
+			for (const auto& side : sides)
+				for (const cv::Vec4i& line : *side.first)
+					coloredLines.push_back(std::make_pair(line, side.second));
+			return drawLines(coloredLines);
+		});
+
+	Visualization::dump("sortedLines", [&]()
+		{
+			return drawLines({ { sortedLines[0], cv::Scalar(255, 0, 0) }, { sortedLines[1], cv::Scalar(0, 255, 0) },
+				{ sortedLines[2], cv::Scalar(0, 0, 255) }, { sortedLines[3], cv::Scalar(0, 255, 255) } });
+		});
 
 	return true;
 }
 
+template bool Algorithm::lineSorting<NoVisualization>(std::vector<cv::Vec4i>&, const std::vector<cv::Vec4i>&, const cv::Size&, const cv::Mat&);
+template bool Algorithm::lineSorting<DumpVisualization>(std::vector<cv::Vec4i>&, const std::vector<cv::Vec4i>&, const cv::Size&, const cv::Mat&);
+
 cv::Point2f Algorithm::intersection(const cv::Vec4i& line1, const cv::Vec4i& line2)
 {
 	if ((line1[0] == line1[2]) && (line1[1] == line1[3]))
@@ -742,7 +1291,8 @@ cv::Point2f Algorithm::intersection(const cv::Vec4i& line1, const cv::Vec4i& lin
 	return cv::Point2f(x, y);
 }
 
-bool Algorithm::cornersCoordinates(const cv::Mat& src, std::vector<cv::Point2f>& quadrilateralCoordinates, const std::vector<cv::Point>& largestContour)
+template <typename Visualization>
+bool Algorithm::cornersCoordinates(const cv::Mat& src, std::vector<cv::Point2f>& quadrilateralCoordinates, const std::vector<cv::Point>& largestContour, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return false;
@@ -750,42 +1300,125 @@ bool Algorithm::cornersCoordinates(const cv::Mat& src, std::vector<cv::Point2f>&
 	if (largestContour.empty())
 		return false;
 
-	cv::Mat erodedRegionContour;
-	cv::erode(src, erodedRegionContour, cv::Mat());
-	cv::Mat edges = src - erodedRegionContour;
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
 
-	cv::RotatedRect rotatedBBox = cv::minAreaRect(largestContour);
-	float minLineLenght = rotatedBBox.size.height * 0.25;
-	float maxLineGap = rotatedBBox.size.height * 0.1;
+	// The convex hull is simplified until only the four corners of the plate remain, then every side is fitted on the contour points
+	// between its corners, leaving out the rounded or cut corners, and the corners are the intersections of the fitted sides.
+	std::vector<cv::Point>& hull = scratch.hull;
+	cv::convexHull(largestContour, hull);
 
-	std::vector<cv::Vec4i> lines;
-	std::vector<cv::Vec4i> sortedLines;
-	do {
-		cv::HoughLinesP(edges, lines, 1, CV_PI / 180, 10, minLineLenght, maxLineGap);
-		minLineLenght--;
+	std::vector<cv::Point>& approximation = scratch.approximation;
+	double epsilon = cv::arcLength(hull, true) * 0.01;
+	for (int i = 0; i < 20; i++)
+	{
+		cv::approxPolyDP(hull, approximation, epsilon, true);
+		if (approximation.size() <= 4)
+			break;
+
+		epsilon *= 1.25;
 	}
-#ifdef _DEBUG
-	while (!lineSorting(sortedLines, lines, src.size(), src) && minLineLenght > 0);
-#else
-	while (!lineSorting(sortedLines, lines, src.size()) && minLineLenght > 0);
-#endif
 
-	if (minLineLenght <= 0)
+	if (approximation.size() != 4)
 		return false;
 
-	for (int i = 0; i < sortedLines.size(); i++)
-		quadrilateralCoordinates.push_back(intersection(sortedLines[i], sortedLines[(i + 1) % 4]));
+	cv::Point2f center;
+	for (const auto& point : approximation)
+		center += cv::Point2f(point) * 0.25f;
 
-#ifdef _DEBUG
-	cv::Mat drawnQuadrilateralCoordinates;
-	cv::cvtColor(src, drawnQuadrilateralCoordinates, cv::COLOR_GRAY2BGR);
-	for (const auto& point : quadrilateralCoordinates)
-		cv::circle(drawnQuadrilateralCoordinates, point, 4, cv::Scalar(0, 0, 255), -1);
-#endif
+	std::vector<cv::Point2f>& corners = scratch.corners;
+	corners.assign(approximation.begin(), approximation.end());
+	std::sort(corners.begin(), corners.end(), [&center](const cv::Point2f& first, const cv::Point2f& second)
+		{
+			return std::atan2(first.y - center.y, first.x - center.x) < std::atan2(second.y - center.y, second.x - center.x);
+		});
+
+	// The sides closest to the horizontal are the top and the bottom, and the corners start with the left end of the top side.
+	auto horizontality = [&corners](const int& i)
+		{
+			cv::Point2f side = corners[(i + 1) % 4] - corners[i];
+			return std::abs(side.x) / std::max(static_cast<float>(cv::norm(side)), std::numeric_limits<float>::epsilon());
+		};
+
+	int top = horizontality(0) + horizontality(2) >= horizontality(1) + horizontality(3) ? 0 : 1;
+	if (corners[top].y + corners[(top + 1) % 4].y > corners[(top + 2) % 4].y + corners[(top + 3) % 4].y)
+		top += 2;
+	std::rotate(corners.begin(), corners.begin() + top, corners.end());
+
+	std::vector<cv::Point2f>& contourPoints = scratch.contourPoints;
+	contourPoints.clear();
+	for (int i = 0; i < largestContour.size(); i++)
+	{
+		cv::Point step = largestContour[(i + 1) % largestContour.size()] - largestContour[i];
+		int count = std::max(std::max(std::abs(step.x), std::abs(step.y)), 1);
+		for (int j = 0; j < count; j++)
+			contourPoints.push_back(cv::Point2f(largestContour[i]) + cv::Point2f(step) * (static_cast<float>(j) / count));
+	}
+
+	std::array<cv::Vec4f, 4> sides;
+	std::vector<cv::Point2f>& sidePoints = scratch.sidePoints;
+	for (int i = 0; i < 4; i++)
+	{
+		cv::Point2f start = corners[i];
+		cv::Point2f side = corners[(i + 1) % 4] - start;
+		float length = cv::norm(side);
+		if (length < 1)
+			return false;
+
+		cv::Point2f direction = side / length;
+		float maxDistance = std::max(2.0f, length * 0.05f);
+
+		sidePoints.clear();
+		for (const auto& point : contourPoints)
+		{
+			float position = (point - start).dot(direction) / length;
+			float distance = std::abs((point - start).cross(direction));
+			if (position > 0.1f && position < 0.9f && distance < maxDistance)
+				sidePoints.push_back(point);
+		}
+
+		if (sidePoints.size() < 2)
+			return false;
+
+		cv::fitLine(sidePoints, sides[i], cv::DIST_HUBER, 0, 0.01, 0.01);
+
+		// The direction of an axis-aligned side comes out with a rounding error, removed so that its corners stay on whole pixels.
+		for (int j = 0; j < 2; j++)
+			if (std::abs(sides[i][j]) < 1e-6f)
+				sides[i][j] = 0;
+	}
+
+	// The sides are top, right, bottom and left, so every corner is the intersection of a side with the previous one.
+	for (int i = 0; i < 4; i++)
+	{
+		const cv::Vec4f& first = sides[(i + 3) % 4];
+		const cv::Vec4f& second = sides[i];
+
+		float determinant = second[0] * first[1] - first[0] * second[1];
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+
+		float position = (second[1] * (second[2] - first[2]) - second[0] * (second[3] - first[3])) / -determinant;
+		corners[i] = cv::Point2f(first[2] + first[0] * position, first[3] + first[1] * position);
+	}
+
+	quadrilateralCoordinates.insert(quadrilateralCoordinates.end(), corners.begin(), corners.end());
+
+	Visualization::dump("quadrilateralCoordinates", [&]()
+		{
+			cv::Mat drawnQuadrilateralCoordinates;
+			cv::cvtColor(src, drawnQuadrilateralCoordinates, cv::COLOR_GRAY2BGR);
+			for (const auto& point : quadrilateralCoordinates)
+				cv::circle(drawnQuadrilateralCoordinates, point, 4, cv::Scalar(0, 0, 255), -1);
+			return drawnQuadrilateralCoordinates;
+		});
 
 	return true;
 }
 
+template bool Algorithm::cornersCoordinates<NoVisualization>(const cv::Mat&, std::vector<cv::Point2f>&, const std::vector<cv::Point>&, AlgorithmBuffers*);
+template bool Algorithm::cornersCoordinates<DumpVisualization>(const cv::Mat&, std::vector<cv::Point2f>&, const std::vector<cv::Point>&, AlgorithmBuffers*);
+
 bool Algorithm::resizeToPoints(const cv::Mat& src, cv::Mat& dst, std::vector<cv::Point2f>& points, const float& percentage)
 {
 	if (src.empty() || src.type() != CV_8UC1)
@@ -852,31 +1485,30 @@ bool Algorithm::geometricalTransformation(const cv::Mat& src, cv::Mat& dst, cons
 	if (height < src.rows * percentage)
 		return false;
 
-	std::vector<cv::Point2f> finalCoordinates;
-	finalCoordinates.push_back(cv::Point2f(0, 0));
-	finalCoordinates.push_back(cv::Point2f(width - 1, 0));
-	finalCoordinates.push_back(cv::Point2f(width - 1, height - 1));
-	finalCoordinates.push_back(cv::Point2f(0, height - 1));
+	const cv::Point2f finalCoordinates[4] = { cv::Point2f(0, 0), cv::Point2f(width - 1, 0), cv::Point2f(width - 1, height - 1), cv::Point2f(0, height - 1) };
 
-	cv::Mat perspectiveTransform = cv::getPerspectiveTransform(quadrilateralCoordinates, finalCoordinates);
+	cv::Mat perspectiveTransform = cv::getPerspectiveTransform(quadrilateralCoordinates.data(), finalCoordinates);
 	cv::warpPerspective(src, dst, perspectiveTransform, cv::Size(width, height));
 
 	return cv::countNonZero(dst);
 }
 
-void Algorithm::insideContour(const cv::Mat& src, cv::Mat& dst)
+void Algorithm::insideContour(const cv::Mat& src, cv::Mat& dst, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return;
 
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
+
 	cv::Rect crop(1, 1, src.cols - 2, src.rows - 2);
 	cv::Mat cropped = src(crop);
 
-	cv::Mat bordered = cropped.clone();
-	cv::copyMakeBorder(bordered, bordered, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(255));
+	cv::Mat& bordered = scratch.bordered;
+	cv::copyMakeBorder(cropped, bordered, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(255));
 
-	cv::threshold(bordered, dst, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
-	dst = 255 - dst;
+	// The inverted threshold gives the same image as inverting the thresholded one, without a temporary.
+	cv::threshold(bordered, dst, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
 }
 
 int Algorithm::getContourHeight(const std::vector<cv::Point>& contour)
@@ -901,12 +1533,14 @@ bool Algorithm::compareAreas(const std::vector<cv::Point>& a, const std::vector<
 	return getContourHeight(a) > getContourHeight(b);
 }
 
-int Algorithm::medianHeight(const std::vector<std::vector<cv::Point>>& contours)
+int Algorithm::medianHeight(const std::vector<std::vector<cv::Point>>& contours, AlgorithmBuffers* buffers)
 {
 	if (contours.empty())
 		return 0;
 
-	std::vector<int> heights;
+	AlgorithmBuffers ownBuffers;
+	std::vector<int>& heights = (buffers ? *buffers : ownBuffers).heights;
+	heights.clear();
 	for (const auto& contour : contours)
 		heights.push_back(getContourHeight(contour));
 
@@ -914,7 +1548,7 @@ int Algorithm::medianHeight(const std::vector<std::vector<cv::Point>>& contours)
 	return heights[heights.size() / 2];
 }
 
-bool Algorithm::denoise(const cv::Mat& src, cv::Mat& dst, const float& percentage)
+bool Algorithm::denoise(const cv::Mat& src, cv::Mat& dst, const float& percentage, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return false;
@@ -922,14 +1556,17 @@ bool Algorithm::denoise(const cv::Mat& src, cv::Mat& dst, const float& percentag
 	if (percentage < 0 || percentage > 1)
 		return false;
 
-	std::vector<std::vector<cv::Point>> contours;
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
+
+	std::vector<std::vector<cv::Point>>& contours = scratch.contours;
 	cv::findContours(src, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 	std::sort(contours.begin(), contours.end(), compareAreas);
 
 	if (contours.size() > 8)
 		contours.resize(8);
 
-	int median = medianHeight(contours);
+	int median = medianHeight(contours, &scratch);
 
 	for (int i = 0; i < contours.size(); i++)
 	{
@@ -944,13 +1581,15 @@ bool Algorithm::denoise(const cv::Mat& src, cv::Mat& dst, const float& percentag
 	if (contours.size() < 6)
 		return false;
 
-	cv::Mat contoursRegion = cv::Mat::zeros(src.size(), src.type());
-	for (const auto& contour : contours)
-		cv::drawContours(contoursRegion, std::vector<std::vector<cv::Point>>{contour}, 0, cv::Scalar(255), cv::FILLED);
+	cv::Mat& contoursRegion = scratch.contoursRegion;
+	contoursRegion.create(src.size(), src.type());
+	contoursRegion.setTo(0);
+	for (int i = 0; i < contours.size(); i++)
+		cv::drawContours(contoursRegion, contours, i, cv::Scalar(255), cv::FILLED);
 
 	src.copyTo(dst, contoursRegion);
 
-	std::vector<std::vector<cv::Point>> deletedContours;
+	std::vector<std::vector<cv::Point>>& deletedContours = scratch.deletedContours;
 	cv::findContours(dst, deletedContours, cv::RETR_CCOMP, cv::CHAIN_APPROX_SIMPLE);
 
 	if (deletedContours.size() == contours.size())
@@ -965,14 +1604,14 @@ bool Algorithm::denoise(const cv::Mat& src, cv::Mat& dst, const float& percentag
 				break;
 			}
 
-	for (const auto& contour : deletedContours)
+	for (int i = 0; i < deletedContours.size(); i++)
 	{
-		bool isWhite = dst.ptr<uchar>(contour[0].y, contour[0].x)[0];
+		bool isWhite = dst.ptr<uchar>(deletedContours[i][0].y, deletedContours[i][0].x)[0];
 
-		cv::drawContours(dst, std::vector<std::vector<cv::Point>>{contour}, 0, cv::Scalar(0), cv::FILLED);
+		cv::drawContours(dst, deletedContours, i, cv::Scalar(0), cv::FILLED);
 
 		if (isWhite)
-			cv::drawContours(dst, std::vector<std::vector<cv::Point>>{contour}, 0, cv::Scalar(255));
+			cv::drawContours(dst, deletedContours, i, cv::Scalar(255));
 	}
 
 	return cv::countNonZero(dst);
@@ -983,21 +1622,24 @@ bool compareX(const cv::Rect& a, const cv::Rect& b)
 	return a.x < b.x;
 }
 
-void Algorithm::charsBBoxes(const cv::Mat& src, std::vector<cv::Rect>& chars)
+void Algorithm::charsBBoxes(const cv::Mat& src, std::vector<cv::Rect>& chars, AlgorithmBuffers* buffers)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return;
 
-	cv::Mat stats;
-	std::vector<std::pair<int, int>> areas;
-	Algorithm::getConnectedComponents(src, stats, areas);
+	AlgorithmBuffers ownBuffers;
+	AlgorithmBuffers& scratch = buffers ? *buffers : ownBuffers;
+
+	std::vector<std::pair<int, int>>& areas = scratch.areas;
+	areas.clear();
+	Algorithm::getConnectedComponents(src, scratch.labels, scratch.stats, scratch.centroids, areas);
 
 	for (const auto& area : areas)
 	{
 		cv::Rect roi;
 		int label = area.first;
 
-		Algorithm::getRoi(stats, roi, label);
+		Algorithm::getRoi(scratch.stats, roi, label);
 		chars.push_back(roi);
 	}
 
@@ -1055,20 +1697,6 @@ void Algorithm::charsSpacing(const cv::Mat& src, cv::Mat& dst, const std::vector
 	if (chars.empty() || paddedChars.empty() || chars.size() != paddedChars.size())
 		return;
 
-	std::vector<cv::Mat> ROIs;
-	for (int i = 0; i < chars.size(); i++)
-	{
-		cv::Mat roi = src(chars[i]).clone();
-
-		int padding = (paddedChars[i].width - chars[i].width) / 2;
-		int extraPadding = (paddedChars[i].width - chars[i].width) % 2;
-
-		cv::Mat paddedRoi;
-		cv::copyMakeBorder(roi, paddedRoi, padding, padding + extraPadding, padding, padding + extraPadding, cv::BORDER_CONSTANT);
-
-		ROIs.push_back(paddedRoi);
-	}
-
 	int height = 0;
 	for (const auto& rect : paddedChars)
 		height = std::max(height, rect.height);
@@ -1081,22 +1709,22 @@ void Algorithm::charsSpacing(const cv::Mat& src, cv::Mat& dst, const std::vector
 		width += rect.width;
 	}
 
-	dst = cv::Mat::zeros(cv::Size(width + 1, height + 1), src.type());
+	dst.create(cv::Size(width + 1, height + 1), src.type());
+	dst.setTo(0);
 
+	// Every character is copied inside its padded box, whose border stays black, instead of copying a padded clone of it.
 	for (int i = 0; i < paddedChars.size(); i++)
 	{
-		if (!ROIs[i].cols || !ROIs[i].rows)
+		if (chars[i].empty())
 			continue;
 
-		cv::Rect rect(paddedChars[i].x, paddedChars[i].y, ROIs[i].cols, ROIs[i].rows);
-		ROIs[i].copyTo(dst(rect));
+		int padding = (paddedChars[i].width - chars[i].width) / 2;
+
+		cv::Rect rect(paddedChars[i].x + padding, paddedChars[i].y + padding, chars[i].width, chars[i].height);
+		src(chars[i]).copyTo(dst(rect));
 	}
 }
-#ifdef _DEBUG
-void Algorithm::wordsSeparation(const std::vector<cv::Rect>& chars, std::array<std::vector<cv::Rect>, 3>& words, const std::array<int, 3>& indexes, const cv::Mat src)
-#else
 void Algorithm::wordsSeparation(const std::vector<cv::Rect>& chars, std::array<std::vector<cv::Rect>, 3>& words, const std::array<int, 3>& indexes)
-#endif
 {
 	if (chars.empty())
 		return;
@@ -1110,48 +1738,24 @@ void Algorithm::wordsSeparation(const std::vector<cv::Rect>& chars, std::array<s
 	words[0].insert(words[0].end(), chars.begin(), chars.begin() + indexes[1]);
 	words[1].insert(words[1].end(), chars.begin() + indexes[1], chars.begin() + indexes[2]);
 	words[2].insert(words[2].end(), chars.begin() + indexes[2], chars.end());
-
-#ifdef _DEBUG
-	if (src.empty() || src.type() != CV_8UC1)
-		return;
-
-	cv::Mat drawnChars;
-	cv::cvtColor(src, drawnChars, cv::COLOR_GRAY2BGR);
-	for (const auto& character : words[0])
-		cv::rectangle(drawnChars, character, cv::Scalar(255, 0, 0), 2);
-	for (const auto& character : words[1])
-		cv::rectangle(drawnChars, character, cv::Scalar(0, 255, 0), 2);
-	for (const auto& character : words[2])
-		cv::rectangle(drawnChars, character, cv::Scalar(0, 0, 255), 2);
-#endif
-}
-
-tesseract::TessBaseAPI& Algorithm::getTessInstance()
-{
-	static tesseract::TessBaseAPI tess;
-	static bool isInitialized = false;
-
-	if (!isInitialized)
-	{
-		tess.Init(NULL, "DIN1451Mittelschrift", tesseract::OEM_LSTM_ONLY);
-		isInitialized = true;
-	}
-
-	return tess;
 }
 
 bool Algorithm::verifyOutputText(tesseract::TessBaseAPI& tess, float& confidence)
 {
-	if (!tess.GetUTF8Text())
+	ocrCalls++;
+	std::unique_ptr<char[]> result(tess.GetUTF8Text());
+	if (!result)
 		return false;
 
-	std::string text = tess.GetUTF8Text();
+	std::string text = result.get();
 
 	if (text.size() != 2)
 		return false;
 
-	tess.Recognize(0);
-	tesseract::ResultIterator* iterator = tess.GetIterator();
+	std::unique_ptr<tesseract::ResultIterator> iterator(tess.GetIterator());
+	if (!iterator)
+		return false;
+
 	confidence = confidence + iterator->Confidence(tesseract::RIL_SYMBOL);
 
 	return true;
@@ -1190,6 +1794,44 @@ bool Algorithm::resizeCharTemplate(const cv::Mat& src, cv::Mat& dst, const cv::S
 	return true;
 }
 
+bool Algorithm::charTemplate(const cv::Size& size, cv::Mat& dst)
+{
+	static std::mutex mutex;
+	static cv::Mat original;
+	static std::map<int, cv::Mat> resizedTemplates;
+
+	if (size.width < 3 || size.height < 3)
+		return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// A template that could not be read is read again on the next call, as it was before the template was cached.
+	if (original.empty())
+	{
+		original = cv::imread("../../../assets/i.jpg", cv::IMREAD_GRAYSCALE);
+
+		if (original.empty())
+			original = cv::imread("assets/i.jpg", cv::IMREAD_GRAYSCALE);
+
+		if (original.empty())
+			return false;
+	}
+
+	auto resizedTemplate = resizedTemplates.find(size.height);
+	if (resizedTemplate == resizedTemplates.end())
+	{
+		cv::Mat resizedCharTemplate;
+		if (!resizeCharTemplate(original, resizedCharTemplate, size))
+			return false;
+
+		resizedTemplate = resizedTemplates.emplace(size.height, resizedCharTemplate).first;
+	}
+
+	dst = resizedTemplate->second;
+
+	return true;
+}
+
 void Algorithm::padding(const int& firstSize, const int& secondSize, int& firstPadding, int& secondPadding)
 {
 	if (firstSize < 0 && secondSize < 0)
@@ -1212,13 +1854,8 @@ bool Algorithm::matching(const cv::Mat& src, float& dice, const float& percentag
 	if (percentage < 0)
 		return false;
 
-	cv::Mat charTemplate = cv::imread("../../../assets/i.jpg", cv::IMREAD_GRAYSCALE);
-
-	if (charTemplate.empty())
-		charTemplate = cv::imread("assets/i.jpg", cv::IMREAD_GRAYSCALE);
-
 	cv::Mat resizedCharTemplate;
-	if (!resizeCharTemplate(charTemplate, resizedCharTemplate, src.size()))
+	if (!charTemplate(src.size(), resizedCharTemplate))
 		return false;
 
 	int width = std::max(src.cols, resizedCharTemplate.cols);
@@ -1230,22 +1867,86 @@ bool Algorithm::matching(const cv::Mat& src, float& dice, const float& percentag
 	int paddingLeft, paddingRight;
 	padding(size.width, resizedCharTemplate.cols, paddingLeft, paddingRight);
 
-	cv::copyMakeBorder(resizedCharTemplate, resizedCharTemplate, paddingTop, paddingBottom, paddingLeft, paddingRight, cv::BORDER_CONSTANT);
+	cv::Mat paddedCharTemplate;
+	cv::copyMakeBorder(resizedCharTemplate, paddedCharTemplate, paddingTop, paddingBottom, paddingLeft, paddingRight, cv::BORDER_CONSTANT);
 
 	padding(size.width, src.cols, paddingLeft, paddingRight);
 
-	cv::Mat resizedSrc = src.clone();
+	cv::Mat resizedSrc;
 	cv::copyMakeBorder(src, resizedSrc, 0, 0, paddingLeft, paddingRight, cv::BORDER_CONSTANT);
 
-	cv::Mat intersection;
-	cv::bitwise_and(resizedSrc, resizedCharTemplate, intersection);
+	std::vector<uchar> srcBits, charTemplateBits;
+	packBits(resizedSrc, srcBits);
+	packBits(paddedCharTemplate, charTemplateBits);
+
+	int length = static_cast<int>(srcBits.size());
+	int srcCount = cv::hal::normHamming(srcBits.data(), length);
+	int charTemplateCount = cv::hal::normHamming(charTemplateBits.data(), length);
+	int intersection = (srcCount + charTemplateCount - cv::hal::normHamming(srcBits.data(), charTemplateBits.data(), length)) / 2;
 
-	dice = (2.0 * cv::countNonZero(intersection)) / (cv::countNonZero(resizedSrc) + cv::countNonZero(resizedCharTemplate));
+	dice = (2.0 * intersection) / (srcCount + charTemplateCount);
 
 	return dice > percentage;
 }
 
-bool Algorithm::applyTesseract(const cv::Mat& src, std::string& text, const std::vector<cv::Rect>& chars, std::vector<cv::Rect>& paddedChars, const bool& charType, float& confidence)
+bool Algorithm::recognizeWord(tesseract::TessBaseAPI& tess, const cv::Size& size, const std::vector<cv::Rect>& paddedChars, std::vector<std::string>& symbols, std::vector<float>& confidences)
+{
+	symbols.assign(paddedChars.size(), std::string());
+	confidences.assign(paddedChars.size(), -1);
+
+	if (paddedChars.empty())
+		return false;
+
+	cv::Rect word = paddedChars[0];
+	for (const auto& paddedChar : paddedChars)
+		word |= paddedChar;
+	word &= cv::Rect(0, 0, size.width, size.height);
+
+	if (word.empty())
+		return false;
+
+	tess.SetPageSegMode(tesseract::PSM_SINGLE_LINE);
+	tess.SetRectangle(word.x, word.y, word.width, word.height);
+
+	ocrCalls++;
+	if (tess.Recognize(0))
+		return false;
+
+	std::unique_ptr<tesseract::ResultIterator> iterator(tess.GetIterator());
+	if (!iterator)
+		return false;
+
+	std::vector<int> hits(paddedChars.size(), 0);
+	do {
+		std::unique_ptr<char[]> symbol(iterator->GetUTF8Text(tesseract::RIL_SYMBOL));
+		if (!symbol)
+			continue;
+
+		int left, top, right, bottom;
+		if (!iterator->BoundingBox(tesseract::RIL_SYMBOL, &left, &top, &right, &bottom))
+			continue;
+
+		cv::Point center((left + right) / 2, (top + bottom) / 2);
+		for (int i = 0; i < paddedChars.size(); i++)
+		{
+			if (!paddedChars[i].contains(center))
+				continue;
+
+			hits[i]++;
+			symbols[i] = symbol.get();
+			confidences[i] = iterator->Confidence(tesseract::RIL_SYMBOL);
+			break;
+		}
+	} while (iterator->Next(tesseract::RIL_SYMBOL));
+
+	for (int i = 0; i < hits.size(); i++)
+		if (hits[i] != 1)
+			confidences[i] = -1;
+
+	return true;
+}
+
+bool Algorithm::applyTesseract(const cv::Mat& src, std::string& text, const std::vector<cv::Rect>& chars, std::vector<cv::Rect>& paddedChars, const bool& charType, float& confidence, const RecognitionMode& mode, const float& threshold)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return false;
@@ -1256,32 +1957,29 @@ bool Algorithm::applyTesseract(const cv::Mat& src, std::string& text, const std:
 	if (chars.size() != paddedChars.size())
 		return false;
 
-	tesseract::TessBaseAPI tess;
-	tess.Init(NULL, "DIN1451Mittelschrift", tesseract::OEM_LSTM_ONLY);
-
-	tess.SetVariable("load_bigram_dawg", "false");
-	tess.SetVariable("load_freq_dawg", "false");
-	tess.SetVariable("load_number_dawg", "false");
-	tess.SetVariable("load_punc_dawg", "false");
-	tess.SetVariable("load_system_dawg", "false");
-	tess.SetVariable("load_unambig_dawg", "false");
-	tess.SetVariable("load_word_dawg", "false");
-
-	if (charType)
-		tess.SetVariable("tessedit_char_whitelist", "0123456789");
-	else
-		tess.SetVariable("tessedit_char_whitelist", "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+	std::shared_ptr<tesseract::TessBaseAPI> engine = TesseractPool::getInstance().acquire(charType);
+	if (!engine)
+		return false;
 
+	tesseract::TessBaseAPI& tess = *engine;
 	tess.SetImage(src.data, src.cols, src.rows, 1, src.step);
 
+	std::vector<std::string> symbols;
+	std::vector<float> confidences(paddedChars.size(), -1);
+	if (mode == RecognitionMode::Words)
+		recognizeWord(tess, src.size(), paddedChars, symbols, confidences);
 
-#ifdef _DEBUG
-	cv::Mat drawnPaddedChars;
-	cv::cvtColor(src, drawnPaddedChars, cv::COLOR_GRAY2BGR);
-#endif
+	tess.SetPageSegMode(tesseract::PSM_SINGLE_BLOCK);
 
 	for (int i = 0; i < paddedChars.size(); i++)
 	{
+		if (confidences[i] >= threshold)
+		{
+			text = text + symbols[i];
+			confidence += confidences[i];
+			continue;
+		}
+
 		if (paddedChars[i].width >= src.cols)
 			continue;
 
@@ -1300,11 +1998,9 @@ bool Algorithm::applyTesseract(const cv::Mat& src, std::string& text, const std:
 				break;
 		}
 
-#ifdef _DEBUG
-		cv::rectangle(drawnPaddedChars, paddedChars[i], cv::Scalar(0, 255, 0), 2);
-#endif
-
-		std::string result = tess.GetUTF8Text();
+		ocrCalls++;
+		std::unique_ptr<char[]> output(tess.GetUTF8Text());
+		std::string result = output ? output.get() : "";
 
 		if (result.empty())
 		{
@@ -1324,7 +2020,7 @@ bool Algorithm::applyTesseract(const cv::Mat& src, std::string& text, const std:
 	return true;
 }
 
-bool Algorithm::readText(const cv::Mat& src, std::string& text, float& confidence, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords)
+bool Algorithm::readText(const cv::Mat& src, std::string& text, float& confidence, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const RecognitionMode& mode)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return false;
@@ -1338,13 +2034,17 @@ bool Algorithm::readText(const cv::Mat& src, std::string& text, float& confidenc
 			return false;
 	}
 
-	if (!applyTesseract(src, text, words[0], paddedWords[0], 0, confidence))
-		return false;
-	if (!applyTesseract(src, text, words[1], paddedWords[1], 1, confidence))
-		return false;
-	if (!applyTesseract(src, text, words[2], paddedWords[2], 0, confidence))
+	std::array<std::string, 3> texts;
+	std::array<float, 3> confidences;
+	if (!OcrBackend::current()->readWords(src, texts, confidences, words, paddedWords, plateCharTypes, mode))
 		return false;
 
+	for (int i = 0; i < texts.size(); i++)
+	{
+		text += texts[i];
+		confidence += confidences[i];
+	}
+
 	text.erase(std::remove(text.begin(), text.end(), '\n'), text.end());
 
 	confidence = confidence / text.size();
@@ -1352,9 +2052,37 @@ bool Algorithm::readText(const cv::Mat& src, std::string& text, float& confidenc
 	return true;
 }
 
-void Algorithm::drawBBoxes(cv::Mat& dst, cv::Rect& roi, std::string& dateTime, const std::string& text, const float& confidence)
+bool Algorithm::readWords(const cv::Mat& src, std::array<std::string, 3>& texts, std::array<float, 3>& confidences, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const RecognitionMode& mode)
 {
-	if (text.empty() || confidence < 0)
+	if (src.empty() || src.type() != CV_8UC1)
+		return false;
+
+	for (int i = 0; i < words.size(); i++)
+	{
+		if (!words[i].size() || !paddedWords[i].size())
+			return false;
+
+		if (words[i].size() != paddedWords[i].size())
+			return false;
+	}
+
+	if (!OcrBackend::current()->readWords(src, texts, confidences, words, paddedWords, plateCharTypes, mode))
+		return false;
+
+	for (int i = 0; i < words.size(); i++)
+	{
+		texts[i].erase(std::remove(texts[i].begin(), texts[i].end(), '\n'), texts[i].end());
+
+		if (!texts[i].empty())
+			confidences[i] = confidences[i] / texts[i].size();
+	}
+
+	return true;
+}
+
+void Algorithm::drawBBoxes(cv::Mat& dst, cv::Rect& roi, std::string& dateTime, const std::string& text, const float& confidence, const int& scale)
+{
+	if (text.empty() || confidence < 0 || scale <= 0)
 		return;
 
 	if (!dst.empty() && dst.type() != CV_8UC3)
@@ -1378,171 +2106,122 @@ void Algorithm::drawBBoxes(cv::Mat& dst, cv::Rect& roi, std::string& dateTime, c
 	stream << std::fixed << std::setprecision(2) << confidence;
 	std::string displayText = dateTime + " / " + text + " / " + "Score: " + stream.str();
 
-	cv::putText(dst, displayText, cv::Point(10, dst.rows - 30), cv::FONT_HERSHEY_SIMPLEX, 4, cv::Scalar(0, 0, 0), 18, cv::LINE_AA);
-	cv::putText(dst, displayText, cv::Point(10, dst.rows - 30), cv::FONT_HERSHEY_SIMPLEX, 4, cv::Scalar(255, 255, 255), 9, cv::LINE_AA);
+	cv::putText(dst, displayText, cv::Point(10, dst.rows - 15 * scale), cv::FONT_HERSHEY_SIMPLEX, 2 * scale, cv::Scalar(0, 0, 0), 9 * scale, cv::LINE_AA);
+	cv::putText(dst, displayText, cv::Point(10, dst.rows - 15 * scale), cv::FONT_HERSHEY_SIMPLEX, 2 * scale, cv::Scalar(255, 255, 255), 9 * scale / 2, cv::LINE_AA);
 
 	if (roi.empty())
 		return;
 
-	roi.x = roi.x * 2 + dst.cols * 0.1;
-	roi.y = roi.y * 2 + dst.rows / 2;
-	roi.width = roi.width * 2;
-	roi.height = roi.height * 2;
+	roi.x = roi.x * scale + dst.cols * 0.1;
+	roi.y = roi.y * scale + dst.rows / 2;
+	roi.width = roi.width * scale;
+	roi.height = roi.height * scale;
 
-	cv::rectangle(dst, roi, cv::Scalar(0, 255, 0), 5);
+	cv::rectangle(dst, roi, cv::Scalar(0, 255, 0), std::max(5 * scale / 2, 1));
 }
 
-std::string textFromImage(const std::string& srcPath, const std::string& dstPath)
+namespace
 {
-	cv::Mat src, dst;
-	std::string dateTime;
-	std::string plate;
-	float confidence = 0;
-
-	src = cv::imread(srcPath, cv::IMREAD_COLOR);
-	if (src.empty() || (src.type() != CV_8UC4 && src.type() != CV_8UC3))
+	// The recognizer of the calling thread, shared by the decoded and the encoded entry points, so each thread keeps one set of buffers.
+	PlateRecognizer& threadRecognizer()
 	{
-		plate = "N/A";
-		Algorithm::drawBBoxes(cv::Mat(), cv::Rect(), dateTime, plate, confidence);
-		return plate + "\n" + dateTime;
+		thread_local PlateRecognizer recognizer;
+		return recognizer;
 	}
+}
 
-	cv::Mat bgrSrc;
-	if (src.type() == CV_8UC4)
-		cv::cvtColor(src, bgrSrc, cv::COLOR_BGRA2BGR);
-	else
-		bgrSrc = src.clone();
-
-	dst = bgrSrc.clone();
-
-	cv::resize(bgrSrc, bgrSrc, cv::Size(bgrSrc.cols / 2, bgrSrc.rows / 2));
-
-	cv::Rect roi(bgrSrc.cols * 0.1, bgrSrc.rows / 2, bgrSrc.cols - bgrSrc.cols * 0.1, bgrSrc.rows / 2);
-	cv::Mat cropped = bgrSrc(roi);
-
-	cv::Mat gauss;
-	cv::GaussianBlur(cropped, gauss, cv::Size(3, 3), 0);
-
-	cv::Mat hsv;
-	Algorithm::BGR2HSV(gauss, hsv);
-
-	cv::Mat binary;
-	Algorithm::HSV2Binary(hsv, binary, 125);
-
-	cv::Mat stats;
-	std::vector<std::pair<int, int>> areas;
-	Algorithm::getConnectedComponents(binary, stats, areas, 10);
-
-	cv::Rect roiConnectedComponent;
-	for (int i = 0; i < areas.size(); i++)
-	{
-		cv::Rect roi;
-		int label = areas[i].first;
-		Algorithm::getRoi(stats, roi, label);
-
-#ifdef _DEBUG
-		cv::Mat colorConnectedComponent = cropped(roi);
-#endif
-
-		if (!Algorithm::sizeBBox(cropped, roi, 0.01, 0.15) || !Algorithm::heightBBox(roi, 0.2, 0.9))
-			continue;
-
-		Algorithm::paddingRect(roi, roi, 0.05, false, cropped.size());
-
-		cv::Mat hsvConnectedComponent = hsv(roi);
-		Algorithm::blueToBlack(hsvConnectedComponent, hsvConnectedComponent);
-
-		cv::Mat bgrConnectedComponent;
-		Algorithm::HSV2BGR(hsvConnectedComponent, bgrConnectedComponent);
-
-		cv::Mat grayConnectedComponent;
-		cv::cvtColor(bgrConnectedComponent, grayConnectedComponent, cv::COLOR_BGR2GRAY);
-
-		cv::Mat connectedComponent = cropped(roi);
-		cv::cvtColor(connectedComponent, connectedComponent, cv::COLOR_BGR2GRAY);
-
-		cv::Mat edges;
-		cv::threshold(grayConnectedComponent, edges, 0, 255, cv::THRESH_BINARY);
-		edges = 255 - edges;
-		Algorithm::edgeDetection(connectedComponent, edges);
-
-		cv::Mat regionContour;
-		std::vector<cv::Point> largestContour;
-		if (!Algorithm::roiContour(connectedComponent, regionContour, largestContour, edges, 0.8))
-			continue;
-
-		cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
-		cv::erode(regionContour, regionContour, kernel);
-		cv::dilate(regionContour, regionContour, kernel);
-
-		Algorithm::roiContour(regionContour, regionContour, largestContour);
-
-		std::vector<cv::Point2f> quadrilateralCoordinates;
-		if (!Algorithm::cornersCoordinates(regionContour, quadrilateralCoordinates, largestContour))
-			continue;
-
-		cv::Mat resizedConnectedComponent;
-		if (!Algorithm::resizeToPoints(connectedComponent, resizedConnectedComponent, quadrilateralCoordinates, 0.2))
-			continue;
-
-		cv::Mat transformedConnectedComponent;
-		if (!Algorithm::geometricalTransformation(resizedConnectedComponent, transformedConnectedComponent, quadrilateralCoordinates, 0.2))
-			continue;
-
-		cv::Mat textConnectedComponent;
-		Algorithm::insideContour(transformedConnectedComponent, textConnectedComponent);
-
-		cv::Mat denoiseConnectedComponent;
-		if (!Algorithm::denoise(textConnectedComponent, denoiseConnectedComponent, 0.15))
-			continue;
+// Every entry point sets the prior and the calibration of the shared recognizer, so neither is used after the call it was passed to.
+PlateResult plateFromImage(const cv::Mat& src)
+{
+	PlateRecognizer& recognizer = threadRecognizer();
+	recognizer.setSpatialPrior(nullptr);
+	recognizer.setCalibration(nullptr);
 
-		cv::dilate(denoiseConnectedComponent, denoiseConnectedComponent, cv::Mat());
-		cv::erode(denoiseConnectedComponent, denoiseConnectedComponent, cv::Mat());
+	return recognizer.recognize(src);
+}
 
-		if (!Algorithm::denoise(denoiseConnectedComponent, denoiseConnectedComponent, 0.15))
-			continue;
+PlateResult plateFromImage(const std::vector<uchar>& buffer, const bool& fullResolution)
+{
+	PlateRecognizer& recognizer = threadRecognizer();
+	recognizer.setSpatialPrior(nullptr);
+	recognizer.setCalibration(nullptr);
 
-		std::vector<cv::Rect> chars;
-		Algorithm::charsBBoxes(denoiseConnectedComponent, chars);
+	return recognizer.recognize(buffer, fullResolution);
+}
 
-		std::array<int, 3> indexes;
-		if (!Algorithm::firstIndexes(chars, indexes))
-			continue;
+PlateResult plateFromImage(const std::vector<uchar>& buffer, SpatialPrior& prior, const bool& fullResolution)
+{
+	PlateRecognizer& recognizer = threadRecognizer();
+	recognizer.setSpatialPrior(&prior);
+	recognizer.setCalibration(nullptr);
 
-		std::vector<cv::Rect> paddedChars;
-		Algorithm::paddingChars(chars, paddedChars, 0.6);
+	return recognizer.recognize(buffer, fullResolution);
+}
 
-		cv::Mat spacedConnectedComponent;
-		Algorithm::charsSpacing(denoiseConnectedComponent, spacedConnectedComponent, chars, paddedChars);
+PlateResult plateFromImage(const std::vector<uchar>& buffer, SpatialPrior& prior, const CameraCalibration& calibration, const bool& fullResolution)
+{
+	PlateRecognizer& recognizer = threadRecognizer();
+	recognizer.setSpatialPrior(&prior);
+	recognizer.setCalibration(&calibration);
 
-		std::array<std::vector<cv::Rect>, 3> words;
-#ifdef _DEBUG
-		Algorithm::wordsSeparation(chars, words, indexes, denoiseConnectedComponent);
-#else
-		Algorithm::wordsSeparation(chars, words, indexes);
-#endif
+	return recognizer.recognize(buffer, fullResolution);
+}
 
-		std::array<std::vector<cv::Rect>, 3> paddedWords;
-#ifdef _DEBUG
-		Algorithm::wordsSeparation(paddedChars, paddedWords, indexes, spacedConnectedComponent);
-#else
-		Algorithm::wordsSeparation(paddedChars, paddedWords, indexes);
-#endif
+void setThreadBudget(const int& threads)
+{
+	threadBudget = std::max(threads, 0);
+}
 
-		if (!Algorithm::readText(spacedConnectedComponent, plate, confidence, words, paddedWords))
-			continue;
+int getThreadBudget()
+{
+	return threadBudget > 0 ? threadBudget : std::max(cv::getNumThreads(), 1);
+}
 
-		roiConnectedComponent = roi;
-		break;
-	}
+std::future<bool> saveImage(const cv::Mat& image, const std::string& path)
+{
+	struct Write
+	{
+		cv::Mat image;
+		std::string path;
+		std::promise<bool> saved;
+	};
+
+	// A single writer, started by the first image, writes the images in order. Its queue is bounded, so a burst of vehicles
+	// that outpaces the disk makes the callers wait for a free place instead of piling up images in memory.
+	static WorkerPool<Write> writer(1, 32, []() -> WorkerPool<Write>::Handler
+		{
+			return [](Write& write, const double&)
+				{
+					try
+					{
+						write.saved.set_value(!write.image.empty() && !write.path.empty() && cv::imwrite(write.path, write.image));
+					}
+					catch (...)
+					{
+						write.saved.set_value(false);
+					}
+				};
+		});
+
+	Write write{ image, path, std::promise<bool>() };
+	std::future<bool> saved = write.saved.get_future();
+
+	if (!writer.submit(write))
+		write.saved.set_value(false);
+
+	return saved;
+}
 
-	if (plate.empty())
-		plate = "N/A";
+std::string textFromImage(const std::string& srcPath, const std::string& dstPath)
+{
+	std::vector<uchar> buffer;
+	ImageDecoder::readFile(srcPath, buffer);
 
-	Algorithm::drawBBoxes(dst, roiConnectedComponent, dateTime, plate, confidence);
+	// The stored image keeps the resolution of the source, so it is only decoded at half resolution when it is not stored.
+	PlateResult result = plateFromImage(buffer, !dstPath.empty());
 
-	if (!dstPath.empty())
-		cv::imwrite(dstPath, dst);
+	if (!dstPath.empty() && !result.annotated.empty())
+		cv::imwrite(dstPath, result.annotated);
 
-	return plate + "\n" + dateTime;
+	return result.plate + "\n" + result.dateTime;
 }
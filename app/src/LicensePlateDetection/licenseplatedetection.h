@@ -1,16 +1,77 @@
-#pragma once
+﻿#pragma once
 
+#ifdef _WIN32
 #ifdef LICENSEPLATEDETECTION_EXPORTS
 #define LICENSEPLATEDETECTION_API __declspec(dllexport)
 #else
 #define LICENSEPLATEDETECTION_API __declspec(dllimport)
 #endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include "pipelinepolicy.h"
 
 #include <iostream>
+#include <atomic>
+#include <future>
 #include <opencv2/opencv.hpp>
 #include <tesseract/baseapi.h>
 #include <leptonica/allheaders.h>
 
+/**
+* @enum RecognitionMode
+* @brief Selects how the characters of a plate are passed to Tesseract OCR.
+*
+* In the Characters mode every character box is shrunk one pixel per side until Tesseract reads a single symbol.
+* In the Words mode every word is read in a single recognition and the shrinking search only runs
+* for the characters whose symbol was not found or was read with a low confidence.
+*/
+enum class RecognitionMode
+{
+	Characters,
+	Words
+};
+
+/**
+* @struct PlateResult
+* @brief Holds the result of a license plate recognition.
+*
+* The region of interest is expressed in the coordinates of the source image and is empty when no plate was read.
+* The annotated image is a copy of the source with the bounding box, the plate, the time and the score drawn on it.
+*/
+struct PlateResult
+{
+	std::string plate;
+	float confidence = 0;
+	cv::Rect roi;
+	std::string dateTime;
+	cv::Mat annotated;
+};
+
+/**
+* @struct AlgorithmBuffers
+* @brief Holds the intermediate images and vectors of the Algorithm functions, so that a caller processing many images can reuse them.
+*
+* The functions that accept these buffers write their temporaries to them instead of allocating new ones. Once they have processed
+* an image of a given size, the buffers are large enough for the next images of that size. The buffers must not be used by two
+* functions at once, so every thread or plate candidate owns its own.
+*/
+struct AlgorithmBuffers
+{
+	cv::Mat sobelX, sobelY, magnitude, sobel, direction, eroded, gradient, binary;
+	cv::Mat floatSrc, hist, cumulativeHist, thresholded;
+	cv::Mat otsu, dilatedEdges, bordered, contoursRegion;
+	cv::Mat labels, stats, centroids;
+	std::vector<std::vector<cv::Point>> contours, deletedContours, largestContours;
+	std::vector<std::pair<int, int>> areas;
+	std::vector<int> heights;
+	std::vector<cv::Point> hull, approximation;
+	std::vector<cv::Point2f> corners, contourPoints, sidePoints;
+};
+
 /**
 * @class algorithm
 * @brief Provides a collection of image processing functions.
@@ -27,6 +88,7 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @brief Converts an image from BGR color space to HSV color space.
 	 * @details This function converts each pixel of the source image from BGR color space to HSV color space manually,
 	 *          taking into account the maximum and minimum values of the BGR components to calculate the HSV values.
+	 *          The saturation and value are read from lookup tables built once with the same double-precision formulas.
 	 * @param[in] src The source image in BGR color space.
 	 * @param[out] dst The destination image in HSV color space.
 	 * @return void
@@ -45,6 +107,18 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 */
 	static void HSV2Binary(const cv::Mat& src, cv::Mat& dst, const uchar& threshold = 125);
 
+	/**
+	 * @brief Converts a BGR image directly to the binary image produced by BGR2HSV followed by HSV2Binary.
+	 * @details The saturation and value of a pixel depend only on the maximum and minimum of its BGR components,
+	 *          so this function computes them per row with vector instructions and compares them against
+	 *          precomputed bounds, without materializing the HSV image. The result is identical to the two-step conversion.
+	 * @param[in] src The source image in BGR color space.
+	 * @param[out] dst The destination binary image.
+	 * @param[in] threshold The threshold value used for binarization.
+	 * @return void
+	 */
+	static void BGR2Binary(const cv::Mat& src, cv::Mat& dst, const uchar& threshold = 125);
+
 	/**
 	 * @brief Identifies connected components in a binary image and sorts them by area.
 	 * @details This function uses the connected components analysis to label different parts of a binary image,
@@ -57,6 +131,20 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 */
 	static void getConnectedComponents(const cv::Mat& src, cv::Mat& stats, std::vector<std::pair<int, int>>& areas, const int& newSize = 0);
 
+	/**
+	 * @brief Identifies connected components in a binary image and sorts them by area, using caller-owned buffers.
+	 * @details Same as the overload above, but the label and centroid images are written to the given buffers,
+	 *          so that a caller processing frames of a fixed size can reuse them.
+	 * @param[in] src The source binary image.
+	 * @param[out] labels The label image.
+	 * @param[out] stats Statistics of the identified components, including the area.
+	 * @param[out] cendtroids The centroids of the identified components.
+	 * @param[in,out] areas A vector of pairs, to which the label and area of each connected component are appended.
+	 * @param[in] newSize The maximum number of components to keep after sorting.
+	 * @return void
+	 */
+	static void getConnectedComponents(const cv::Mat& src, cv::Mat& labels, cv::Mat& stats, cv::Mat& cendtroids, std::vector<std::pair<int, int>>& areas, const int& newSize = 0);
+
 	/**
 	 * @brief Retrieves the bounding box of a connected component identified by its label.
 	 * @details This function extracts the bounding box of a specific connected component
@@ -90,6 +178,32 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 */
 	static bool heightBBox(const cv::Rect& roi, const float& min = 0, const float& max = 1);
 
+	/**
+	 * @brief Computes the integral image of the features used to score the plate candidates.
+	 * @details For every pixel, this function marks in one pass whether it lies on a strong horizontal gradient, whether the binary image
+	 *          changes value at it, as it does on each stroke of a character, and whether it is blue, as the band of a plate is.
+	 *          The integral of the three marks gives the count of each of them over any rectangle in constant time.
+	 * @param[in] src The source image in BGR color space.
+	 * @param[in] binary The binary image of the source, with the white regions set.
+	 * @param[out] features The marks of every pixel, one per channel.
+	 * @param[out] integral The integral image of the marks, one row and one column larger than the source.
+	 * @return void
+	 */
+	static void candidateFeatures(const cv::Mat& src, const cv::Mat& binary, cv::Mat& features, cv::Mat& integral);
+
+	/**
+	 * @brief Scores how much a candidate region looks like a license plate.
+	 * @details This function reads the edge density, the stroke transitions per row across the middle of the region,
+	 *          the blue ratio next to its left side and its aspect ratio from the integral of the features, so its cost
+	 *          does not depend on the size of the region. A region without text-like edges and strokes cannot be a plate and is rejected.
+	 * @param[in] integral The integral image computed by candidateFeatures.
+	 * @param[in] roi The candidate region.
+	 * @param[in] fill The fraction of the region covered by its connected component.
+	 * @param[out] score The score of the region, higher for regions that look more like a plate.
+	 * @return Returns false if the region cannot be a plate, true otherwise.
+	 */
+	static bool candidateScore(const cv::Mat& integral, const cv::Rect& roi, const float& fill, float& score);
+
 	/**
 	 * @brief Adds padding to a rectangle and optionally enforces a square shape.
 	 * @details This function calculates padding for a given rectangle based on a specified percentageage of its dimensions.
@@ -171,9 +285,10 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @details This function calculates an optimal threshold based on the shape of the image histogram and uses it to convert the image to binary form.
 	 * @param[in] src The source image to threshold.
 	 * @param[out] dst The destination binary image.
+	 * @param[in,out] buffers (Optional) The reusable buffers of the intermediate images, or nullptr to allocate them.
 	 * @return void
 	 */
-	static void triangleThresholding(const cv::Mat& src, cv::Mat& dst);
+	static void triangleThresholding(const cv::Mat& src, cv::Mat& dst, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Applies Sobel edge detection and thresholding to an image.
@@ -182,9 +297,10 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param[in] src The source image.
 	 * @param[out] dst The binary image after applying Sobel edge detection and thresholding.
 	 * @param[out] direction The gradient direction of each pixel.
+	 * @param[in,out] buffers (Optional) The reusable buffers of the intermediate images, or nullptr to allocate them.
 	 * @return void
 	 */
-	static void binarySobel(const cv::Mat& src, cv::Mat& dst, cv::Mat& direction);
+	static void binarySobel(const cv::Mat& src, cv::Mat& dst, cv::Mat& direction, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Applies non-maximum suppression to an edge image.
@@ -203,9 +319,10 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 *          It combines the results with Sobel edges and applies non-maximum suppression to refine the edge map.
 	 * @param[in] src The source image.
 	 * @param[out] dst The image after applying the morphological gradient and refining the edges.
+	 * @param[in,out] buffers (Optional) The reusable buffers of the intermediate images, or nullptr to allocate them.
 	 * @return void
 	 */
-	static void edgeDetection(const cv::Mat& src, cv::Mat& dst);
+	static void edgeDetection(const cv::Mat& src, cv::Mat& dst, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Performs a bitwise NAND operation between two images.
@@ -235,8 +352,9 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param[out] dst The destination image where the largest contour is drawn.
 	 * @param[out] largestContour The largest contour found in the source image.
 	 * @param[in] edges (Optional) An edge image that can be used to refine the ROI by excluding certain areas from the contour detection process.
+	 * @param[in,out] buffers (Optional) The reusable buffers of the thresholded image and of the contours, or nullptr to allocate them.
 	 */
-	static bool roiContour(const cv::Mat& src, cv::Mat& dst, std::vector<cv::Point>& largestContour, const cv::Mat& edges = cv::Mat(), const float& percentage = 0);
+	static bool roiContour(const cv::Mat& src, cv::Mat& dst, std::vector<cv::Point>& largestContour, const cv::Mat& edges = cv::Mat(), const float& percentage = 0, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Calculates a line passing through a given point with a specified slope and direction.
@@ -286,14 +404,13 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param[out] sortedLines A vector to store the sorted lines, ordered as left, top, right, and bottom lines based on their relation to the image center.
 	 * @param[in] lines The input vector of lines to be sorted, where each line is represented as a 4-element vector (x1, y1, x2, y2).
 	 * @param[in] size The size of the image or scene from which the lines are derived, used to determine the center for categorization.
+	 * @param[in] src The grayscale image the lines were detected in, on which the groups of lines are drawn by the visualization policy.
+	 * @tparam Visualization The visualization policy, NoVisualization or DumpVisualization.
 	 * @return A boolean value indicating the success of the sorting operation.
 	 *         Returns true if lines are successfully categorized into all four groups (left, top, right, bottom); otherwise, returns false.
 	 */
-#ifdef _DEBUG
-	static bool lineSorting(std::vector<cv::Vec4i>& sortedLines, const std::vector<cv::Vec4i>& lines, const cv::Size& size, const cv::Mat& src);
-#else
-	static bool lineSorting(std::vector<cv::Vec4i>& sortedLines, const std::vector<cv::Vec4i>& lines, const cv::Size& size);
-#endif
+	template <typename Visualization = NoVisualization>
+	static bool lineSorting(std::vector<cv::Vec4i>& sortedLines, const std::vector<cv::Vec4i>& lines, const cv::Size& size, const cv::Mat& src = cv::Mat());
 
 	/**
 	 * @brief Calculates the intersection point of two line segments.
@@ -306,16 +423,18 @@ class LICENSEPLATEDETECTION_API Algorithm
 
 	/**
 	 * @brief Detects and calculates the corner points of a quadrilateral based on the largest contour in an image.
-	 * @details This function applies erosion to the source image to highlight its edges,
-	 *          and then attempts to fit a rotated bounding box around the largest contour.
-	 *          It iteratively decreases the minimum line length parameter for HoughLinesP to find lines within the edges, sorts these lines,
-	 *          and calculates their intersections to determine the corner points of the quadrilateral.
+	 * @details This function simplifies the convex hull of the largest contour to four corners, fits a line to the contour points
+	 *          of every side between them, leaving out the points near the corners, and calculates the intersections of the fitted lines
+	 *          to determine the corner points of the quadrilateral, starting with the top left one and going clockwise.
 	 * @param[in] src The source image from which to calculate the quadrilateral's corners.
 	 * @param[out] quadrilateralCoordinates The calculated coordinates of the quadrilateral's corners.
 	 * @param[in] largestContour The largest contour found in the source image, used to approximate the quadrilateral's bounding box.
+	 * @param[in,out] buffers (Optional) The reusable buffers of the hull, the corners and the contour points, or nullptr to allocate them.
+	 * @tparam Visualization The visualization policy, NoVisualization or DumpVisualization.
 	 * @return A boolean value indicating the success of the corner detection. Returns true if the corners are successfully found and false otherwise.
 	 */
-	static bool cornersCoordinates(const cv::Mat& src, std::vector<cv::Point2f>& quadrilateralCoordinates, const std::vector<cv::Point>& largestContour);
+	template <typename Visualization = NoVisualization>
+	static bool cornersCoordinates(const cv::Mat& src, std::vector<cv::Point2f>& quadrilateralCoordinates, const std::vector<cv::Point>& largestContour, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Resizes the source image based on specified points, adding padding as necessary.
@@ -353,9 +472,10 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 *          and applies Otsu's thresholding to distinguish the inner contours. Finally, the result is inverted to highlight these contours against a dark background.
 	 * @param src The source image to process.
 	 * @param dst The destination image where the result is stored. This will contain the highlighted inner contours.
+	 * @param buffers (Optional) The reusable buffer of the bordered image, or nullptr to allocate it.
 	 * @return void
 	 */
-	static void insideContour(const cv::Mat& src, cv::Mat& dst);
+	static void insideContour(const cv::Mat& src, cv::Mat& dst, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Calculates the height of a given contour.
@@ -379,9 +499,10 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @brief Calculates the median height of a set of contours.
 	 * @details This function determines the median height among all given contours, useful for filtering contours based on their size.
 	 * @param[in] contours A vector of contours.
+	 * @param[in,out] buffers (Optional) The reusable buffer of the heights, or nullptr to allocate it.
 	 * @return The median height of the given contours.
 	 */
-	static int medianHeight(const std::vector<std::vector<cv::Point>>& contours);
+	static int medianHeight(const std::vector<std::vector<cv::Point>>& contours, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Reduces noise in the source image by selectively keeping contours based on their height relative to the median height of all contours.
@@ -394,11 +515,12 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param[out] dst The destination image after denoising.
 	 * @param[in] percentage (Optional) The tolerance for height deviation from the median, expressed as a percentageage.
 	 *                    Contours with a height deviating more than this percentageage from the median are discarded.
+	 * @param[in,out] buffers (Optional) The reusable buffers of the mask and of the contours, or nullptr to allocate them.
 	 * @return A boolean value indicating the success of the denoising process.
 	 *         Returns true if the resulting image has a non-zero number of pixels (indicating successful contour isolation),
 	 *         and false otherwise, suggesting inadequate contour selection or excessive noise removal.
 	 */
-	static bool denoise(const cv::Mat& src, cv::Mat& dst, const float& percentage = 1);
+	static bool denoise(const cv::Mat& src, cv::Mat& dst, const float& percentage = 1, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Extracts bounding boxes for characters from the source image.
@@ -406,9 +528,10 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 *          It stores the bounding boxes of these characters in the provided vector.
 	 * @param src The source binary image from which characters are to be extracted.
 	 * @param chars Output vector storing the bounding boxes of detected characters.
+	 * @param buffers (Optional) The reusable buffers of the connected components, or nullptr to allocate them.
 	 * @return void
 	 */
-	static void charsBBoxes(const cv::Mat& src, std::vector<cv::Rect>& chars);
+	static void charsBBoxes(const cv::Mat& src, std::vector<cv::Rect>& chars, AlgorithmBuffers* buffers = nullptr);
 
 	/**
 	 * @brief Identifies critical indexes in the character bounding boxes vector to aid in word separation.
@@ -449,24 +572,13 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param indexes Array of indexes used to determine word boundaries.
 	 * @return void
 	 */
-#ifdef _DEBUG
-	static void wordsSeparation(const std::vector<cv::Rect>& chars, std::array<std::vector<cv::Rect>, 3>& words, const std::array<int, 3>& indexes, const cv::Mat src);
-#else
 	static void wordsSeparation(const std::vector<cv::Rect>& chars, std::array<std::vector<cv::Rect>, 3>& words, const std::array<int, 3>& indexes);
-#endif
-
-	/**
-	 * @brief Returns a singleton instance of the Tesseract OCR engine initialized with specific settings.
-	 * @details Initializes the Tesseract OCR engine once with the "DIN1451Mittelschrift" font and LSTM engine only.
-	 *          Subsequent calls return the same initialized instance, ensuring efficiency and thread safety.
-	 * @return A reference to the singleton instance of tesseract::TessBaseAPI.
-	 */
-	static tesseract::TessBaseAPI& getTessInstance();
 
 	/**
 	 * @brief Verifies the output text from Tesseract OCR for a given image area and updates the confidence level.
 	 * @details This function checks if Tesseract OCR has recognized exactly two characters in the specified area.
-	 *          It then updates the overall confidence level based on the OCR's confidence for these symbols.
+	 *          It then updates the overall confidence level based on the OCR's confidence for these symbols,
+	 *          reading it from the same recognition that produced the text.
 	 * @param[in,out] tess An instance of Tesseract's TessBaseAPI, already initialized and set up for OCR.
 	 * @param[in,out] confidence A reference to a float that holds the cumulative confidence level.
 	 *                    This value is updated based on the OCR's confidence for the current text.
@@ -487,6 +599,17 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 */
 	static bool resizeCharTemplate(const cv::Mat& src, cv::Mat& dst, const cv::Size& size);
 
+	/**
+	 * @brief Returns the character template resized for a given size.
+	 * @details The "I" template is read from disk only once, the first time it is needed.
+	 *          Every height is resized, binarized and cropped by resizeCharTemplate only once and then kept in memory,
+	 *          so the matching fallback of the OCR never touches the disk or recomputes a template.
+	 * @param[in] size The size of the character to match, specifically its height.
+	 * @param[out] dst The resized character template. It shares the cached data and must not be modified.
+	 * @return Returns true if the template is available for the requested size, false otherwise.
+	 */
+	static bool charTemplate(const cv::Size& size, cv::Mat& dst);
+
 	/**
 	 * @brief Calculates the padding needed to make two dimensions equal, distributing the padding evenly on two sides.
 	 * @details This utility function is used to calculate how much padding is needed when aligning images or regions of interest to the same size.
@@ -502,8 +625,8 @@ class LICENSEPLATEDETECTION_API Algorithm
 
 	/**
 	 * @brief Matches a source image against a character template and calculates the Dice similarity coefficient.
-	 * @details This function resizes and pads the character template image to match the source image's dimensions.
-	 *          It then performs a bitwise AND operation between the source and the template to find the intersection.
+	 * @details This function pads the cached character template image to match the source image's dimensions.
+	 *          Both images are packed into bitmasks and the size of their intersection is obtained from the popcounts of the masks and of their XOR.
 	 *          The Dice coefficient is calculated to measure the similarity between the two images, providing a basis for character recognition.
 	 * @param[in] src The source image to match against the character template.
 	 * @param[out] dice A reference to a float where the calculated Dice similarity coefficient will be stored.
@@ -512,10 +635,26 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 */
 	static bool matching(const cv::Mat& src, float& dice, const float& percentage = 0);
 
+	/**
+	 * @brief Recognizes all the characters of a word in a single Tesseract OCR call.
+	 * @details This function reads the bounding box of the padded characters as a single text line and walks the symbols with the result iterator.
+	 *          Each symbol is assigned to the padded character that contains its center, together with its confidence.
+	 *          Characters that receive no symbol or more than one symbol keep a negative confidence.
+	 * @param[in,out] tess An instance of Tesseract's TessBaseAPI, with the source image already set.
+	 * @param[in] size The size of the source image.
+	 * @param[in] paddedChars A vector of rectangles specifying the padded regions of the characters of the word.
+	 * @param[out] symbols The symbol recognized for each character.
+	 * @param[out] confidences The confidence of the symbol recognized for each character, or -1 if no symbol could be assigned.
+	 * @return Returns true if the word was recognized, false otherwise.
+	 */
+	static bool recognizeWord(tesseract::TessBaseAPI& tess, const cv::Size& size, const std::vector<cv::Rect>& paddedChars, std::vector<std::string>& symbols, std::vector<float>& confidences);
+
 	/**
 	 * @brief Applies Tesseract OCR to recognize text in specified regions of an image, adjusting for character types and improving confidence.
-	 * @details Initializes Tesseract with specific settings for character recognition,
-	 *          applies OCR to specified regions, and adjusts the regions iteratively to improve text recognition.
+	 * @details Borrows an engine initialized for the requested character type from the TesseractPool.
+	 *          In the Words mode the whole word is recognized at once and the symbols read with enough confidence are accepted directly.
+	 *          For the remaining characters, or for all of them in the Characters mode, OCR is applied to each region
+	 *          and the region is adjusted iteratively to improve text recognition.
 	 *          It also integrates a matching function to enhance the recognition of difficult characters, updating the overall confidence accordingly.
 	 * @param[in] src The source image for text recognition.
 	 * @param[out] text A reference to a string where the recognized text will be appended.
@@ -523,13 +662,15 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param[out] paddedChars A vector of rectangles specifying the adjusted regions after padding has been applied, aiming to improve OCR accuracy.
 	 * @param[in] charType A boolean indicating the type of characters to recognize (true for digits, false for letters).
 	 * @param[out] confidence A reference to a float where the cumulative confidence of recognized text will be stored.
+	 * @param[in] mode The recognition mode, either one OCR call per word or the shrinking search for every character.
+	 * @param[in] threshold The minimum confidence for a symbol recognized in the Words mode to be accepted without the shrinking search.
 	 * @return Returns true if the text recognition process completes successfully.
 	 */
-	static bool applyTesseract(const cv::Mat& src, std::string& text, const std::vector<cv::Rect>& chars, std::vector<cv::Rect>& paddedChars, const bool& charType, float& confidence);
+	static bool applyTesseract(const cv::Mat& src, std::string& text, const std::vector<cv::Rect>& chars, std::vector<cv::Rect>& paddedChars, const bool& charType, float& confidence, const RecognitionMode& mode = RecognitionMode::Words, const float& threshold = 80);
 
 	/**
-	 * @brief Attempts to read text from specific regions in an image using Tesseract OCR, for different sets of character types.
-	 * @details This function sequentially applies OCR to three different regions of the source image,
+	 * @brief Attempts to read text from specific regions in an image using the selected OCR backend, for different sets of character types.
+	 * @details This function applies OCR to three different regions of the source image through OcrBackend::current(),
 	 *          each time targeting a different type of characters (letters or digits).
 	 *          It accumulates the recognized text and the overall confidence score.
 	 *          Text normalization is performed by removing newline characters,
@@ -539,9 +680,24 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param[out] confidence The average confidence score of the recognized text.
 	 * @param[in] words An array of vectors, each containing rectangles defining the regions of interest for text recognition within the source image.
 	 * @param[in] paddedWords An array of vectors corresponding to `words`, adjusted to include padding around the regions of interest to improve OCR accuracy.
+	 * @param[in] mode The recognition mode used for every region.
 	 * @return Returns true if text is successfully read from all specified regions, false if any OCR application fails.
 	 */
-	static bool readText(const cv::Mat& src, std::string& text, float& confidence, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords);
+	static bool readText(const cv::Mat& src, std::string& text, float& confidence, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const RecognitionMode& mode = RecognitionMode::Words);
+
+	/**
+	 * @brief Reads the text of each word of a plate separately.
+	 * @details This function applies OCR to the same three regions and character types as readText,
+	 *          but keeps the text and the average confidence of each word instead of joining them.
+	 * @param[in] src The source image to read text from.
+	 * @param[out] texts The recognized text of each word.
+	 * @param[out] confidences The average confidence score of each word, or 0 for a word without text.
+	 * @param[in] words An array of vectors, each containing rectangles defining the regions of interest for text recognition within the source image.
+	 * @param[in] paddedWords An array of vectors corresponding to `words`, adjusted to include padding around the regions of interest to improve OCR accuracy.
+	 * @param[in] mode The recognition mode used for every region.
+	 * @return Returns true if text is successfully read from all specified regions, false if any OCR application fails.
+	 */
+	static bool readWords(const cv::Mat& src, std::array<std::string, 3>& texts, std::array<float, 3>& confidences, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const RecognitionMode& mode = RecognitionMode::Words);
 
 	/**
 	 * @brief Draws bounding boxes around specified regions and annotates the image with text information and a confidence score.
@@ -554,23 +710,109 @@ class LICENSEPLATEDETECTION_API Algorithm
 	 * @param[out] time The current time, formatted as a string.
 	 * @param[in] text The text to be displayed along with the time and confidence score.
 	 * @param[in] confidence The confidence score associated with the text, formatted as part of the display text.
+	 * @param[in] scale The ratio between the destination image and the halved image where the region was found,
+	 *            1 if the destination was decoded at half resolution. The text and the box are scaled accordingly.
 	 * @return void
 	 */
-	static void drawBBoxes(cv::Mat& dst, cv::Rect& roi, std::string& dateTime, const std::string& text, const float& confidence);
+	static void drawBBoxes(cv::Mat& dst, cv::Rect& roi, std::string& dateTime, const std::string& text, const float& confidence, const int& scale = 2);
 
-	friend std::string LICENSEPLATEDETECTION_API textFromImage(const std::string& imagePath, const std::string& savePath);
+	/**
+	 * @brief The number of Tesseract OCR calls made since the start of the application, used to compare the recognition modes.
+	 */
+	static std::atomic<int> ocrCalls;
+
+	friend class PlateRecognizer;
+
+	friend class TesseractBackend;
 
 	friend class AlgorithmTests;
 };
 
+class SpatialPrior;
+
+class CameraCalibration;
+
 /**
- * @brief Extracts and returns text from an image, processing through multiple stages including cropping, filtering, and OCR.
- * @details The function processes an input image through a series of steps
+ * @brief Recognizes the license plate in an image already loaded in memory.
+ * @details The function processes the image through a series of steps
  *          including conversion, resizing, Gaussian blurring, HSV conversion, binary thresholding,
  *          contour detection, geometrical transformations, and OCR text recognition.
  *          It applies various image processing techniques to prepare regions of interest for OCR,
  *          aiming to extract readable text and corresponding confidence levels.
- *          The output is annotated with the recognized text, processing time, and confidence scores.
+ *          Nothing is read from or written to the disk.
+ * @param[in] image The source image, in BGR or BGRA format.
+ * @return The recognized plate ("N/A" if no plate was read), its confidence, its region, the time of extraction and the annotated image.
+ */
+PlateResult LICENSEPLATEDETECTION_API plateFromImage(const cv::Mat& image);
+
+/**
+ * @brief Recognizes the license plate in an encoded image, such as the bytes of a JPEG file.
+ * @details Unless the full resolution is requested, the image is decoded directly at the half resolution the pipeline works at,
+ *          which for a JPEG image is much faster than decoding it fully and never allocates its full resolution.
+ *          The annotated image and the region of the plate are then at half the resolution of the source.
+ * @param[in] buffer The encoded image.
+ * @param[in] fullResolution True to decode the full image, so that the annotated image keeps the resolution of the source,
+ *            false to decode it at half resolution.
+ * @return The recognition result, as returned for a decoded image.
+ */
+PlateResult LICENSEPLATEDETECTION_API plateFromImage(const std::vector<uchar>& buffer, const bool& fullResolution = false);
+
+/**
+ * @brief Recognizes the license plate in an encoded image from a fixed camera, searching first where its plates usually appear.
+ * @details The image is decoded and recognized as by plateFromImage, but the hotspot learned by the prior of the camera
+ *          is searched before the whole region, and the plate read updates the prior.
+ * @param[in] buffer The encoded image.
+ * @param[in,out] prior The spatial prior of the camera that took the image.
+ * @param[in] fullResolution True to decode the full image, false to decode it at half resolution.
+ * @return The recognition result, as returned for a decoded image.
+ */
+PlateResult LICENSEPLATEDETECTION_API plateFromImage(const std::vector<uchar>& buffer, SpatialPrior& prior, const bool& fullResolution = false);
+
+/**
+ * @brief Recognizes the license plate in an encoded image from a calibrated fixed camera.
+ * @details The image is normalized with the calibration profile of the camera before it is searched, first in the hotspot
+ *          learned by the prior of the camera. The region of the plate is returned in the coordinates of the image as it was taken.
+ * @param[in] buffer The encoded image.
+ * @param[in,out] prior The spatial prior of the camera that took the image.
+ * @param[in] calibration The calibration profile of the camera. A profile that was not loaded leaves the image as it is.
+ * @param[in] fullResolution True to decode the full image, false to decode it at half resolution.
+ * @return The recognition result, as returned for a decoded image.
+ */
+PlateResult LICENSEPLATEDETECTION_API plateFromImage(const std::vector<uchar>& buffer, SpatialPrior& prior, const CameraCalibration& calibration, const bool& fullResolution = false);
+
+/**
+ * @brief Sets the number of threads the image kernels may use when called from the current thread.
+ * @details The kernels that go over every pixel of a large image split its rows into bands processed in parallel,
+ *          and the plate candidates of a frame are evaluated in parallel. A lane that runs alongside others, such as one camera
+ *          of a gate with several, should set its share of the cores, so that the lanes together do not oversubscribe the CPU.
+ *          The results do not depend on the budget.
+ * @param[in] threads The maximum number of threads, or 0 to use all the threads of OpenCV, which is the default.
+ * @return void
+ */
+void LICENSEPLATEDETECTION_API setThreadBudget(const int& threads);
+
+/**
+ * @brief Returns the number of threads the image kernels and the candidate evaluation may use when called from the current thread.
+ * @return The budget set with setThreadBudget, or the number of threads of OpenCV if none was set.
+ */
+int LICENSEPLATEDETECTION_API getThreadBudget();
+
+/**
+ * @brief Writes an image to the disk on a background thread.
+ * @details The images are written in order by a single writer thread, whose queue holds up to 32 images. When it is full,
+ *          this function waits for a free place. The image shares its data with the caller, which must not modify it afterwards.
+ *          The returned future may be ignored, since it does not wait for the write when destroyed.
+ * @param[in] image The image to write.
+ * @param[in] path The destination path.
+ * @return A future that becomes true once the image has been written, or false if the write failed.
+ */
+std::future<bool> LICENSEPLATEDETECTION_API saveImage(const cv::Mat& image, const std::string& path);
+
+/**
+ * @brief Extracts and returns text from an image file and optionally saves the annotated image.
+ * @details The encoded image is read from the disk and recognized with plateFromImage. It is decoded at half resolution,
+ *          unless a destination path is given, in which case it is decoded fully and annotated at the resolution of the source,
+ *          then written synchronously.
  * @param[in] imagePath The source image path from which text is to be extracted.
  * @param[out] savePath The destination image path, which is a copy of the source annotated with recognized text and other relevant information.
  * @return A string containing the recognized text and the time of extraction.
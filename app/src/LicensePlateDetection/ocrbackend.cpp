@@ -0,0 +1,239 @@
+#include "ocrbackend.h"
+#include "imagedecoder.h"
+
+#include <algorithm>
+
+namespace
+{
+	// The same alphabets as the whitelists of the Tesseract engines, in the order of the outputs of the network heads.
+	const std::string letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	const std::string digits = "0123456789";
+
+#ifdef _DEBUG
+	const std::string defaultModelPath = "../../../platechars.onnx";
+#else
+	const std::string defaultModelPath = "platechars.onnx";
+#endif
+
+	struct BackendState
+	{
+		std::mutex mutex;
+		std::shared_ptr<OcrBackend> backend = std::make_shared<TesseractBackend>();
+	};
+
+	BackendState& backendState()
+	{
+		static BackendState state;
+		return state;
+	}
+}
+
+std::shared_ptr<OcrBackend> OcrBackend::current()
+{
+	BackendState& state = backendState();
+
+	std::lock_guard<std::mutex> lock(state.mutex);
+	return state.backend;
+}
+
+OcrBackendType TesseractBackend::type() const
+{
+	return OcrBackendType::Tesseract;
+}
+
+bool TesseractBackend::readWords(const cv::Mat& src, std::array<std::string, 3>& texts, std::array<float, 3>& confidences, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const std::array<bool, 3>& charTypes, const RecognitionMode& mode)
+{
+	for (int i = 0; i < words.size(); i++)
+	{
+		texts[i].clear();
+		confidences[i] = 0;
+
+		if (!Algorithm::applyTesseract(src, texts[i], words[i], paddedWords[i], charTypes[i], confidences[i], mode))
+			return false;
+	}
+
+	return true;
+}
+
+CnnBackend::CnnBackend(const std::string& modelPath)
+{
+	if (!ImageDecoder::readFile(modelPath.empty() ? defaultModelPath : modelPath, model))
+		return;
+
+	cv::dnn::Net net;
+	if (!acquire(net))
+	{
+		model.clear();
+		return;
+	}
+
+	release(net);
+}
+
+bool CnnBackend::isLoaded() const
+{
+	return !model.empty();
+}
+
+OcrBackendType CnnBackend::type() const
+{
+	return OcrBackendType::Cnn;
+}
+
+bool CnnBackend::prepareChar(const cv::Mat& src, const cv::Rect& paddedChar, const cv::Size& charSize, cv::Mat& dst)
+{
+	if (src.empty() || src.type() != CV_8UC1 || charSize.empty())
+		return false;
+
+	// The padded box is centred on the character, even once Tesseract has shrunk it.
+	cv::Rect roi(paddedChar.x + (paddedChar.width - charSize.width) / 2, paddedChar.y + (paddedChar.height - charSize.height) / 2, charSize.width, charSize.height);
+	roi &= cv::Rect(0, 0, src.cols, src.rows);
+
+	if (roi.empty())
+		return false;
+
+	// The square keeps the aspect ratio of the character, which is all that tells a "1" from an "I".
+	int side = std::max(roi.width, roi.height);
+	int margin = side / 8;
+	int top = (side - roi.height) / 2;
+	int left = (side - roi.width) / 2;
+
+	cv::Mat square;
+	cv::copyMakeBorder(src(roi), square, top + margin, side - roi.height - top + margin, left + margin, side - roi.width - left + margin, cv::BORDER_CONSTANT, cv::Scalar(0));
+
+	cv::resize(square, dst, cv::Size(inputSize, inputSize), 0, 0, cv::INTER_AREA);
+
+	return true;
+}
+
+bool CnnBackend::readWords(const cv::Mat& src, std::array<std::string, 3>& texts, std::array<float, 3>& confidences, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const std::array<bool, 3>& charTypes, const RecognitionMode& mode)
+{
+	if (!isLoaded() || src.empty() || src.type() != CV_8UC1)
+		return false;
+
+	std::vector<cv::Mat> chars;
+	for (int i = 0; i < words.size(); i++)
+	{
+		if (words[i].empty() || words[i].size() != paddedWords[i].size())
+			return false;
+
+		for (int j = 0; j < words[i].size(); j++)
+		{
+			cv::Mat input;
+			if (!prepareChar(src, paddedWords[i][j], words[i][j].size(), input))
+				return false;
+
+			chars.push_back(input);
+		}
+	}
+
+	cv::Mat blob = cv::dnn::blobFromImages(chars, 1.0 / 255);
+
+	cv::dnn::Net net;
+	if (!acquire(net))
+		return false;
+
+	// Both heads are computed for every character in the same forward pass, and each character is read from the head of its word.
+	std::vector<cv::Mat> outputs;
+	try
+	{
+		net.setInput(blob);
+		net.forward(outputs, std::vector<cv::String>{ "letters", "digits" });
+	}
+	catch (const cv::Exception&)
+	{
+		release(net);
+		return false;
+	}
+
+	release(net);
+
+	if (outputs.size() != 2)
+		return false;
+
+	const int count = static_cast<int>(chars.size());
+	const std::array<cv::Mat, 2> logits = { outputs[0].reshape(1, count), outputs[1].reshape(1, count) };
+	if (logits[0].cols != letters.size() || logits[1].cols != digits.size())
+		return false;
+
+	int index = 0;
+	for (int i = 0; i < words.size(); i++)
+	{
+		texts[i].clear();
+		confidences[i] = 0;
+
+		const std::string& alphabet = charTypes[i] ? digits : letters;
+		for (int j = 0; j < words[i].size(); j++, index++)
+		{
+			cv::Mat scores = logits[charTypes[i]].row(index);
+
+			double maxScore;
+			cv::Point maxLocation;
+			cv::minMaxLoc(scores, nullptr, &maxScore, nullptr, &maxLocation);
+
+			// The softmax probability of the best class, computed relative to its score so that the exponentials cannot overflow.
+			cv::Mat exponentials;
+			cv::exp(scores - maxScore, exponentials);
+
+			texts[i] += alphabet[maxLocation.x];
+			confidences[i] += static_cast<float>(100 / cv::sum(exponentials)[0]);
+		}
+	}
+
+	return true;
+}
+
+bool CnnBackend::acquire(cv::dnn::Net& net)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!nets.empty())
+		{
+			net = nets.back();
+			nets.pop_back();
+			return true;
+		}
+	}
+
+	if (model.empty())
+		return false;
+
+	try
+	{
+		net = cv::dnn::readNetFromONNX(model);
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+
+	return !net.empty();
+}
+
+void CnnBackend::release(const cv::dnn::Net& net)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	nets.push_back(net);
+}
+
+bool setOcrBackend(const OcrBackendType& type, const std::string& modelPath)
+{
+	std::shared_ptr<OcrBackend> backend;
+	if (type == OcrBackendType::Cnn)
+	{
+		auto cnn = std::make_shared<CnnBackend>(modelPath);
+		if (!cnn->isLoaded())
+			return false;
+
+		backend = cnn;
+	}
+	else
+		backend = std::make_shared<TesseractBackend>();
+
+	BackendState& state = backendState();
+
+	std::lock_guard<std::mutex> lock(state.mutex);
+	state.backend = backend;
+
+	return true;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include "licenseplatedetection.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/dnn.hpp>
+
+/**
+ * @enum OcrBackendType
+ * @brief Selects the engine that reads the characters of the plates.
+ */
+enum class OcrBackendType
+{
+	Tesseract,
+	Cnn
+};
+
+/**
+ * @class OcrBackend
+ * @brief The interface of the engines that read the segmented characters of a plate, behind Algorithm::readText and Algorithm::readWords.
+ *
+ * A backend reads the three words of a plate at once and returns the text and the summed confidence of each word,
+ * between 0 and 100 per character. The backend is shared by the whole process, so it must be safe to call from several threads.
+ */
+class LICENSEPLATEDETECTION_API OcrBackend
+{
+public:
+	virtual ~OcrBackend() = default;
+
+	/**
+	 * @brief Returns the type of the backend.
+	 * @return The type of the backend.
+	 */
+	virtual OcrBackendType type() const = 0;
+
+	/**
+	 * @brief Reads the three words of a plate.
+	 * @param[in] src The binary image of the plate, with white characters on black.
+	 * @param[out] texts The text of each word.
+	 * @param[out] confidences The sum of the confidences of the characters of each word.
+	 * @param[in] words The bounding boxes of the characters of each word, which give the size of each character.
+	 * @param[in,out] paddedWords The padded bounding boxes of the characters of each word in `src`. A backend may shrink them.
+	 * @param[in] charTypes The type of the characters of each word (true for digits, false for letters).
+	 * @param[in] mode The recognition mode, for the backends that read the words in several ways.
+	 * @return Returns true if every word was read, false otherwise.
+	 */
+	virtual bool readWords(const cv::Mat& src, std::array<std::string, 3>& texts, std::array<float, 3>& confidences, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const std::array<bool, 3>& charTypes, const RecognitionMode& mode) = 0;
+
+	/**
+	 * @brief Returns the backend selected for the process, the Tesseract one unless another was selected.
+	 * @return A shared pointer to the backend, which stays valid even if another backend is selected meanwhile.
+	 */
+	static std::shared_ptr<OcrBackend> current();
+};
+
+/**
+ * @class TesseractBackend
+ * @brief Reads the words with the pooled Tesseract LSTM engines, whose whitelists restrict them to letters or digits.
+ *
+ * The characters that Tesseract does not read are searched by shrinking their boxes, with the Dice template
+ * matching of "I" as a last resort, as described for Algorithm::applyTesseract.
+ */
+class LICENSEPLATEDETECTION_API TesseractBackend : public OcrBackend
+{
+public:
+	OcrBackendType type() const override;
+
+	bool readWords(const cv::Mat& src, std::array<std::string, 3>& texts, std::array<float, 3>& confidences, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const std::array<bool, 3>& charTypes, const RecognitionMode& mode) override;
+};
+
+/**
+ * @class CnnBackend
+ * @brief Reads the words with a small convolutional character classifier run through cv::dnn.
+ *
+ * Every character of the plate is cropped, centred in a square and scaled to the input size of the network, and all of them
+ * go through the network in a single batched forward pass. The network has a head for letters and one for digits, matching
+ * the whitelists of the Tesseract engines, and each character is read from the head of its word. The confidence of a character
+ * is its softmax probability. The shipped ONNX model is trained by training/train_platechars.py, the NumPy version of
+ * training/train_platechars.ipynb. Since a network cannot run two forward passes at once, the backend keeps a pool of networks
+ * that only grows with the number of concurrent readers.
+ */
+class LICENSEPLATEDETECTION_API CnnBackend : public OcrBackend
+{
+public:
+	/**
+	 * @brief Loads the character classifier.
+	 * @param[in] modelPath The path of the ONNX model, or an empty string for platechars.onnx next to the application.
+	 */
+	explicit CnnBackend(const std::string& modelPath = "");
+
+	CnnBackend(const CnnBackend&) = delete;
+
+	CnnBackend& operator=(const CnnBackend&) = delete;
+
+	/**
+	 * @brief Checks whether the model was loaded.
+	 * @return Returns true if the backend can read characters, false otherwise.
+	 */
+	bool isLoaded() const;
+
+	OcrBackendType type() const override;
+
+	/**
+	 * @brief Reads the three words of a plate in a single forward pass of the network.
+	 * @details Every character is classified on its own, so there is only one way to read the words and the recognition mode,
+	 *          which only selects how the Tesseract backend passes the characters to its engines, is ignored.
+	 *          The padded boxes are never shrunk.
+	 * @param[in] src The binary image of the plate, with white characters on black.
+	 * @param[out] texts The text of each word.
+	 * @param[out] confidences The sum of the softmax probabilities of the characters of each word, in percents.
+	 * @param[in] words The bounding boxes of the characters of each word, which give the size of each character.
+	 * @param[in,out] paddedWords The padded bounding boxes of the characters of each word in `src`.
+	 * @param[in] charTypes The type of the characters of each word (true for digits, false for letters).
+	 * @param[in] mode Ignored.
+	 * @return Returns true if every word was read, false if the model was not loaded, a character lies outside the image
+	 *         or the forward pass failed.
+	 */
+	bool readWords(const cv::Mat& src, std::array<std::string, 3>& texts, std::array<float, 3>& confidences, const std::array<std::vector<cv::Rect>, 3>& words, std::array<std::vector<cv::Rect>, 3>& paddedWords, const std::array<bool, 3>& charTypes, const RecognitionMode& mode) override;
+
+	/**
+	 * @brief Prepares a character for the network, exactly as the training images are prepared.
+	 * @details The character is cropped from the centre of its padded box, centred in a black square with a margin
+	 *          and scaled to the input size of the network.
+	 * @param[in] src The binary image of the plate.
+	 * @param[in] paddedChar The padded bounding box of the character in `src`.
+	 * @param[in] charSize The size of the character.
+	 * @param[out] dst The input image of the character, of inputSize x inputSize pixels.
+	 * @return Returns false if the character lies outside the image, true otherwise.
+	 */
+	static bool prepareChar(const cv::Mat& src, const cv::Rect& paddedChar, const cv::Size& charSize, cv::Mat& dst);
+
+	/**
+	 * @brief The width and height of the input images of the network.
+	 */
+	static constexpr int inputSize = 32;
+
+private:
+	/**
+	 * @brief Borrows an idle network from the pool, or creates one from the loaded model.
+	 * @param[out] net The borrowed network.
+	 * @return Returns false if the network could not be created, true otherwise.
+	 */
+	bool acquire(cv::dnn::Net& net);
+
+	/**
+	 * @brief Returns a borrowed network to the pool.
+	 * @param[in] net The network.
+	 * @return void
+	 */
+	void release(const cv::dnn::Net& net);
+
+private:
+	std::vector<uchar> model;
+	std::mutex mutex;
+	std::vector<cv::dnn::Net> nets;
+};
+
+/**
+ * @brief Selects the OCR backend of the whole process.
+ * @details The words read while the backend changes finish with the backend they started with.
+ * @param[in] type The type of the backend.
+ * @param[in] modelPath The path of the ONNX model of the CNN backend, or an empty string for platechars.onnx next to the application.
+ * @return Returns true if the backend was selected, false if its model could not be loaded, in which case the current backend is kept.
+ */
+bool LICENSEPLATEDETECTION_API setOcrBackend(const OcrBackendType& type, const std::string& modelPath = "");
@@ -0,0 +1,78 @@
+#include "pipelinepolicy.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+	struct DumpState
+	{
+		std::mutex mutex;
+		std::string directory;
+		std::atomic<bool> active;
+		std::atomic<int> sequence;
+
+		DumpState() : active(false), sequence(0)
+		{
+			const char* env = std::getenv("LPR_DUMP_DIRECTORY");
+			if (env)
+				set(env);
+		}
+
+		void set(const std::string& directory)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (!directory.empty())
+			{
+				std::error_code error;
+				std::filesystem::create_directories(directory, error);
+			}
+
+			this->directory = directory;
+			active = !directory.empty();
+		}
+	};
+
+	DumpState& dumpState()
+	{
+		static DumpState state;
+		return state;
+	}
+}
+
+void DumpVisualization::setDirectory(const std::string& directory)
+{
+	dumpState().set(directory);
+}
+
+bool DumpVisualization::isActive()
+{
+	return dumpState().active.load(std::memory_order_relaxed);
+}
+
+void DumpVisualization::write(const char* name, const cv::Mat& image)
+{
+	if (image.empty())
+		return;
+
+	DumpState& state = dumpState();
+
+	std::string directory;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		directory = state.directory;
+	}
+
+	if (directory.empty())
+		return;
+
+	std::ostringstream fileName;
+	fileName << std::setw(6) << std::setfill('0') << state.sequence++ << "_" << name << ".png";
+
+	cv::imwrite((std::filesystem::path(directory) / fileName.str()).string(), image);
+}
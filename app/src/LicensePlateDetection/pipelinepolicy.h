@@ -0,0 +1,142 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @struct NoVisualization
+ * @brief The visualization policy of production builds, which discards every intermediate image.
+ *
+ * The drawing callbacks passed to dump are never called, so the pipeline instantiated with this policy
+ * contains no drawing code at all.
+ */
+struct NoVisualization
+{
+	static constexpr bool enabled = false;
+
+	template <typename Draw>
+	static void dump(const char*, const Draw&)
+	{
+	}
+};
+
+/**
+ * @struct DumpVisualization
+ * @brief The visualization policy of diagnostic builds, which writes the intermediate images of the pipeline to a directory.
+ *
+ * The images are only drawn while a dump directory is set, either with setDirectory or through the LPR_DUMP_DIRECTORY
+ * environment variable, and are written as PNG files prefixed by a sequence number, in the order in which they were produced.
+ */
+struct LICENSEPLATEDETECTION_API DumpVisualization
+{
+	static constexpr bool enabled = true;
+
+	/**
+	 * @brief Draws an intermediate image and writes it to the dump directory.
+	 * @param[in] name The name of the image, used in its file name.
+	 * @param[in] draw A callback that returns the image, only called when a dump directory is set.
+	 * @return void
+	 */
+	template <typename Draw>
+	static void dump(const char* name, const Draw& draw)
+	{
+		if (isActive())
+			write(name, draw());
+	}
+
+	/**
+	 * @brief Sets the directory where the intermediate images are written.
+	 * @param[in] directory The directory, created if needed, or an empty string to stop writing images.
+	 * @return void
+	 */
+	static void setDirectory(const std::string& directory);
+
+	/**
+	 * @brief Checks whether a dump directory is set.
+	 * @return Returns true if the intermediate images are written, false otherwise.
+	 */
+	static bool isActive();
+
+	/**
+	 * @brief Writes an intermediate image to the dump directory.
+	 * @param[in] name The name of the image, used in its file name.
+	 * @param[in] image The image to write. Empty images are skipped.
+	 * @return void
+	 */
+	static void write(const char* name, const cv::Mat& image);
+};
+
+/**
+ * @brief The visualization policy of the current build: intermediate images are dumped in debug builds only.
+ */
+#ifdef _DEBUG
+using BuildVisualization = DumpVisualization;
+#else
+using BuildVisualization = NoVisualization;
+#endif
+
+/**
+ * @struct DefaultProfile
+ * @brief The thresholds of the recognition pipeline for a camera a few meters in front of the vehicles.
+ *
+ * The thresholds are compile-time constants, so every pipeline instantiated with a profile has them folded into its code.
+ * The areas are fractions of the lower part of the frame where the plates are searched, and the heights are fractions of the width.
+ */
+struct DefaultProfile
+{
+	static constexpr uchar whiteThreshold = 125;
+	static constexpr int maxComponents = 10;
+	static constexpr float minPlateArea = 0.01f;
+	static constexpr float maxPlateArea = 0.15f;
+	static constexpr float minPlateHeight = 0.2f;
+	static constexpr float maxPlateHeight = 0.9f;
+	static constexpr float candidatePadding = 0.05f;
+	static constexpr float edgeCoverage = 0.8f;
+	static constexpr float warpPadding = 0.2f;
+	static constexpr float denoiseRatio = 0.15f;
+	static constexpr float charPadding = 0.6f;
+};
+
+/**
+ * @struct DistantProfile
+ * @brief The thresholds for a camera far from the lane, such as one covering a whole gate, where the plates are small.
+ */
+struct DistantProfile : DefaultProfile
+{
+	static constexpr float minPlateArea = 0.002f;
+	static constexpr float maxPlateArea = 0.04f;
+	static constexpr int maxComponents = 20;
+};
+
+/**
+ * @struct CloseProfile
+ * @brief The thresholds for a camera right in front of the barrier, where a plate can fill a large part of the frame.
+ */
+struct CloseProfile : DefaultProfile
+{
+	static constexpr float minPlateArea = 0.03f;
+	static constexpr float maxPlateArea = 0.4f;
+};
+
+/**
+ * @enum ThresholdProfile
+ * @brief Selects the threshold profile of a recognizer at run time, for instance per camera.
+ */
+enum class ThresholdProfile
+{
+	Default,
+	Distant,
+	Close
+};
@@ -0,0 +1,532 @@
+#include "platerecognizer.h"
+#include "imagedecoder.h"
+#include "stageprofiler.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+	// Calls a generic callback with the threshold profile selected at run time, so that the pipeline is instantiated once per profile.
+	template <typename Function>
+	auto withProfile(const ThresholdProfile& profile, const Function& function)
+	{
+		switch (profile)
+		{
+		case ThresholdProfile::Distant:
+			return function(DistantProfile());
+		case ThresholdProfile::Close:
+			return function(CloseProfile());
+		default:
+			return function(DefaultProfile());
+		}
+	}
+
+	// Draws the characters of each word of a plate in its own colour, for the visualization policies.
+	cv::Mat drawWords(const cv::Mat& src, const std::array<std::vector<cv::Rect>, 3>& words)
+	{
+		static const cv::Scalar colours[3] = { cv::Scalar(255, 0, 0), cv::Scalar(0, 255, 0), cv::Scalar(0, 0, 255) };
+
+		cv::Mat drawn;
+		if (src.empty() || src.type() != CV_8UC1)
+			return drawn;
+
+		cv::cvtColor(src, drawn, cv::COLOR_GRAY2BGR);
+		for (int i = 0; i < words.size(); i++)
+			for (const auto& character : words[i])
+				cv::rectangle(drawn, character, colours[i], 2);
+
+		return drawn;
+	}
+}
+
+PlateResult PlateRecognizer::recognize(const cv::Mat& src, const int& reduction)
+{
+	ScopedStageTimer totalTimer(PipelineStage::Total);
+
+	cv::Rect wholeRegion, hotspot;
+	bool tried = false;
+
+	// The hotspot of the camera is searched first, at full quality, and the whole region only if no plate is read there.
+	{
+		ScopedStageTimer timer(PipelineStage::Preprocessing);
+
+		if (!prepareFrame(src, reduction))
+		{
+			timer.reject();
+			return invalidResult();
+		}
+
+		wholeRegion = cv::Rect(cv::Point(0, 0), region.size());
+		tried = spatialPrior && spatialPrior->hotspot(region.size(), hotspot);
+
+		search(tried ? hotspot : wholeRegion);
+	}
+
+	size_t searchedPixels = window.area();
+	proposeCandidates();
+	int best = readCandidates();
+
+	bool hit = tried && best < candidateCount;
+	if (tried && !hit)
+	{
+		{
+			ScopedStageTimer timer(PipelineStage::Preprocessing);
+			search(wholeRegion);
+		}
+
+		searchedPixels += window.area();
+		proposeCandidates();
+		best = readCandidates();
+	}
+
+	if (spatialPrior)
+	{
+		if (best < candidateCount)
+			spatialPrior->update(candidates[best].roi + window.tl(), region.size());
+
+		spatialPrior->record(tried, hit, searchedPixels, wholeRegion.area());
+	}
+
+	return annotate(best);
+}
+
+int PlateRecognizer::readCandidates()
+{
+	// The candidates are evaluated concurrently, but the lowest ranked one that is read still wins, exactly as in a sequential scan.
+	// Once a candidate is read, every candidate ranked after it is cancelled at the next stage boundary.
+	// At most as many candidates as the thread budget of the lane are evaluated at once, each stripe taking every stripes-th
+	// candidate so that the best ranked ones are evaluated first.
+	std::atomic<int> winner(candidateCount);
+	int stripes = std::min(candidateCount, getThreadBudget());
+	if (stripes <= 0)
+		return winner.load();
+
+	cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range)
+		{
+			for (int stripe = range.start; stripe < range.end; stripe++)
+				for (int i = stripe; i < candidateCount; i += stripes)
+				{
+					auto isCancelled = [&winner, i]()
+						{
+							return winner.load() < i;
+						};
+
+					if (isCancelled() || !rectifyCandidate(candidates[i], cropped, gauss, isCancelled, profile))
+						continue;
+
+					if (isCancelled() || !readCandidate(candidates[i]))
+						continue;
+
+					int current = winner.load();
+					while (i < current && !winner.compare_exchange_weak(current, i));
+				}
+		}, static_cast<double>(stripes));
+
+	return winner.load();
+}
+
+PlateResult PlateRecognizer::recognize(const std::vector<uchar>& buffer, const bool& fullResolution)
+{
+	int reduction = fullResolution ? 1 : 2;
+
+	{
+		ScopedStageTimer timer(PipelineStage::Decoding);
+
+		if (!ImageDecoder::decode(buffer, decoded, reduction))
+			return invalidResult();
+	}
+
+	return recognize(decoded, reduction);
+}
+
+PlateResult PlateRecognizer::invalidResult()
+{
+	std::string dateTime;
+	std::string plate = "N/A";
+	float confidence = 0;
+
+	Algorithm::drawBBoxes(cv::Mat(), cv::Rect(), dateTime, plate, confidence);
+	return PlateResult{ plate, confidence, cv::Rect(), dateTime, cv::Mat() };
+}
+
+bool PlateRecognizer::prepare(const cv::Mat& src, const int& reduction)
+{
+	ScopedStageTimer timer(PipelineStage::Preprocessing);
+
+	if (!prepareFrame(src, reduction))
+		return timer.reject();
+
+	search(cv::Rect(cv::Point(0, 0), region.size()));
+
+	return true;
+}
+
+bool PlateRecognizer::prepareFrame(const cv::Mat& src, const int& reduction)
+{
+	candidateCount = 0;
+
+	if (src.empty() || (src.type() != CV_8UC4 && src.type() != CV_8UC3) || (reduction != 1 && reduction != 2))
+		return false;
+
+	sourceReduction = reduction;
+
+	cv::Mat bgrSrc = src;
+	if (src.type() == CV_8UC4)
+	{
+		cv::cvtColor(src, bgr, cv::COLOR_BGRA2BGR);
+		bgrSrc = bgr;
+	}
+
+	// The annotated image belongs to the result handed to the caller, so every frame is annotated on a new image.
+	annotated = bgrSrc.clone();
+
+	// A source halved by the decoder is already at the resolution of the pipeline, which only reads it.
+	if (reduction == 2)
+		halved = bgrSrc;
+	else
+		cv::resize(bgrSrc, halved, cv::Size(bgrSrc.cols / 2, bgrSrc.rows / 2));
+
+	// The frames of a calibrated camera are searched once undistorted and rotated back, where the plates are close to rectangles.
+	calibrated = calibration && calibration->normalize(halved, normalized);
+	const cv::Mat& frame = calibrated ? normalized : halved;
+
+	cv::Rect roi(frame.cols * 0.1, frame.rows / 2, frame.cols - frame.cols * 0.1, frame.rows / 2);
+	region = frame(roi);
+	regionOffset = roi.tl();
+
+	return true;
+}
+
+void PlateRecognizer::search(const cv::Rect& window)
+{
+	candidateCount = 0;
+
+	this->window = window & cv::Rect(cv::Point(0, 0), region.size());
+	cropped = region(this->window);
+
+	cv::GaussianBlur(cropped, gauss, cv::Size(3, 3), 0);
+}
+
+bool PlateRecognizer::propose(const cv::Mat& src, const int& reduction)
+{
+	if (!prepare(src, reduction))
+		return false;
+
+	proposeCandidates();
+
+	return true;
+}
+
+void PlateRecognizer::proposeCandidates()
+{
+	withProfile(profile, [this](auto thresholds)
+		{
+			proposeCandidates<decltype(thresholds), BuildVisualization>();
+		});
+}
+
+template <typename Profile, typename Visualization>
+void PlateRecognizer::proposeCandidates()
+{
+	candidateCount = 0;
+	proposals.clear();
+
+	// The plates of a calibrated camera have the size measured on its frames, whatever the threshold profile.
+	PlateBounds bounds{ Profile::minPlateArea, Profile::maxPlateArea, Profile::minPlateHeight, Profile::maxPlateHeight };
+	if (calibrated)
+		calibration->getPlateBounds(bounds);
+
+	{
+		ScopedStageTimer timer(PipelineStage::ConnectedComponents);
+
+		Algorithm::BGR2Binary(gauss, binary, Profile::whiteThreshold);
+
+		areas.clear();
+		Algorithm::getConnectedComponents(binary, labels, stats, centroids, areas, Profile::maxComponents);
+
+		for (int i = 0; i < areas.size(); i++)
+		{
+			cv::Rect roi;
+			int label = areas[i].first;
+			Algorithm::getRoi(stats, roi, label);
+
+			Visualization::dump("connectedComponent", [&]()
+				{
+					return cropped(roi);
+				});
+
+			// The size of a plate is relative to the whole region, even when only its hotspot is searched.
+			if (!Algorithm::sizeBBox(region, roi, bounds.minArea, bounds.maxArea) ||
+				!Algorithm::heightBBox(roi, bounds.minHeight, bounds.maxHeight))
+				continue;
+
+			proposals.push_back(std::make_pair(static_cast<float>(areas[i].second) / roi.area(), roi));
+		}
+
+		if (proposals.empty())
+			timer.reject();
+	}
+
+	if (candidateScoring && !proposals.empty())
+	{
+		ScopedStageTimer timer(PipelineStage::CandidateScoring);
+
+		// The regions that cannot be plates are dropped before any buffer of a candidate is touched, and the rest are ranked
+		// by their score instead of their area. The fill of a region is replaced by its score.
+		Algorithm::candidateFeatures(gauss, binary, features, featuresIntegral);
+
+		int kept = 0;
+		for (int i = 0; i < proposals.size(); i++)
+		{
+			float fill = proposals[i].first;
+			if (Algorithm::candidateScore(featuresIntegral, proposals[i].second, fill, proposals[i].first))
+				proposals[kept++] = proposals[i];
+		}
+		proposals.resize(kept);
+
+		std::stable_sort(proposals.begin(), proposals.end(), [](const std::pair<float, cv::Rect>& a, const std::pair<float, cv::Rect>& b)
+			{
+				return a.first > b.first;
+			});
+
+		if (proposals.empty())
+			timer.reject();
+	}
+
+	for (const auto& proposal : proposals)
+	{
+		cv::Rect roi = proposal.second;
+		Algorithm::paddingRect(roi, roi, Profile::candidatePadding, false, cropped.size());
+
+		if (candidateCount == candidates.size())
+			candidates.emplace_back();
+		candidates[candidateCount++].roi = roi;
+	}
+}
+
+void PlateRecognizer::setCandidateScoring(const bool& enabled)
+{
+	candidateScoring = enabled;
+}
+
+void PlateRecognizer::setProfile(const ThresholdProfile& profile)
+{
+	this->profile = profile;
+}
+
+void PlateRecognizer::setSpatialPrior(SpatialPrior* prior)
+{
+	spatialPrior = prior;
+}
+
+void PlateRecognizer::setCalibration(const CameraCalibration* calibration)
+{
+	this->calibration = calibration;
+}
+
+PlateResult PlateRecognizer::annotate(const int& best)
+{
+	std::string dateTime;
+	std::string plate;
+	float confidence = 0;
+
+	cv::Rect roiConnectedComponent;
+	if (best >= 0 && best < candidateCount)
+	{
+		roiConnectedComponent = candidates[best].roi + window.tl();
+
+		// The plate is annotated and returned in the frame as it was taken, not in its normalized version.
+		if (calibrated)
+			roiConnectedComponent = calibration->toSource(roiConnectedComponent + regionOffset) - regionOffset;
+
+		plate = candidates[best].plate;
+		confidence = candidates[best].confidence;
+	}
+
+	if (plate.empty())
+		plate = "N/A";
+
+	{
+		ScopedStageTimer timer(PipelineStage::Annotation);
+		Algorithm::drawBBoxes(annotated, roiConnectedComponent, dateTime, plate, confidence, 2 / sourceReduction);
+	}
+
+	return PlateResult{ plate, confidence, roiConnectedComponent, dateTime, annotated };
+}
+
+cv::Mat PlateRecognizer::view(cv::Mat& buffer, const cv::Size& size, const int& type)
+{
+	if (buffer.type() != type || buffer.cols < size.width || buffer.rows < size.height)
+		buffer.create(cv::Size(std::max(buffer.cols, size.width), std::max(buffer.rows, size.height)), type);
+
+	return buffer(cv::Rect(cv::Point(0, 0), size));
+}
+
+bool PlateRecognizer::rectifyCandidate(Candidate& candidate, const cv::Mat& src, const cv::Mat& gauss, const std::function<bool()>& isCancelled, const ThresholdProfile& profile)
+{
+	return withProfile(profile, [&](auto thresholds)
+		{
+			return rectifyCandidate<decltype(thresholds), BuildVisualization>(candidate, src, gauss, isCancelled);
+		});
+}
+
+template <typename Profile, typename Visualization>
+bool PlateRecognizer::rectifyCandidate(Candidate& candidate, const cv::Mat& src, const cv::Mat& gauss, const std::function<bool()>& isCancelled)
+{
+	static const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
+
+	const cv::Rect& roi = candidate.roi;
+
+	candidate.plate.clear();
+	candidate.confidence = 0;
+	candidate.largestContour.clear();
+	candidate.quadrilateralCoordinates.clear();
+	candidate.chars.clear();
+	candidate.paddedChars.clear();
+	for (int i = 0; i < 3; i++)
+	{
+		candidate.words[i].clear();
+		candidate.paddedWords[i].clear();
+	}
+
+	cv::Mat hsvConnectedComponent = view(candidate.hsv, roi.size(), CV_8UC3);
+	cv::Mat bgrConnectedComponent = view(candidate.bgr, roi.size(), CV_8UC3);
+	cv::Mat grayConnectedComponent = view(candidate.gray, roi.size(), CV_8UC1);
+	cv::Mat connectedComponent = view(candidate.connectedComponent, roi.size(), CV_8UC1);
+	{
+		ScopedStageTimer timer(PipelineStage::ColourConversion);
+
+		Algorithm::BGR2HSV(gauss(roi), hsvConnectedComponent);
+		Algorithm::blueToBlack(hsvConnectedComponent, hsvConnectedComponent);
+
+		Algorithm::HSV2BGR(hsvConnectedComponent, bgrConnectedComponent);
+
+		cv::cvtColor(bgrConnectedComponent, grayConnectedComponent, cv::COLOR_BGR2GRAY);
+
+		cv::cvtColor(src(roi), connectedComponent, cv::COLOR_BGR2GRAY);
+	}
+
+	if (isCancelled())
+		return false;
+
+	cv::Mat edges = view(candidate.edges, roi.size(), CV_8UC1);
+	{
+		ScopedStageTimer timer(PipelineStage::EdgeDetection);
+
+		cv::threshold(grayConnectedComponent, edges, 0, 255, cv::THRESH_BINARY);
+		cv::bitwise_not(edges, edges);
+		Algorithm::edgeDetection(connectedComponent, edges, &candidate.buffers);
+	}
+
+	cv::Mat regionContour = view(candidate.regionContour, roi.size(), CV_8UC1);
+	{
+		ScopedStageTimer timer(PipelineStage::RoiContour);
+
+		if (!Algorithm::roiContour(connectedComponent, regionContour, candidate.largestContour, edges, Profile::edgeCoverage, &candidate.buffers))
+			return timer.reject();
+
+		cv::erode(regionContour, regionContour, kernel);
+		cv::dilate(regionContour, regionContour, kernel);
+
+		Algorithm::roiContour(regionContour, regionContour, candidate.largestContour, cv::Mat(), 0.0f, &candidate.buffers);
+	}
+
+	{
+		ScopedStageTimer timer(PipelineStage::CornersCoordinates);
+
+		if (!Algorithm::cornersCoordinates<Visualization>(regionContour, candidate.quadrilateralCoordinates, candidate.largestContour, &candidate.buffers))
+			return timer.reject();
+	}
+
+	if (isCancelled())
+		return false;
+
+	{
+		ScopedStageTimer timer(PipelineStage::GeometricalTransformation);
+
+		if (!Algorithm::resizeToPoints(connectedComponent, candidate.resized, candidate.quadrilateralCoordinates, Profile::warpPadding))
+			return timer.reject();
+
+		if (!Algorithm::geometricalTransformation(candidate.resized, candidate.transformed, candidate.quadrilateralCoordinates, Profile::warpPadding))
+			return timer.reject();
+
+		Algorithm::insideContour(candidate.transformed, candidate.text, &candidate.buffers);
+	}
+
+	{
+		ScopedStageTimer timer(PipelineStage::Denoise);
+
+		// denoise copies the kept contours through a mask, so the reused buffer has to start black like a new one.
+		candidate.denoised.create(candidate.text.size(), CV_8UC1);
+		candidate.denoised.setTo(0);
+		if (!Algorithm::denoise(candidate.text, candidate.denoised, Profile::denoiseRatio, &candidate.buffers))
+			return timer.reject();
+
+		cv::dilate(candidate.denoised, candidate.denoised, cv::Mat());
+		cv::erode(candidate.denoised, candidate.denoised, cv::Mat());
+
+		if (!Algorithm::denoise(candidate.denoised, candidate.denoised, Profile::denoiseRatio, &candidate.buffers))
+			return timer.reject();
+	}
+
+	if (isCancelled())
+		return false;
+
+	{
+		ScopedStageTimer timer(PipelineStage::Segmentation);
+
+		Algorithm::charsBBoxes(candidate.denoised, candidate.chars, &candidate.buffers);
+
+		std::array<int, 3> indexes;
+		if (!Algorithm::firstIndexes(candidate.chars, indexes))
+			return timer.reject();
+
+		Algorithm::paddingChars(candidate.chars, candidate.paddedChars, Profile::charPadding);
+
+		Algorithm::charsSpacing(candidate.denoised, candidate.spaced, candidate.chars, candidate.paddedChars);
+
+		Algorithm::wordsSeparation(candidate.chars, candidate.words, indexes);
+		Algorithm::wordsSeparation(candidate.paddedChars, candidate.paddedWords, indexes);
+	}
+
+	Visualization::dump("words", [&]()
+		{
+			return drawWords(candidate.denoised, candidate.words);
+		});
+
+	Visualization::dump("paddedWords", [&]()
+		{
+			return drawWords(candidate.spaced, candidate.paddedWords);
+		});
+
+	return true;
+}
+
+bool PlateRecognizer::readCandidate(Candidate& candidate)
+{
+	ScopedStageTimer timer(PipelineStage::ReadText);
+
+	bool read = Algorithm::readText(candidate.spaced, candidate.plate, candidate.confidence, candidate.words, candidate.paddedWords);
+
+	// The padded characters were shrunk around the characters that Tesseract could not read at first.
+	BuildVisualization::dump("readChars", [&]()
+		{
+			return drawWords(candidate.spaced, candidate.paddedWords);
+		});
+
+	if (!read)
+		return timer.reject();
+
+	return true;
+}
+
+bool PlateRecognizer::readCandidateWords(Candidate& candidate, std::array<std::string, 3>& texts, std::array<float, 3>& confidences)
+{
+	ScopedStageTimer timer(PipelineStage::ReadText);
+
+	if (!Algorithm::readWords(candidate.spaced, texts, confidences, candidate.words, candidate.paddedWords))
+		return timer.reject();
+
+	return true;
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include "licenseplatedetection.h"
+#include "pipelinepolicy.h"
+#include "spatialprior.h"
+#include "cameracalibration.h"
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @class PlateRecognizer
+ * @brief Runs the license plate recognition pipeline while reusing its buffers from one frame to the next.
+ *
+ * Every intermediate image of the pipeline, both for the whole frame and for each plate candidate, is owned by the recognizer.
+ * The buffers only grow, so once a few frames of a camera have been processed they are large enough for every candidate
+ * and no image of the pipeline itself has to be allocated again. Only the annotated image is allocated for every frame,
+ * since it is handed to the caller with the result. A recognizer is meant to be used by a single lane,
+ * from one thread at a time.
+ */
+class LICENSEPLATEDETECTION_API PlateRecognizer
+{
+public:
+	PlateRecognizer() = default;
+
+	PlateRecognizer(const PlateRecognizer&) = delete;
+
+	PlateRecognizer& operator=(const PlateRecognizer&) = delete;
+
+public:
+	/**
+	 * @brief Recognizes the license plate in an image.
+	 * @details The annotated image of the result is owned by the caller and is never drawn over by the next frames.
+	 * @param[in] image The source image, in BGR or BGRA format.
+	 * @param[in] reduction 2 if the image was already halved when it was decoded, 1 otherwise. The pipeline works at half the
+	 *            resolution of the source, so a halved image is used as is, and is also the one annotated.
+	 * @return The recognized plate ("N/A" if no plate was read), its confidence, its region, the time of extraction and the annotated image.
+	 */
+	PlateResult recognize(const cv::Mat& image, const int& reduction = 1);
+
+	/**
+	 * @brief Recognizes the license plate in an encoded image, such as the bytes of a JPEG file.
+	 * @details Unless the full resolution is requested, the image is decoded directly at half its resolution, into a buffer
+	 *          reused from one frame to the next, so its full resolution is never decoded nor allocated. The annotated image
+	 *          and the region of the plate are at the decoded resolution.
+	 * @param[in] buffer The encoded image.
+	 * @param[in] fullResolution True to decode the full image, so that the annotated image keeps the resolution of the source,
+	 *            for instance when it is stored, false to decode it at half resolution.
+	 * @return The recognition result, as returned for a decoded image.
+	 */
+	PlateResult recognize(const std::vector<uchar>& buffer, const bool& fullResolution = false);
+
+	/**
+	 * @brief Enables or disables the scoring of the candidates before their rectification.
+	 * @details When enabled, which is the default, the regions without the edges and strokes of text are dropped and the others
+	 *          are ranked by how much they look like a plate. When disabled, every region of the size of a plate is a candidate,
+	 *          ranked by area.
+	 * @param[in] enabled True to score the candidates, false otherwise.
+	 * @return void
+	 */
+	void setCandidateScoring(const bool& enabled);
+
+	/**
+	 * @brief Selects the thresholds of the pipeline, for instance according to the distance between the camera and the vehicles.
+	 * @details Every profile is compiled into its own instance of the pipeline, so switching profiles costs nothing per frame.
+	 * @param[in] profile The threshold profile, ThresholdProfile::Default unless set.
+	 * @return void
+	 */
+	void setProfile(const ThresholdProfile& profile);
+
+	/**
+	 * @brief Attaches the spatial prior of the camera whose frames the recognizer processes.
+	 * @details With a prior, the hotspot where the plates of the camera usually appear is searched first, and the whole
+	 *          region only if no plate is read there. Every plate read updates the heatmap of the prior.
+	 * @param[in] prior The prior of the camera, which must outlive its use by the recognizer, or nullptr to search the whole region.
+	 * @return void
+	 */
+	void setSpatialPrior(SpatialPrior* prior);
+
+	/**
+	 * @brief Attaches the calibration profile of the camera whose frames the recognizer processes.
+	 * @details With a loaded profile, every frame of the resolution of the camera is undistorted and rotated back once, before
+	 *          the plates are searched, and the plate bounds of the profile replace the size thresholds of the threshold profile.
+	 *          The region of the plate is still returned in the coordinates of the frame.
+	 * @param[in] calibration The profile of the camera, which must outlive its use by the recognizer, or nullptr to use the frames as they are.
+	 * @return void
+	 */
+	void setCalibration(const CameraCalibration* calibration);
+
+private:
+	/**
+	 * @struct Candidate
+	 * @brief Holds the region and the reusable buffers of a plate candidate.
+	 */
+	struct Candidate
+	{
+		cv::Rect roi;
+		cv::Mat hsv, bgr, gray, connectedComponent, edges, regionContour;
+		cv::Mat resized, transformed, text, denoised, spaced;
+		std::vector<cv::Point> largestContour;
+		std::vector<cv::Point2f> quadrilateralCoordinates;
+		std::vector<cv::Rect> chars, paddedChars;
+		std::array<std::vector<cv::Rect>, 3> words, paddedWords;
+		AlgorithmBuffers buffers;
+		std::string plate;
+		float confidence = 0;
+	};
+
+	/**
+	 * @brief Returns a view of the requested size and type over a buffer that only grows.
+	 * @param[in,out] buffer The buffer, reallocated only if it is smaller than the requested size or of another type.
+	 * @param[in] size The size of the view.
+	 * @param[in] type The type of the view.
+	 * @return The top-left view of the buffer with the requested size.
+	 */
+	static cv::Mat view(cv::Mat& buffer, const cv::Size& size, const int& type);
+
+	/**
+	 * @brief Returns the result of an image that cannot be recognized.
+	 * @return The "N/A" plate with the time of extraction and no annotated image.
+	 */
+	static PlateResult invalidResult();
+
+	/**
+	 * @brief Prepares an image for the analysis of its plate candidates.
+	 * @details This function prepares the frame and searches its whole region. The candidates are cleared, so that they can be
+	 *          proposed or set directly from a known region.
+	 * @param[in] src The source image, in BGR or BGRA format.
+	 * @param[in] reduction 2 if the image was already halved when it was decoded, 1 otherwise.
+	 * @return Returns false if the image is empty, of another format or of another reduction, true otherwise.
+	 */
+	bool prepare(const cv::Mat& src, const int& reduction = 1);
+
+	/**
+	 * @brief Prepares a frame without searching it.
+	 * @details This function copies the image to a new annotated image, then halves it, unless it was halved when decoded,
+	 *          normalizes it with the calibration profile, if any, and takes the lower part where the plates are as the search region.
+	 * @param[in] src The source image, in BGR or BGRA format.
+	 * @param[in] reduction 2 if the image was already halved when it was decoded, 1 otherwise.
+	 * @return Returns false if the image is empty, of another format or of another reduction, true otherwise.
+	 */
+	bool prepareFrame(const cv::Mat& src, const int& reduction);
+
+	/**
+	 * @brief Selects the part of the search region where the candidates are proposed, and blurs it.
+	 * @details The regions of the candidates are relative to the searched window, which is the cropped image.
+	 *          The candidates are cleared.
+	 * @param[in] window The searched window, in the coordinates of the search region.
+	 * @return void
+	 */
+	void search(const cv::Rect& window);
+
+	/**
+	 * @brief Straightens and reads the proposed candidates concurrently.
+	 * @return The index of the best ranked candidate that was read, or the number of candidates if none was read.
+	 */
+	int readCandidates();
+
+	/**
+	 * @brief Prepares an image and proposes the plate candidates.
+	 * @details This function prepares the image and then proposes its candidates.
+	 * @param[in] src The source image, in BGR or BGRA format.
+	 * @param[in] reduction 2 if the image was already halved when it was decoded, 1 otherwise.
+	 * @return Returns false if the image is empty, of another format or of another reduction, true otherwise, even if no candidate was found.
+	 */
+	bool propose(const cv::Mat& src, const int& reduction = 1);
+
+	/**
+	 * @brief Proposes the plate candidates of the prepared image with the selected threshold profile.
+	 * @return void
+	 */
+	void proposeCandidates();
+
+	/**
+	 * @brief Proposes the plate candidates of the prepared image.
+	 * @details This function isolates the white regions and keeps the connected components with the size of a plate.
+	 *          Unless the scoring is disabled, the regions are then scored on integral images of cheap features,
+	 *          the ones that cannot be plates are dropped and the rest are ranked by score; otherwise they are ranked by area.
+	 * @tparam Profile The threshold profile, such as DefaultProfile.
+	 * @tparam Visualization The visualization policy, NoVisualization or DumpVisualization.
+	 * @return void
+	 */
+	template <typename Profile, typename Visualization>
+	void proposeCandidates();
+
+	/**
+	 * @brief Straightens a plate candidate with a threshold profile selected at run time.
+	 * @param[in,out] candidate The candidate to straighten, whose words are set on success.
+	 * @param[in] src The cropped BGR image that contains the candidate.
+	 * @param[in] gauss The blurred version of `src`, used for the color analysis.
+	 * @param[in] isCancelled A predicate that returns true when the result of this candidate is no longer needed.
+	 * @param[in] profile The threshold profile.
+	 * @return Returns true if the words of the candidate were separated, false if any stage rejected it or the processing was cancelled.
+	 */
+	static bool rectifyCandidate(Candidate& candidate, const cv::Mat& src, const cv::Mat& gauss, const std::function<bool()>& isCancelled, const ThresholdProfile& profile);
+
+	/**
+	 * @brief Straightens a plate candidate and separates its characters into words.
+	 * @details This function isolates the blue band, detects the edges and the contour of the candidate,
+	 *          straightens it with a perspective transformation, denoises it and separates the characters into words.
+	 *          It only reads the shared source images and writes to the candidate's own buffers,
+	 *          so several candidates can be processed concurrently. The cancellation predicate is checked between
+	 *          the expensive stages and the processing stops as soon as it returns true.
+	 * @param[in,out] candidate The candidate to straighten, whose words are set on success.
+	 * @param[in] src The cropped BGR image that contains the candidate.
+	 * @param[in] gauss The blurred version of `src`, used for the color analysis.
+	 * @param[in] isCancelled A predicate that returns true when the result of this candidate is no longer needed.
+	 * @tparam Profile The threshold profile, such as DefaultProfile.
+	 * @tparam Visualization The visualization policy, NoVisualization or DumpVisualization.
+	 * @return Returns true if the words of the candidate were separated, false if any stage rejected it or the processing was cancelled.
+	 */
+	template <typename Profile, typename Visualization>
+	static bool rectifyCandidate(Candidate& candidate, const cv::Mat& src, const cv::Mat& gauss, const std::function<bool()>& isCancelled);
+
+	/**
+	 * @brief Reads the text of a straightened plate candidate.
+	 * @param[in,out] candidate The candidate, whose text and confidence are set on success.
+	 * @return Returns true if the text of the candidate was read, false otherwise.
+	 */
+	static bool readCandidate(Candidate& candidate);
+
+	/**
+	 * @brief Reads the text of each word of a straightened plate candidate separately.
+	 * @param[in,out] candidate The candidate to read.
+	 * @param[out] texts The recognized text of each word.
+	 * @param[out] confidences The average confidence score of each word.
+	 * @return Returns true if the text of every word was read, false otherwise.
+	 */
+	static bool readCandidateWords(Candidate& candidate, std::array<std::string, 3>& texts, std::array<float, 3>& confidences);
+
+	/**
+	 * @brief Annotates the current image with the selected candidate and builds the result.
+	 * @param[in] best The index of the candidate that was read, or any index outside the candidates if none was read.
+	 * @return The recognition result of the current image.
+	 */
+	PlateResult annotate(const int& best);
+
+private:
+	cv::Mat decoded, bgr, annotated, halved, normalized, region, cropped, gauss, binary;
+	cv::Rect window;
+	cv::Point regionOffset;
+	SpatialPrior* spatialPrior = nullptr;
+	const CameraCalibration* calibration = nullptr;
+	bool calibrated = false;
+	int sourceReduction = 1;
+	cv::Mat labels, stats, centroids;
+	std::vector<std::pair<int, int>> areas;
+	cv::Mat features, featuresIntegral;
+	std::vector<std::pair<float, cv::Rect>> proposals;
+	bool candidateScoring = true;
+	ThresholdProfile profile = ThresholdProfile::Default;
+	std::vector<Candidate> candidates;
+	int candidateCount = 0;
+
+	friend class BatchRecognizer;
+
+	friend class StreamRecognizer;
+
+	friend class AlgorithmTests;
+};
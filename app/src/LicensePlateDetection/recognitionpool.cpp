@@ -0,0 +1,72 @@
+#include "recognitionpool.h"
+#include "platerecognizer.h"
+#include "tesseractpool.h"
+
+#include <algorithm>
+#include <memory>
+
+RecognitionPool::RecognitionPool(const int& workers, const int& capacity)
+	: loaded(TesseractPool::getInstance().warmUp(std::max(workers, 1))), pool(loaded ? std::max(workers, 1) : 0, capacity, &RecognitionPool::makeHandler)
+{
+}
+
+bool RecognitionPool::isLoaded() const
+{
+	return loaded;
+}
+
+bool RecognitionPool::submit(std::vector<uchar> buffer, std::future<PlateResult>& result)
+{
+	Job job{ std::move(buffer), std::promise<PlateResult>() };
+	std::future<PlateResult> future = job.result.get_future();
+
+	if (!pool.trySubmit(job))
+		return false;
+
+	result = std::move(future);
+	return true;
+}
+
+size_t RecognitionPool::pending() const
+{
+	return pool.pending();
+}
+
+int RecognitionPool::getWorkers() const
+{
+	return pool.getWorkers();
+}
+
+int RecognitionPool::getCapacity() const
+{
+	return pool.getCapacity();
+}
+
+WorkerPoolStatistics RecognitionPool::getStatistics() const
+{
+	return pool.getStatistics();
+}
+
+WorkerPool<RecognitionPool::Job>::Handler RecognitionPool::makeHandler()
+{
+	auto recognizer = std::make_shared<PlateRecognizer>();
+
+	return [recognizer](Job& job, const double&)
+		{
+			// A failure is handed to the waiting caller instead of ending the worker.
+			try
+			{
+				PlateResult result = recognizer->recognize(job.buffer);
+
+				// The image is decoded at half resolution, but the clients know only the uploaded image.
+				result.roi = cv::Rect(result.roi.x * 2, result.roi.y * 2, result.roi.width * 2, result.roi.height * 2);
+				result.annotated.release();
+
+				job.result.set_value(result);
+			}
+			catch (...)
+			{
+				job.result.set_exception(std::current_exception());
+			}
+		};
+}
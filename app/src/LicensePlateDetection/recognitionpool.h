@@ -0,0 +1,107 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include "licenseplatedetection.h"
+#include "workerpool.h"
+
+#include <future>
+#include <vector>
+
+/**
+ * @class RecognitionPool
+ * @brief Recognizes the license plates of encoded images on a fixed number of worker threads, for a server.
+ *
+ * Every worker owns a PlateRecognizer, whose buffers are reused from one image to the next, and the Tesseract pool is warmed up
+ * with one pair of engines per worker before the first request, so no request pays for the initialization of an engine.
+ * If the engines cannot be initialized, no worker is started and every image is rejected. The workers already share the cores,
+ * so the candidates of an image are evaluated on the thread of its worker only.
+ * The images waiting for a worker are kept in the bounded queue of a WorkerPool. When the queue is full, new images are rejected
+ * at once instead of being queued behind work that would outlast the patience of the client, so an overloaded server answers
+ * quickly and the client can retry later.
+ */
+class LICENSEPLATEDETECTION_API RecognitionPool
+{
+public:
+	/**
+	 * @brief Starts the workers of the pool.
+	 * @param[in] workers The number of worker threads, at least 1.
+	 * @param[in] capacity The number of images that can wait for a worker, at least 1.
+	 */
+	RecognitionPool(const int& workers, const int& capacity);
+
+	RecognitionPool(const RecognitionPool&) = delete;
+
+	RecognitionPool& operator=(const RecognitionPool&) = delete;
+
+public:
+	/**
+	 * @brief Checks whether the Tesseract engines of the workers were initialized.
+	 * @return Returns true if the workers were started, false if the traineddata could not be loaded, in which case every image is rejected.
+	 */
+	bool isLoaded() const;
+
+	/**
+	 * @brief Queues an encoded image for recognition.
+	 * @param[in] buffer The encoded image, moved into the queue.
+	 * @param[out] result The future recognition result, valid only if the image was queued. Its region is expressed in the coordinates
+	 *             of the encoded image and it holds no annotated image.
+	 * @return Returns true if the image was queued, false if the queue is full, the pool is stopping or its engines were not loaded.
+	 */
+	bool submit(std::vector<uchar> buffer, std::future<PlateResult>& result);
+
+	/**
+	 * @brief Returns the number of images waiting for a worker.
+	 * @return The number of queued images.
+	 */
+	size_t pending() const;
+
+	/**
+	 * @brief Returns the number of worker threads.
+	 * @return The number of workers.
+	 */
+	int getWorkers() const;
+
+	/**
+	 * @brief Returns the number of images that can wait for a worker.
+	 * @return The capacity of the queue.
+	 */
+	int getCapacity() const;
+
+	/**
+	 * @brief Returns how many images were accepted, rejected and recognized since the pool started, and how long they waited and were recognized.
+	 * @return The statistics of the pool.
+	 */
+	WorkerPoolStatistics getStatistics() const;
+
+private:
+	/**
+	 * @struct Job
+	 * @brief Holds a queued image and the promise of its result.
+	 */
+	struct Job
+	{
+		std::vector<uchar> buffer;
+		std::promise<PlateResult> result;
+	};
+
+	/**
+	 * @brief Builds the handler of a worker, which recognizes the queued images with a recognizer owned by the worker.
+	 * @return The handler of the worker.
+	 */
+	static WorkerPool<Job>::Handler makeHandler();
+
+private:
+	bool loaded;
+	WorkerPool<Job> pool;
+};
@@ -0,0 +1,116 @@
+#include "spatialprior.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialPrior::SpatialPrior(const SpatialPriorOptions& options) : options(options)
+{
+	this->options.grid = cv::Size(std::max(options.grid.width, 1), std::max(options.grid.height, 1));
+	heatmap = cv::Mat::zeros(this->options.grid, CV_32FC1);
+}
+
+bool SpatialPrior::hotspot(const cv::Size& region, cv::Rect& hotspot) const
+{
+	if (region.empty())
+		return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (detections < options.warmUpDetections)
+		return false;
+
+	double maxHeat;
+	cv::minMaxLoc(heatmap, nullptr, &maxHeat);
+	if (maxHeat <= 0)
+		return false;
+
+	cv::Mat hot = heatmap >= maxHeat * options.heatThreshold;
+	cv::Rect cells = cv::boundingRect(hot);
+
+	double cellWidth = static_cast<double>(region.width) / options.grid.width;
+	double cellHeight = static_cast<double>(region.height) / options.grid.height;
+
+	// The margin covers the plates that stop a little before or after the usual place, which fall in colder cells.
+	double marginX = cells.width * cellWidth * options.margin;
+	double marginY = cells.height * cellHeight * options.margin;
+
+	int left = static_cast<int>(std::floor(cells.x * cellWidth - marginX));
+	int top = static_cast<int>(std::floor(cells.y * cellHeight - marginY));
+	int right = static_cast<int>(std::ceil(cells.br().x * cellWidth + marginX));
+	int bottom = static_cast<int>(std::ceil(cells.br().y * cellHeight + marginY));
+
+	hotspot = cv::Rect(cv::Point(left, top), cv::Point(right, bottom)) & cv::Rect(cv::Point(0, 0), region);
+
+	return !hotspot.empty() && hotspot.area() <= region.area() * options.maxCoverage;
+}
+
+void SpatialPrior::update(const cv::Rect& roi, const cv::Size& region)
+{
+	if (region.empty() || roi.empty())
+		return;
+
+	int left = static_cast<int>(std::floor(static_cast<double>(roi.x) * options.grid.width / region.width));
+	int top = static_cast<int>(std::floor(static_cast<double>(roi.y) * options.grid.height / region.height));
+	int right = static_cast<int>(std::ceil(static_cast<double>(roi.br().x) * options.grid.width / region.width));
+	int bottom = static_cast<int>(std::ceil(static_cast<double>(roi.br().y) * options.grid.height / region.height));
+
+	cv::Rect cells = cv::Rect(cv::Point(left, top), cv::Point(right, bottom)) & cv::Rect(cv::Point(0, 0), options.grid);
+	if (cells.empty())
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	heatmap *= options.decay;
+
+	cv::Mat covered = heatmap(cells);
+	covered += 1;
+	detections++;
+}
+
+void SpatialPrior::record(const bool& tried, const bool& hit, const size_t& searchedPixels, const size_t& regionPixels)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	statistics.frames++;
+	if (tried && hit)
+		statistics.hits++;
+	else if (tried)
+		statistics.misses++;
+
+	statistics.searchedPixels += searchedPixels;
+	statistics.regionPixels += regionPixels;
+}
+
+SpatialPriorStatistics SpatialPrior::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	SpatialPriorStatistics result = statistics;
+
+	size_t tried = result.hits + result.misses;
+	if (tried)
+	{
+		result.hitRate = static_cast<double>(result.hits) / tried;
+		result.missRate = static_cast<double>(result.misses) / tried;
+	}
+
+	if (result.regionPixels > 0)
+		result.searchedFraction = result.searchedPixels / result.regionPixels;
+
+	return result;
+}
+
+cv::Mat SpatialPrior::getHeatmap() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return heatmap.clone();
+}
+
+void SpatialPrior::reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	heatmap.setTo(0);
+	detections = 0;
+	statistics = SpatialPriorStatistics();
+}
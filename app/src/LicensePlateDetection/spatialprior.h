@@ -0,0 +1,120 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+/**
+ * @struct SpatialPriorOptions
+ * @brief Holds the parameters of the heatmap of a camera.
+ */
+struct SpatialPriorOptions
+{
+	cv::Size grid = cv::Size(32, 16);
+	float decay = 0.95f;
+	int warmUpDetections = 5;
+	float heatThreshold = 0.2f;
+	float margin = 0.5f;
+	float maxCoverage = 0.5f;
+};
+
+/**
+ * @struct SpatialPriorStatistics
+ * @brief Counts how the hotspot of a camera served its frames, and how many pixels were searched instead of the whole region.
+ */
+struct SpatialPriorStatistics
+{
+	size_t frames = 0;
+	size_t hits = 0;
+	size_t misses = 0;
+	double hitRate = 0;
+	double missRate = 0;
+	double searchedPixels = 0;
+	double regionPixels = 0;
+	double searchedFraction = 0;
+};
+
+/**
+ * @class SpatialPrior
+ * @brief Learns where the plates appear in the frames of a fixed camera, so that only that part of the frame is searched.
+ *
+ * The search region of the frame is divided into a coarse grid, and every accepted plate adds heat to the cells it covers
+ * while the older heat decays, so the heatmap follows a camera that is moved. Once enough plates were accepted, the hotspot
+ * is the bounding box of the cells with a fraction of the maximum heat, padded by a margin relative to its size. The plate
+ * is searched in the hotspot first, at full quality, and in the whole region only if no plate is read there. The heatmap is
+ * normalized to the region, so it does not depend on the resolution of the frames. A prior belongs to one camera
+ * and may be shared by the threads that process its frames.
+ */
+class LICENSEPLATEDETECTION_API SpatialPrior
+{
+public:
+	explicit SpatialPrior(const SpatialPriorOptions& options = SpatialPriorOptions());
+
+	SpatialPrior(const SpatialPrior&) = delete;
+
+	SpatialPrior& operator=(const SpatialPrior&) = delete;
+
+public:
+	/**
+	 * @brief Returns the part of the search region where the plates of the camera are expected.
+	 * @param[in] region The size of the search region.
+	 * @param[out] hotspot The hotspot, in the coordinates of the region.
+	 * @return Returns false while too few plates were accepted or if the plates are spread over too much of the region, true otherwise.
+	 */
+	bool hotspot(const cv::Size& region, cv::Rect& hotspot) const;
+
+	/**
+	 * @brief Adds an accepted plate to the heatmap.
+	 * @param[in] roi The region of the plate, in the coordinates of the search region.
+	 * @param[in] region The size of the search region.
+	 * @return void
+	 */
+	void update(const cv::Rect& roi, const cv::Size& region);
+
+	/**
+	 * @brief Counts a searched frame.
+	 * @param[in] tried True if the hotspot was searched first, false otherwise.
+	 * @param[in] hit True if the plate was read in the hotspot, false otherwise.
+	 * @param[in] searchedPixels The number of pixels searched, in the hotspot and in the region together.
+	 * @param[in] regionPixels The number of pixels of the search region.
+	 * @return void
+	 */
+	void record(const bool& tried, const bool& hit, const size_t& searchedPixels, const size_t& regionPixels);
+
+	/**
+	 * @brief Returns how the hotspot served the frames since the prior was created or reset.
+	 * @details The hit and miss rates are fractions of the frames in which the hotspot was searched.
+	 * @return The statistics of the prior.
+	 */
+	SpatialPriorStatistics getStatistics() const;
+
+	/**
+	 * @brief Returns a copy of the heatmap, for display.
+	 * @return The heatmap, a CV_32FC1 image of the size of the grid.
+	 */
+	cv::Mat getHeatmap() const;
+
+	/**
+	 * @brief Forgets the accepted plates and the statistics, for instance after the camera was moved.
+	 * @return void
+	 */
+	void reset();
+
+private:
+	SpatialPriorOptions options;
+	mutable std::mutex mutex;
+	cv::Mat heatmap;
+	int detections = 0;
+	SpatialPriorStatistics statistics;
+};
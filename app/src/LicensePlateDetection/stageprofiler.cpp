@@ -0,0 +1,173 @@
+#include "stageprofiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+StageProfiler& StageProfiler::getInstance()
+{
+	static StageProfiler instance;
+	return instance;
+}
+
+std::string StageProfiler::stageName(const PipelineStage& stage)
+{
+	switch (stage)
+	{
+	case PipelineStage::Decoding:
+		return "decoding";
+	case PipelineStage::Preprocessing:
+		return "preprocessing";
+	case PipelineStage::ConnectedComponents:
+		return "connectedComponents";
+	case PipelineStage::CandidateScoring:
+		return "candidateScoring";
+	case PipelineStage::ColourConversion:
+		return "colourConversion";
+	case PipelineStage::EdgeDetection:
+		return "edgeDetection";
+	case PipelineStage::RoiContour:
+		return "roiContour";
+	case PipelineStage::CornersCoordinates:
+		return "cornersCoordinates";
+	case PipelineStage::GeometricalTransformation:
+		return "geometricalTransformation";
+	case PipelineStage::Denoise:
+		return "denoise";
+	case PipelineStage::Segmentation:
+		return "segmentation";
+	case PipelineStage::ReadText:
+		return "readText";
+	case PipelineStage::Annotation:
+		return "annotation";
+	case PipelineStage::Total:
+		return "total";
+	default:
+		return "unknown";
+	}
+}
+
+void StageProfiler::setEnabled(const bool& enabled)
+{
+	this->enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool StageProfiler::isEnabled() const
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void StageProfiler::record(const PipelineStage& stage, const std::chrono::nanoseconds& latency, const bool& rejected)
+{
+	if (stage >= PipelineStage::Count)
+		return;
+
+	StageRecord& record = records[static_cast<size_t>(stage)];
+
+	// The number of executions also gives the slot of the sample, so concurrent stages never write to the same one.
+	uint64_t index = record.reached.fetch_add(1, std::memory_order_relaxed);
+	record.samples[index % windowSize].store(latency.count(), std::memory_order_relaxed);
+
+	if (rejected)
+		record.rejected.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<StageStatistics> StageProfiler::statistics() const
+{
+	std::vector<StageStatistics> result;
+	result.reserve(records.size());
+
+	std::vector<int64_t> window;
+	window.reserve(windowSize);
+
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		const StageRecord& record = records[i];
+
+		StageStatistics stageStatistics;
+		stageStatistics.stage = stageName(static_cast<PipelineStage>(i));
+		stageStatistics.reached = record.reached.load(std::memory_order_relaxed);
+		stageStatistics.rejected = record.rejected.load(std::memory_order_relaxed);
+		stageStatistics.samples = static_cast<size_t>(std::min<uint64_t>(stageStatistics.reached, windowSize));
+
+		window.clear();
+		for (size_t j = 0; j < stageStatistics.samples; j++)
+			window.push_back(record.samples[j].load(std::memory_order_relaxed));
+		std::sort(window.begin(), window.end());
+
+		auto percentile = [&window](const double& p)
+			{
+				if (window.empty())
+					return 0.0;
+
+				size_t rank = static_cast<size_t>(std::ceil(p * window.size()));
+				return window[std::max<size_t>(rank, 1) - 1] / 1e6;
+			};
+
+		stageStatistics.p50 = percentile(0.50);
+		stageStatistics.p95 = percentile(0.95);
+		stageStatistics.p99 = percentile(0.99);
+
+		result.push_back(stageStatistics);
+	}
+
+	return result;
+}
+
+std::string StageProfiler::toJson() const
+{
+	std::ostringstream json;
+	json << std::fixed << std::setprecision(3);
+
+	json << "{\"stages\":[";
+
+	std::vector<StageStatistics> stages = statistics();
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		if (i)
+			json << ",";
+
+		json << "{\"stage\":\"" << stages[i].stage << "\""
+			<< ",\"reached\":" << stages[i].reached
+			<< ",\"rejected\":" << stages[i].rejected
+			<< ",\"samples\":" << stages[i].samples
+			<< ",\"p50\":" << stages[i].p50
+			<< ",\"p95\":" << stages[i].p95
+			<< ",\"p99\":" << stages[i].p99 << "}";
+	}
+
+	json << "]}";
+
+	return json.str();
+}
+
+void StageProfiler::reset()
+{
+	for (StageRecord& record : records)
+	{
+		record.reached.store(0, std::memory_order_relaxed);
+		record.rejected.store(0, std::memory_order_relaxed);
+
+		for (auto& sample : record.samples)
+			sample.store(0, std::memory_order_relaxed);
+	}
+}
+
+ScopedStageTimer::ScopedStageTimer(const PipelineStage& stage) : stage(stage), active(StageProfiler::getInstance().isEnabled())
+{
+	if (active)
+		start = std::chrono::steady_clock::now();
+}
+
+ScopedStageTimer::~ScopedStageTimer()
+{
+	if (active)
+		StageProfiler::getInstance().record(stage, std::chrono::steady_clock::now() - start, rejected);
+}
+
+bool ScopedStageTimer::reject()
+{
+	rejected = true;
+	return false;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @enum PipelineStage
+ * @brief The timed stages of the license plate recognition pipeline.
+ *
+ * The first stages run once per frame, the ones from ColourConversion to ReadText once per plate candidate,
+ * in this order. Decoding is only timed for the frames recognized from their encoded bytes, and is not part of Total,
+ * which covers the whole recognition of a decoded frame.
+ */
+enum class PipelineStage
+{
+	Decoding,
+	Preprocessing,
+	ConnectedComponents,
+	CandidateScoring,
+	ColourConversion,
+	EdgeDetection,
+	RoiContour,
+	CornersCoordinates,
+	GeometricalTransformation,
+	Denoise,
+	Segmentation,
+	ReadText,
+	Annotation,
+	Total,
+	Count
+};
+
+/**
+ * @struct StageStatistics
+ * @brief Holds the counters and the latency percentiles of a pipeline stage.
+ */
+struct StageStatistics
+{
+	std::string stage;
+	uint64_t reached = 0;
+	uint64_t rejected = 0;
+	size_t samples = 0;
+	double p50 = 0;
+	double p95 = 0;
+	double p99 = 0;
+};
+
+/**
+ * @class StageProfiler
+ * @brief Collects the latency of each stage of the license plate recognition pipeline.
+ *
+ * Every stage keeps how many times it was reached, how many times it rejected the candidate
+ * and its latency over a rolling window of the most recent executions. Recording is lock-free,
+ * so the stages of candidates evaluated concurrently do not wait for each other, and it can be
+ * disabled at runtime, in which case the timers do not even read the clock.
+ * The statistics can be queried as percentiles or exported as JSON.
+ */
+class LICENSEPLATEDETECTION_API StageProfiler
+{
+public:
+	static constexpr size_t windowSize = 1024;
+
+private:
+	StageProfiler() = default;
+
+	StageProfiler(const StageProfiler&) = delete;
+
+	StageProfiler& operator=(const StageProfiler&) = delete;
+
+public:
+	/**
+	 * @brief Returns the singleton instance of the StageProfiler class.
+	 * @return A reference to the singleton instance of the StageProfiler class.
+	 */
+	static StageProfiler& getInstance();
+
+	/**
+	 * @brief Returns the name of a pipeline stage, as used in the JSON export.
+	 * @param[in] stage The pipeline stage.
+	 * @return The name of the stage.
+	 */
+	static std::string stageName(const PipelineStage& stage);
+
+	/**
+	 * @brief Enables or disables the recording of the stages.
+	 * @param[in] enabled True to record the stages, false to ignore them.
+	 * @return void
+	 */
+	void setEnabled(const bool& enabled);
+
+	/**
+	 * @brief Checks whether the stages are recorded.
+	 * @return Returns true if the stages are recorded, false otherwise.
+	 */
+	bool isEnabled() const;
+
+	/**
+	 * @brief Records an execution of a pipeline stage.
+	 * @details The latency replaces the oldest sample of the stage once its window is full.
+	 * @param[in] stage The executed stage.
+	 * @param[in] latency The duration of the execution.
+	 * @param[in] rejected True if the stage rejected the candidate.
+	 * @return void
+	 */
+	void record(const PipelineStage& stage, const std::chrono::nanoseconds& latency, const bool& rejected);
+
+	/**
+	 * @brief Computes the statistics of every pipeline stage.
+	 * @details The percentiles are computed with the nearest-rank method over the current window and are expressed in milliseconds.
+	 *          A stage that was never reached has no samples and all its percentiles are 0.
+	 * @return The statistics of the stages, in the order of the PipelineStage enumeration.
+	 */
+	std::vector<StageStatistics> statistics() const;
+
+	/**
+	 * @brief Exports the statistics of every pipeline stage as JSON.
+	 * @details The result is an object with a "stages" array, each element holding the name of the stage,
+	 *          its counters and its p50, p95 and p99 latencies in milliseconds.
+	 * @return The JSON document.
+	 */
+	std::string toJson() const;
+
+	/**
+	 * @brief Clears the counters and the samples of every stage.
+	 * @details It is meant to be called while no frame is being recognized.
+	 * @return void
+	 */
+	void reset();
+
+private:
+	/**
+	 * @struct StageRecord
+	 * @brief Holds the counters and the rolling window of samples of a pipeline stage.
+	 */
+	struct StageRecord
+	{
+		std::atomic<uint64_t> reached{ 0 };
+		std::atomic<uint64_t> rejected{ 0 };
+		std::array<std::atomic<int64_t>, windowSize> samples{};
+	};
+
+	std::atomic<bool> enabled{ true };
+	std::array<StageRecord, static_cast<size_t>(PipelineStage::Count)> records;
+};
+
+/**
+ * @class ScopedStageTimer
+ * @brief Times a pipeline stage from its construction to its destruction.
+ *
+ * The execution is recorded by the StageProfiler when the timer goes out of scope, including when the stage
+ * returns early. A stage that rejects the candidate marks it through reject() before returning.
+ */
+class LICENSEPLATEDETECTION_API ScopedStageTimer
+{
+public:
+	explicit ScopedStageTimer(const PipelineStage& stage);
+
+	~ScopedStageTimer();
+
+	ScopedStageTimer(const ScopedStageTimer&) = delete;
+
+	ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+public:
+	/**
+	 * @brief Marks the timed stage as having rejected the candidate.
+	 * @return Always false, so that a stage can reject and return in the same statement.
+	 */
+	bool reject();
+
+private:
+	PipelineStage stage;
+	bool active;
+	bool rejected = false;
+	std::chrono::steady_clock::time_point start;
+};
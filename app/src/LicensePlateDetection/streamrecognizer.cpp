@@ -0,0 +1,301 @@
+#include "streamrecognizer.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <map>
+
+StreamRecognizer::StreamRecognizer(const StreamOptions& options) : options(options)
+{
+	this->options.idleFrames = std::max(this->options.idleFrames, 1);
+	this->options.ocrFrames = std::max(this->options.ocrFrames, 1);
+	this->options.repeatFrames = std::max(this->options.repeatFrames, 0);
+
+	recognizer.setProfile(this->options.profile);
+	recognizer.setCalibration(this->options.calibration);
+}
+
+bool StreamRecognizer::open(const std::string& source)
+{
+	statistics = StreamStatistics();
+	previousSmall.release();
+	shots.clear();
+	tracking = false;
+	missedFrames = 0;
+	lastPlate.clear();
+	lastPlateFrame = 0;
+
+	if (!source.empty() && std::all_of(source.begin(), source.end(), ::isdigit))
+		capture.open(std::stoi(source));
+	else
+		capture.open(source);
+
+	return capture.isOpened();
+}
+
+bool StreamRecognizer::read(PlateResult& result, const std::function<bool()>& isCancelled)
+{
+	while (capture.isOpened())
+	{
+		if (isCancelled && isCancelled())
+			return false;
+
+		if (!capture.read(captured))
+			break;
+
+		if (process(captured, result))
+			return true;
+	}
+
+	return flush(result);
+}
+
+bool StreamRecognizer::process(const cv::Mat& frame, PlateResult& result)
+{
+	if (frame.empty() || (frame.type() != CV_8UC3 && frame.type() != CV_8UC4))
+		return false;
+
+	statistics.frames++;
+
+	bool motion = hasMotion(frame);
+	if (!motion && shots.empty())
+	{
+		statistics.idleFrames++;
+		return false;
+	}
+
+	bool found = false;
+	if (motion)
+	{
+		if (!recognizer.prepare(frame))
+			return false;
+
+		cv::cvtColor(recognizer.cropped, gray, cv::COLOR_BGR2GRAY);
+
+		found = tracking && track(plateRoi);
+		if (found)
+			statistics.trackedFrames++;
+		else
+		{
+			found = detect(plateRoi);
+			if (found)
+				statistics.detections++;
+		}
+
+		tracking = found;
+		if (found)
+		{
+			gray(plateRoi).copyTo(plateTemplate);
+			keepShot(frame, plateRoi, sharpness(plateTemplate));
+		}
+	}
+	else
+		statistics.idleFrames++;
+
+	if (found)
+	{
+		missedFrames = 0;
+		return false;
+	}
+
+	// The pass ends once the plate has been lost, or has stood still, for a number of frames.
+	if (++missedFrames < options.idleFrames)
+		return false;
+
+	return endPass(result);
+}
+
+bool StreamRecognizer::flush(PlateResult& result)
+{
+	return endPass(result);
+}
+
+const StreamStatistics& StreamRecognizer::getStatistics() const
+{
+	return statistics;
+}
+
+bool StreamRecognizer::hasMotion(const cv::Mat& frame)
+{
+	const int width = 160;
+
+	double scale = std::min(1.0, static_cast<double>(width) / frame.cols);
+	cv::resize(frame, resized, cv::Size(), scale, scale, cv::INTER_AREA);
+	cv::cvtColor(resized, small, frame.type() == CV_8UC4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+
+	bool motion = true;
+	if (previousSmall.size() == small.size())
+	{
+		cv::absdiff(small, previousSmall, difference);
+		cv::threshold(difference, difference, 25, 255, cv::THRESH_BINARY);
+		motion = cv::countNonZero(difference) >= options.motionThreshold * difference.total();
+	}
+
+	cv::swap(small, previousSmall);
+
+	return motion;
+}
+
+bool StreamRecognizer::detect(cv::Rect& roi)
+{
+	static const std::function<bool()> notCancelled = []()
+		{
+			return false;
+		};
+
+	recognizer.proposeCandidates();
+
+	for (int i = 0; i < recognizer.candidateCount; i++)
+		if (PlateRecognizer::rectifyCandidate(recognizer.candidates[i], recognizer.cropped, recognizer.gauss, notCancelled, recognizer.profile))
+		{
+			roi = recognizer.candidates[i].roi;
+			return true;
+		}
+
+	return false;
+}
+
+bool StreamRecognizer::track(cv::Rect& roi)
+{
+	if (plateTemplate.empty())
+		return false;
+
+	// The plate moves little between two frames, so it is only searched around its last position.
+	cv::Rect window(roi.x - roi.width / 2, roi.y - roi.height, roi.width * 2, roi.height * 3);
+	window &= cv::Rect(0, 0, gray.cols, gray.rows);
+
+	if (window.width < plateTemplate.cols || window.height < plateTemplate.rows)
+		return false;
+
+	cv::matchTemplate(gray(window), plateTemplate, matches, cv::TM_CCOEFF_NORMED);
+
+	double maxValue;
+	cv::Point maxLocation;
+	cv::minMaxLoc(matches, nullptr, &maxValue, nullptr, &maxLocation);
+
+	if (maxValue < options.trackingThreshold)
+		return false;
+
+	roi = cv::Rect(window.tl() + maxLocation, plateTemplate.size());
+	return true;
+}
+
+double StreamRecognizer::sharpness(const cv::Mat& src)
+{
+	cv::Laplacian(src, laplacian, CV_32F);
+
+	cv::Scalar mean, deviation;
+	cv::meanStdDev(laplacian, mean, deviation);
+
+	return deviation[0] * deviation[0];
+}
+
+void StreamRecognizer::keepShot(const cv::Mat& frame, const cv::Rect& roi, const double& sharpness)
+{
+	if (shots.size() < static_cast<size_t>(options.ocrFrames))
+	{
+		shots.push_back(Shot{ sharpness, frame.clone(), roi });
+		return;
+	}
+
+	auto blurriest = std::min_element(shots.begin(), shots.end(), [](const Shot& a, const Shot& b)
+		{
+			return a.sharpness < b.sharpness;
+		});
+
+	if (sharpness <= blurriest->sharpness)
+		return;
+
+	blurriest->sharpness = sharpness;
+	frame.copyTo(blurriest->frame);
+	blurriest->roi = roi;
+}
+
+bool StreamRecognizer::endPass(PlateResult& result)
+{
+	static const std::function<bool()> notCancelled = []()
+		{
+			return false;
+		};
+
+	tracking = false;
+	missedFrames = 0;
+
+	if (shots.empty())
+		return false;
+
+	statistics.passes++;
+
+	// The sharpest frame is read last, so that it is the one annotated.
+	std::sort(shots.begin(), shots.end(), [](const Shot& a, const Shot& b)
+		{
+			return a.sharpness < b.sharpness;
+		});
+
+	// The votes of each word, as the sum of their confidences and their number.
+	std::array<std::map<std::string, std::pair<float, int>>, 3> votes;
+
+	for (Shot& shot : shots)
+	{
+		if (!recognizer.prepare(shot.frame))
+			continue;
+
+		if (recognizer.candidates.empty())
+			recognizer.candidates.emplace_back();
+
+		recognizer.candidates[0].roi = shot.roi;
+		recognizer.candidateCount = 1;
+		statistics.ocrFrames++;
+
+		if (!PlateRecognizer::rectifyCandidate(recognizer.candidates[0], recognizer.cropped, recognizer.gauss, notCancelled, recognizer.profile))
+			continue;
+
+		std::array<std::string, 3> texts;
+		std::array<float, 3> confidences;
+		if (!PlateRecognizer::readCandidateWords(recognizer.candidates[0], texts, confidences))
+			continue;
+
+		for (int i = 0; i < texts.size(); i++)
+			if (!texts[i].empty())
+			{
+				votes[i][texts[i]].first += confidences[i];
+				votes[i][texts[i]].second++;
+			}
+	}
+
+	shots.clear();
+
+	std::string plate;
+	float confidence = 0;
+
+	for (const auto& wordVotes : votes)
+	{
+		if (wordVotes.empty() || !recognizer.candidateCount)
+			return false;
+
+		auto best = std::max_element(wordVotes.begin(), wordVotes.end(), [](const auto& a, const auto& b)
+			{
+				return a.second.first < b.second.first;
+			});
+
+		plate += best->first;
+		confidence += best->second.first / best->second.second * best->first.size();
+	}
+
+	confidence /= plate.size();
+
+	if (plate == lastPlate && statistics.frames - lastPlateFrame <= static_cast<size_t>(options.repeatFrames))
+	{
+		lastPlateFrame = statistics.frames;
+		return false;
+	}
+
+	lastPlate = plate;
+	lastPlateFrame = statistics.frames;
+
+	recognizer.candidates[0].plate = plate;
+	recognizer.candidates[0].confidence = confidence;
+	result = recognizer.annotate(0);
+
+	return true;
+}
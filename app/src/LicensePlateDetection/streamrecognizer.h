@@ -0,0 +1,184 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include "platerecognizer.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @struct StreamOptions
+ * @brief Holds the thresholds of the stream recognition and the threshold profile of its camera.
+ * @details A plate read again within repeatFrames frames of its last pass is not reported twice. The calibration profile
+ *          of the camera, if any, must outlive the recognizer.
+ */
+struct StreamOptions
+{
+	double motionThreshold = 0.005;
+	int idleFrames = 10;
+	int ocrFrames = 3;
+	int repeatFrames = 300;
+	double trackingThreshold = 0.6;
+	ThresholdProfile profile = ThresholdProfile::Default;
+	const CameraCalibration* calibration = nullptr;
+};
+
+/**
+ * @struct StreamStatistics
+ * @brief Counts how the frames of a stream were handled.
+ */
+struct StreamStatistics
+{
+	size_t frames = 0;
+	size_t idleFrames = 0;
+	size_t detections = 0;
+	size_t trackedFrames = 0;
+	size_t ocrFrames = 0;
+	size_t passes = 0;
+};
+
+/**
+ * @class StreamRecognizer
+ * @brief Recognizes the license plates of the vehicles passing in front of a camera or in a video file.
+ *
+ * Running the whole pipeline on every frame of a gate camera is wasteful, since most frames are idle and a passing plate
+ * stays in view for many frames. The recognizer compares each frame with the previous one at a low resolution and skips
+ * the frames without motion. The plate is searched among all the candidates only until it is found; it is then tracked
+ * from frame to frame by template matching around its last position. The sharpest frames of the pass are kept and,
+ * once the plate has left or stood still for a while, only they are read, word by word. Every word is voted separately,
+ * weighted by its confidence, so a character misread in one frame is outvoted by the other frames.
+ */
+class LICENSEPLATEDETECTION_API StreamRecognizer
+{
+public:
+	explicit StreamRecognizer(const StreamOptions& options = StreamOptions());
+
+	StreamRecognizer(const StreamRecognizer&) = delete;
+
+	StreamRecognizer& operator=(const StreamRecognizer&) = delete;
+
+public:
+	/**
+	 * @brief Opens a video source and resets the state of the recognizer.
+	 * @param[in] source The path of a video file, or the index of a capture device, such as "0".
+	 * @return Returns true if the source was opened, false otherwise.
+	 */
+	bool open(const std::string& source);
+
+	/**
+	 * @brief Reads frames from the opened source until the next pass of a plate is recognized.
+	 * @details The pass in progress when the source ends is recognized as well. The cancellation predicate is checked before
+	 *          every frame, so that a capture device, which never ends, can be stopped from another thread.
+	 * @param[out] result The recognition result of the pass.
+	 * @param[in] isCancelled A predicate that returns true when the reading must stop, or an empty function.
+	 * @return Returns true if a plate was recognized, false once the source has ended or the reading was cancelled.
+	 */
+	bool read(PlateResult& result, const std::function<bool()>& isCancelled = nullptr);
+
+	/**
+	 * @brief Processes a single frame, for sources not read through a cv::VideoCapture.
+	 * @param[in] frame The frame, in BGR or BGRA format.
+	 * @param[out] result The recognition result, set when a pass ends with this frame.
+	 * @return Returns true if a pass ended and its plate was recognized, false otherwise.
+	 */
+	bool process(const cv::Mat& frame, PlateResult& result);
+
+	/**
+	 * @brief Ends the pass in progress, if any, and recognizes its plate.
+	 * @param[out] result The recognition result of the pass.
+	 * @return Returns true if a plate was recognized, false otherwise.
+	 */
+	bool flush(PlateResult& result);
+
+	/**
+	 * @brief Returns how the frames processed since the source was opened were handled.
+	 * @return The statistics of the stream.
+	 */
+	const StreamStatistics& getStatistics() const;
+
+private:
+	/**
+	 * @struct Shot
+	 * @brief Holds one of the sharpest frames of a pass and the region of the plate in it.
+	 */
+	struct Shot
+	{
+		double sharpness = 0;
+		cv::Mat frame;
+		cv::Rect roi;
+	};
+
+	/**
+	 * @brief Checks whether a frame differs from the previous one.
+	 * @details Both frames are compared in grayscale at a low resolution. The first frame is always considered moving.
+	 * @param[in] frame The frame.
+	 * @return Returns true if the fraction of changed pixels reaches the motion threshold, false otherwise.
+	 */
+	bool hasMotion(const cv::Mat& frame);
+
+	/**
+	 * @brief Searches the plate among all the candidates of the prepared frame, without reading it.
+	 * @details The first candidate, in the order of their rank, that can be straightened and separated into words is the plate.
+	 * @param[out] roi The region of the plate.
+	 * @return Returns true if a plate was found, false otherwise.
+	 */
+	bool detect(cv::Rect& roi);
+
+	/**
+	 * @brief Finds the tracked plate around its last position in the prepared frame.
+	 * @param[in,out] roi The last region of the plate, updated to its new region.
+	 * @return Returns true if the plate was found, false if the tracking was lost.
+	 */
+	bool track(cv::Rect& roi);
+
+	/**
+	 * @brief Measures the sharpness of an image as the variance of its Laplacian.
+	 * @param[in] src The grayscale image.
+	 * @return The sharpness of the image.
+	 */
+	double sharpness(const cv::Mat& src);
+
+	/**
+	 * @brief Keeps a frame of the pass if it is among the sharpest ones.
+	 * @param[in] frame The frame.
+	 * @param[in] roi The region of the plate in the frame.
+	 * @param[in] sharpness The sharpness of the plate.
+	 * @return void
+	 */
+	void keepShot(const cv::Mat& frame, const cv::Rect& roi, const double& sharpness);
+
+	/**
+	 * @brief Ends the pass in progress and votes its plate over its sharpest frames.
+	 * @details A pass that reads the same plate as the previous one within the repeat window, such as a vehicle that stood still
+	 *          in front of the camera and then left, is not reported again and extends the window. The same vehicle passing again
+	 *          later is reported.
+	 * @param[out] result The recognition result of the pass, annotated on its sharpest frame.
+	 * @return Returns true if every word of the plate received a vote, false otherwise.
+	 */
+	bool endPass(PlateResult& result);
+
+private:
+	StreamOptions options;
+	StreamStatistics statistics;
+	cv::VideoCapture capture;
+	PlateRecognizer recognizer;
+	cv::Mat captured, resized, small, previousSmall, difference, gray, laplacian, plateTemplate, matches;
+	std::vector<Shot> shots;
+	cv::Rect plateRoi;
+	bool tracking = false;
+	int missedFrames = 0;
+	std::string lastPlate;
+	size_t lastPlateFrame = 0;
+};
@@ -0,0 +1,108 @@
+#include "tesseractpool.h"
+
+TesseractPool::TesseractPool()
+{
+	warmUp(1);
+}
+
+TesseractPool::~TesseractPool()
+{
+	clear();
+}
+
+TesseractPool& TesseractPool::getInstance()
+{
+	static TesseractPool instance;
+	return instance;
+}
+
+std::unique_ptr<tesseract::TessBaseAPI> TesseractPool::createEngine(const bool& charType)
+{
+	auto tess = std::make_unique<tesseract::TessBaseAPI>();
+
+	if (tess->Init(NULL, "DIN1451Mittelschrift", tesseract::OEM_LSTM_ONLY))
+		return nullptr;
+
+	tess->SetVariable("load_bigram_dawg", "false");
+	tess->SetVariable("load_freq_dawg", "false");
+	tess->SetVariable("load_number_dawg", "false");
+	tess->SetVariable("load_punc_dawg", "false");
+	tess->SetVariable("load_system_dawg", "false");
+	tess->SetVariable("load_unambig_dawg", "false");
+	tess->SetVariable("load_word_dawg", "false");
+
+	if (charType)
+		tess->SetVariable("tessedit_char_whitelist", "0123456789");
+	else
+		tess->SetVariable("tessedit_char_whitelist", "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+
+	return tess;
+}
+
+bool TesseractPool::warmUp(const int& size)
+{
+	for (int charType = 0; charType < 2; charType++)
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (engines[charType].size() >= size)
+					break;
+			}
+
+			std::unique_ptr<tesseract::TessBaseAPI> tess = createEngine(charType);
+			if (!tess)
+				return false;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			engines[charType].push_back(std::move(tess));
+		}
+
+	return true;
+}
+
+std::shared_ptr<tesseract::TessBaseAPI> TesseractPool::acquire(const bool& charType)
+{
+	std::unique_ptr<tesseract::TessBaseAPI> tess;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!engines[charType].empty())
+		{
+			tess = std::move(engines[charType].back());
+			engines[charType].pop_back();
+		}
+	}
+
+	if (!tess)
+		tess = createEngine(charType);
+
+	if (!tess)
+		return nullptr;
+
+	return std::shared_ptr<tesseract::TessBaseAPI>(tess.release(), [this, charType](tesseract::TessBaseAPI* tess)
+		{
+			release(tess, charType);
+		});
+}
+
+void TesseractPool::release(tesseract::TessBaseAPI* tess, const bool& charType)
+{
+	tess->Clear();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	engines[charType].emplace_back(tess);
+}
+
+void TesseractPool::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& pool : engines)
+	{
+		for (auto& tess : pool)
+			tess->End();
+
+		pool.clear();
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef LICENSEPLATEDETECTION_EXPORTS
+#define LICENSEPLATEDETECTION_API __declspec(dllexport)
+#else
+#define LICENSEPLATEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define LICENSEPLATEDETECTION_API __attribute__((visibility("default")))
+#else
+#define LICENSEPLATEDETECTION_API
+#endif
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <tesseract/baseapi.h>
+
+/**
+ * @class TesseractPool
+ * @brief Keeps a pool of initialized Tesseract OCR engines for letters and digits.
+ *
+ * Loading the "DIN1451Mittelschrift" traineddata is far more expensive than recognizing a character,
+ * so the engines are created once, configured with the letter or digit whitelist and then reused.
+ * An engine is borrowed through acquire() and returned to the pool automatically when the returned
+ * pointer is released. The pool is thread-safe and only grows when more engines are used concurrently
+ * than the number of idle engines available.
+ */
+class LICENSEPLATEDETECTION_API TesseractPool
+{
+private:
+	TesseractPool();
+
+	~TesseractPool();
+
+	TesseractPool(const TesseractPool&) = delete;
+
+	TesseractPool& operator=(const TesseractPool&) = delete;
+
+public:
+	/**
+	 * @brief Returns the singleton instance of the TesseractPool class.
+	 * @details The instance is created on the first call, which also initializes one engine for each whitelist.
+	 * @return A reference to the singleton instance of the TesseractPool class.
+	 */
+	static TesseractPool& getInstance();
+
+	/**
+	 * @brief Makes sure the pool holds a minimum number of idle engines for each whitelist.
+	 * @details This function initializes new engines until both the letter and the digit pools contain at least
+	 *          the requested number of idle engines. It is meant to be called at startup, so that the traineddata
+	 *          is never loaded while a plate is being recognized.
+	 * @param[in] size The minimum number of idle engines for each whitelist.
+	 * @return Returns true if the pools hold the requested engines, false if an engine could not be initialized,
+	 *         for instance because the traineddata was not found.
+	 */
+	bool warmUp(const int& size);
+
+	/**
+	 * @brief Borrows an initialized engine from the pool.
+	 * @details This function returns an idle engine configured for the requested character type.
+	 *          If no idle engine is available, a new one is initialized and will be kept in the pool after use.
+	 *          The engine is returned to the pool when the last copy of the returned pointer is destroyed.
+	 * @param[in] charType The type of characters to recognize (true for digits, false for letters).
+	 * @return A shared pointer to the borrowed engine.
+	 */
+	std::shared_ptr<tesseract::TessBaseAPI> acquire(const bool& charType);
+
+	/**
+	 * @brief Releases all the idle engines.
+	 * @details Borrowed engines are not affected and are still returned to the pool when released.
+	 * @return void
+	 */
+	void clear();
+
+private:
+	/**
+	 * @brief Initializes a new engine for the requested character type.
+	 * @details This function loads the "DIN1451Mittelschrift" traineddata with the LSTM engine,
+	 *          disables the dictionaries and sets the letter or digit whitelist.
+	 * @param[in] charType The type of characters to recognize (true for digits, false for letters).
+	 * @return A pointer to the initialized engine, or nullptr if the initialization failed.
+	 */
+	static std::unique_ptr<tesseract::TessBaseAPI> createEngine(const bool& charType);
+
+	/**
+	 * @brief Returns a borrowed engine to the pool.
+	 * @param[in] tess The engine to return.
+	 * @param[in] charType The type of characters the engine was configured for.
+	 * @return void
+	 */
+	void release(tesseract::TessBaseAPI* tess, const bool& charType);
+
+private:
+	std::mutex mutex;
+	std::array<std::vector<std::unique_ptr<tesseract::TessBaseAPI>>, 2> engines;
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "licenseplatedetection.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct WorkerPoolStatistics
+ * @brief Counts the jobs handled by a worker pool and the time they spent waiting for a worker and being processed, in milliseconds.
+ */
+struct WorkerPoolStatistics
+{
+	size_t accepted = 0;
+	size_t rejected = 0;
+	size_t completed = 0;
+	double totalWaitTime = 0;
+	double maxWaitTime = 0;
+	double totalProcessTime = 0;
+	double maxProcessTime = 0;
+};
+
+/**
+ * @class WorkerPool
+ * @brief Processes jobs on a fixed number of worker threads, fed by a bounded queue.
+ *
+ * Every worker builds its own handler when it starts, so the state a handler reuses from one job to the next, such as a PlateRecognizer,
+ * is owned by a single thread. A job is either submitted without waiting, and rejected at once when the queue is full, which lets a server
+ * answer quickly instead of queuing work behind requests that would outlast the patience of their clients, or submitted with a wait
+ * for a free place, which lets the stages of a pipeline slow each other down. The workers already share the cores, so every worker
+ * runs with a thread budget of 1.
+ * @tparam Job The type of the queued jobs, which only has to be movable.
+ */
+template <typename Job>
+class WorkerPool
+{
+public:
+	/**
+	 * @brief The function that processes a job, given the time the job waited for a worker, in milliseconds.
+	 */
+	using Handler = std::function<void(Job&, const double&)>;
+
+	/**
+	 * @brief Starts the workers of the pool.
+	 * @param[in] workers The number of worker threads. With 0, no worker is started and every job is rejected.
+	 * @param[in] capacity The number of jobs that can wait for a worker, at least 1.
+	 * @param[in] makeHandler The function called once by every worker, on its own thread, to build the handler of its jobs.
+	 */
+	WorkerPool(const int& workers, const int& capacity, const std::function<Handler()>& makeHandler) : capacity(std::max(capacity, 1))
+	{
+		int count = std::max(workers, 0);
+
+		threads.reserve(count);
+		for (int i = 0; i < count; i++)
+			threads.emplace_back([this, makeHandler]()
+				{
+					setThreadBudget(1);
+					work(makeHandler());
+				});
+	}
+
+	/**
+	 * @brief Stops the pool once the queued jobs are processed.
+	 */
+	~WorkerPool()
+	{
+		close();
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+public:
+	/**
+	 * @brief Queues a job if there is a free place in the queue.
+	 * @param[in] job The job, moved into the queue only if it is accepted.
+	 * @return Returns true if the job was queued, false if the queue is full, the pool is closed or it has no worker.
+	 */
+	bool trySubmit(Job& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (closed || threads.empty() || jobs.size() >= static_cast<size_t>(capacity))
+			{
+				statistics.rejected++;
+				return false;
+			}
+
+			jobs.push_back(Entry{ std::move(job), std::chrono::steady_clock::now() });
+			statistics.accepted++;
+		}
+
+		notEmpty.notify_one();
+
+		return true;
+	}
+
+	/**
+	 * @brief Queues a job, waiting for a free place in the queue.
+	 * @param[in] job The job, moved into the queue only if it is accepted.
+	 * @return Returns true if the job was queued, false if the pool is closed or it has no worker.
+	 */
+	bool submit(Job& job)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			notFull.wait(lock, [this]()
+				{
+					return closed || jobs.size() < static_cast<size_t>(capacity);
+				});
+
+			if (closed || threads.empty())
+			{
+				statistics.rejected++;
+				return false;
+			}
+
+			jobs.push_back(Entry{ std::move(job), std::chrono::steady_clock::now() });
+			statistics.accepted++;
+		}
+
+		notEmpty.notify_one();
+
+		return true;
+	}
+
+	/**
+	 * @brief Stops accepting jobs and returns once the queued jobs are processed and the workers are stopped.
+	 * @details This function must not be called by a worker of the pool.
+	 * @return void
+	 */
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+
+		notEmpty.notify_all();
+		notFull.notify_all();
+
+		for (std::thread& thread : threads)
+			if (thread.joinable())
+				thread.join();
+	}
+
+	/**
+	 * @brief Returns the number of jobs waiting for a worker.
+	 * @return The number of queued jobs.
+	 */
+	size_t pending() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return jobs.size();
+	}
+
+	/**
+	 * @brief Returns the number of worker threads.
+	 * @return The number of workers.
+	 */
+	int getWorkers() const
+	{
+		return static_cast<int>(threads.size());
+	}
+
+	/**
+	 * @brief Returns the number of jobs that can wait for a worker.
+	 * @return The capacity of the queue.
+	 */
+	int getCapacity() const
+	{
+		return capacity;
+	}
+
+	/**
+	 * @brief Returns how many jobs were accepted, rejected and processed since the pool started, and how long they waited and were processed.
+	 * @return The statistics of the pool.
+	 */
+	WorkerPoolStatistics getStatistics() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return statistics;
+	}
+
+private:
+	/**
+	 * @struct Entry
+	 * @brief Holds a queued job and the time it was queued.
+	 */
+	struct Entry
+	{
+		Job job;
+		std::chrono::steady_clock::time_point queued;
+	};
+
+	/**
+	 * @brief Processes the queued jobs with the handler of the calling worker until the pool is closed and its queue is empty.
+	 * @param[in] handler The handler of the worker.
+	 * @return void
+	 */
+	void work(const Handler& handler)
+	{
+		while (true)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			notEmpty.wait(lock, [this]()
+				{
+					return closed || !jobs.empty();
+				});
+
+			if (jobs.empty())
+				return;
+
+			Entry entry = std::move(jobs.front());
+			jobs.pop_front();
+			lock.unlock();
+
+			notFull.notify_one();
+
+			auto start = std::chrono::steady_clock::now();
+			double waitTime = std::chrono::duration<double, std::milli>(start - entry.queued).count();
+
+			handler(entry.job, waitTime);
+
+			double processTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			lock.lock();
+			statistics.completed++;
+			statistics.totalWaitTime += waitTime;
+			statistics.maxWaitTime = std::max(statistics.maxWaitTime, waitTime);
+			statistics.totalProcessTime += processTime;
+			statistics.maxProcessTime = std::max(statistics.maxProcessTime, processTime);
+		}
+	}
+
+private:
+	int capacity;
+	mutable std::mutex mutex;
+	std::condition_variable notEmpty, notFull;
+	std::deque<Entry> jobs;
+	WorkerPoolStatistics statistics;
+	bool closed = false;
+	std::vector<std::thread> threads;
+};
@@ -17,12 +17,68 @@
 #include <opencv2/opencv.hpp>
 #include <algorithm>
 #include <ZXing/Result.h> 
+#include <functional>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+enum class QRDecodeMode
+{
+	Sequential,
+	Speculative
+};
+
+enum class QRDecodePath
+{
+	None,
+	Direct,
+	Rectified
+};
+
+class QRCODEDETECTION_API QRDirectDecoder
+{
+public:
+	QRDirectDecoder() = default;
+
+	~QRDirectDecoder();
+
+	QRDirectDecoder(const QRDirectDecoder&) = delete;
+
+	QRDirectDecoder& operator=(const QRDirectDecoder&) = delete;
+
+	void start(const cv::Mat& gray);
+
+	bool isDecoded() const;
+
+	bool wait(std::string& id, ZXing::Position& position);
+
+private:
+	void run();
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::thread thread;
+	cv::Mat image;
+	bool pending = false;
+	bool running = false;
+	bool stopping = false;
+	std::atomic<bool> decoded = false;
+	std::string decodedId;
+	ZXing::Position decodedPosition;
+};
 
 class QRCODEDETECTION_API QRCode
 {
 public:
 	QRCode();
 
+	void setDecodeMode(const QRDecodeMode& mode);
+
+	void setPyramidLevels(const int& levels);
+
 	void generateQR(const std::string& id, const std::string& name, const std::string& licensePlate, const std::string& dataBasePath, const std::string& assetsPath, std::string& savePath, const std::string& dateTime = "", const std::string& timeParked = "", const int& totalAmount = 0);
 
 private:
@@ -36,7 +92,11 @@ private:
 
 	static bool isQuadrilateral(const std::vector<cv::Point>& contour);
 
-	static bool detectQRAnchors(const cv::Mat& binary, std::vector<std::vector<cv::Point>>& anchors);
+	static bool detectQRAnchors(const cv::Mat& binary, std::vector<std::vector<cv::Point>>& anchors, const int& count = 3, std::vector<float>* anchorScores = nullptr);
+
+	static void coarseAnchorCandidates(const cv::Mat& coarse, std::vector<std::vector<cv::Point>>& candidates);
+
+	static bool detectQRAnchorsPyramid(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, const int& levels);
 
 	static cv::Point2f getContourCentroid(const std::vector<cv::Point>& contour);
 
@@ -66,13 +126,24 @@ private:
 
 	static bool getMatrixFromImage(const cv::Mat& src, cv::Mat& dst, cv::dnn::Net aiModel);
 
-	static bool getID(const cv::Mat& src, std::string& id, ZXing::Position* position = nullptr);
+	static bool getID(const cv::Mat& src, std::string& id, ZXing::Position* position = nullptr, const bool& tryHarder = true);
 
 	static std::vector<cv::Point2f> cvtPositionToCoordinates(const ZXing::Position& position);
 
+	bool decodeRectified(const cv::Mat& gray, std::string& id, const std::function<bool()>& isCancelled);
+
 public:
+	static bool findAnchors(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, const int& pyramidLevels, bool* fromPyramid = nullptr);
+
 	std::string decodeQR(const std::string& path);
 
+	std::string decodeQR(const std::string& path, QRDecodePath& decodedPath);
+
 private:
 	cv::dnn::Net aiModel;
+	QRDecodeMode decodeMode = QRDecodeMode::Speculative;
+	int pyramidLevels = 1;
+	std::unique_ptr<QRDirectDecoder> directDecoder;
+
+	friend class QRDirectDecoder;
 };
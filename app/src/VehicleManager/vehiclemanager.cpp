@@ -1,4 +1,6 @@
 #include "vehiclemanager.h"
+#include "imagedecoder.h"
+#include "tesseractpool.h"
 
 #include <iomanip>
 
@@ -18,6 +20,11 @@ VehicleManager::VehicleManager()
 	dataBasePath = "database/";
 #endif
 
+	// The calibration profiles of the cameras are loaded once, at startup, and the gate camera is the only one of the application.
+	std::map<std::string, CameraCalibration> calibrations;
+	if (loadCalibrations(assetsPath + "calibration/", calibrations) && calibrations.count("gate"))
+		calibration = calibrations["gate"];
+
 	client->setTicketCallback(
 		[this](const std::string& id, const std::string& path, const std::string& licensePlate, const std::string& dateTime)
 		{
@@ -27,6 +34,8 @@ VehicleManager::VehicleManager()
 		});
 
 	client->connect();
+
+	TesseractPool::getInstance().warmUp(cv::getNumThreads());
 }
 
 inline std::vector<std::string> split(const std::string& string, const std::string& delimiter)
@@ -189,16 +198,54 @@ void VehicleManager::setNumberOccupiedParkingLots(int& numberOccupiedParkingLots
 			numberOccupiedParkingLots++;
 }
 
-void VehicleManager::getVehicle(const std::string& imagePath, std::string& savePath)
+void VehicleManager::getVehicle(const std::string& imagePath, std::string& savePath, cv::Mat& image)
+{
+	std::vector<uchar> buffer;
+	ImageDecoder::readFile(imagePath, buffer);
+
+	// The annotated image is stored and displayed, so it is decoded and annotated at the resolution of the camera.
+	setCurrentVehicle(plateFromImage(buffer, spatialPrior, calibration, true), savePath, image);
+}
+
+SpatialPriorStatistics VehicleManager::getSpatialPriorStatistics() const
+{
+	return spatialPrior.getStatistics();
+}
+
+bool VehicleManager::openStream(const std::string& source)
+{
+	StreamOptions options;
+	options.calibration = &calibration;
+
+	stream = std::make_unique<StreamRecognizer>(options);
+	return stream->open(source);
+}
+
+bool VehicleManager::readStream(PlateResult& result, const std::function<bool()>& isCancelled)
+{
+	return stream && stream->read(result, isCancelled);
+}
+
+void VehicleManager::setStreamVehicle(const PlateResult& result, std::string& savePath, cv::Mat& image)
+{
+	setCurrentVehicle(result, savePath, image);
+}
+
+void VehicleManager::setCurrentVehicle(const PlateResult& result, std::string& savePath, cv::Mat& image)
 {
 	savePath = dataBasePath + "vehicles/" + std::to_string(vehicles.size()) + ".jpg";
 
-	std::string text = textFromImage(imagePath, savePath);
+	// The saves that have finished are forgotten, so only the images still being written are tracked.
+	for (auto pending = pendingImages.begin(); pending != pendingImages.end();)
+		if (pending->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			pending = pendingImages.erase(pending);
+		else
+			++pending;
 
-	int plate = text.find('\n');
-	int dateTime = text.find('\n', plate + 1);
+	pendingImages[savePath] = saveImage(result.annotated, savePath).share();
+	image = result.annotated;
 
-	curentVehicle = Vehicle(vehicles.size(), savePath, text.substr(0, plate), text.substr(plate + 1, dateTime - plate - 1));
+	curentVehicle = Vehicle(vehicles.size(), savePath, result.plate, result.dateTime);
 }
 
 Vehicle* VehicleManager::findVehicle(const std::string& licensePlate, const std::string& ticket, const bool& isEntered, const bool& direction, const int& index)
@@ -390,9 +437,20 @@ void VehicleManager::searchTickets(std::string text, std::unordered_map<std::str
 
 std::string VehicleManager::getImagePath(const int& id) const
 {
+	waitForImage(vehicles[id].getPath());
+
 	return vehicles[id].getPath();
 }
 
+bool VehicleManager::waitForImage(const std::string& path) const
+{
+	auto pending = pendingImages.find(path);
+	if (pending == pendingImages.end())
+		return true;
+
+	return pending->second.get();
+}
+
 void VehicleManager::setName(const std::string& name)
 {
 	this->name = name;
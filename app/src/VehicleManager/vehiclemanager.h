@@ -9,12 +9,17 @@
 #include "vehicle.h"
 #include "ticket.h"
 #include "licenseplatedetection.h"
+#include "streamrecognizer.h"
+#include "spatialprior.h"
+#include "cameracalibration.h"
 #include "qrcodedetection.h"
 #include "websocketclient.h"
 
 #include <fstream>
 #include <vector>
 #include <map>
+#include <future>
+#include <memory>
 
 /**
  * @class VehicleManager
@@ -85,12 +90,53 @@ public:
 	/**
 	 * @brief Retrieves a vehicle's data based on the provided image path and saves the vehicle's image.
 	 * @details This function processes the image to extract the vehicle's license plate and date-time
-	 *          information. The vehicle's image is then saved to a predefined path.
+	 *          information. The image is decoded fully, so that the saved image keeps the resolution of the camera.
+	 *          The image is normalized with the calibration profile of the gate camera, if one was loaded,
+	 *          and the plate is searched first where the plates of the camera usually appear.
+	 *          The annotated vehicle's image is returned and saved to a predefined path in the background.
 	 * @param[in] imagePath The path to the image to be processed.
-	 * @param[out] savePath The path where the vehicle's image will be saved.
+	 * @param[out] savePath The path where the vehicle's image will be saved. The file may still be written when the function returns,
+	 *             so it must be opened only after waitForImage returns.
+	 * @param[out] image The annotated vehicle's image, or an empty image if the source could not be read.
 	 * @return void
 	 */
-	void getVehicle(const std::string& imagePath, std::string& savePath);
+	void getVehicle(const std::string& imagePath, std::string& savePath, cv::Mat& image);
+
+	/**
+	 * @brief Returns how often the plates of the gate camera were found where they usually appear.
+	 * @return The hit and miss rates of the spatial prior of the camera and the fraction of the pixels searched.
+	 */
+	SpatialPriorStatistics getSpatialPriorStatistics() const;
+
+	/**
+	 * @brief Opens a video file or a capture device for the stream recognition.
+	 * @details The frames are normalized with the calibration profile of the gate camera, if one was loaded.
+	 * @param[in] source The path of a video file, or the index of a capture device, such as "0".
+	 * @return Returns true if the source was opened, false otherwise.
+	 */
+	bool openStream(const std::string& source);
+
+	/**
+	 * @brief Reads the opened stream until the next vehicle passes.
+	 * @details This function reads frames until the plate of the next vehicle is recognized over its sharpest frames.
+	 *          It only uses the stream, so it can run on a worker thread while the other functions run on the interface thread,
+	 *          as long as the stream is not opened again meanwhile.
+	 * @param[out] result The recognition result of the pass.
+	 * @param[in] isCancelled A predicate checked before every frame, that returns true when the reading must stop, or an empty function.
+	 * @return Returns true if a vehicle was recognized, false once the stream has ended or the reading was cancelled.
+	 */
+	bool readStream(PlateResult& result, const std::function<bool()>& isCancelled = nullptr);
+
+	/**
+	 * @brief Sets a vehicle read from the stream as the current vehicle and saves the vehicle's image.
+	 * @details The annotated vehicle's image is returned and saved to a predefined path in the background.
+	 * @param[in] result The recognition result of the pass, as returned by readStream.
+	 * @param[out] savePath The path where the vehicle's image will be saved. The file may still be written when the function returns,
+	 *             so it must be opened only after waitForImage returns.
+	 * @param[out] image The annotated vehicle's image.
+	 * @return void
+	 */
+	void setStreamVehicle(const PlateResult& result, std::string& savePath, cv::Mat& image);
 
 	/**
 	 * @brief Finds a vehicle based on its license plate, ticket, and parking status.
@@ -161,12 +207,20 @@ public:
 	/**
 	 * @brief Returns the file path of the vehicle's image.
 	 * @details This function returns the path where the image of the vehicle with the specified
-	 *          ID is stored.
+	 *          ID is stored, once the image has been written.
 	 * @param[in] id The ID of the vehicle.
 	 * @return The file path of the vehicle's image.
 	 */
 	std::string getImagePath(const int& id) const;
 
+	/**
+	 * @brief Waits until a vehicle's image saved in the background is written.
+	 * @details The image path returned by getImagePath is already waited for.
+	 * @param[in] path The path where the vehicle's image is saved.
+	 * @return Returns false if the image could not be written, true otherwise, or if the image is not being saved.
+	 */
+	bool waitForImage(const std::string& path) const;
+
 	/**
 	 * @brief Sets the name for the vehicle manager.
 	 * @details This function sets the name of the vehicle manager to the provided string.
@@ -231,9 +285,20 @@ public:
 
 	std::string getTicketPath(const std::string& id);
 
+private:
+	/**
+	 * @brief Sets the current vehicle from a recognition result and saves its annotated image.
+	 * @param[in] result The recognition result.
+	 * @param[out] savePath The path where the vehicle's image will be saved.
+	 * @param[out] image The annotated vehicle's image.
+	 * @return void
+	 */
+	void setCurrentVehicle(const PlateResult& result, std::string& savePath, cv::Mat& image);
+
 private:
 	Vehicle curentVehicle;
 	std::vector<Vehicle> vehicles;
+	std::map<std::string, std::shared_future<bool>> pendingImages;
 	QRCode qr;
 	boost::asio::io_context ioContext;
 	std::shared_ptr<WebSocketClient> client;
@@ -246,4 +311,7 @@ private:
 	std::unordered_map<std::string, bool> vehiclesStatus;
 	std::map<std::string, Ticket> tickets;
 	std::function<void(const std::string&)> ticketCallback;
+	CameraCalibration calibration;
+	std::unique_ptr<StreamRecognizer> stream;
+	SpatialPrior spatialPrior;
 };
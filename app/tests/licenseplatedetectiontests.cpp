@@ -1,7 +1,19 @@
 ﻿#include <filesystem>
+#include <fstream>
 
 #include "CppUnitTest.h"
 #include "licenseplatedetection.h"
+#include "tesseractpool.h"
+#include "platerecognizer.h"
+#include "stageprofiler.h"
+#include "batchrecognizer.h"
+#include "streamrecognizer.h"
+#include "pipelinepolicy.h"
+#include "imagedecoder.h"
+#include "ocrbackend.h"
+#include "recognitionpool.h"
+#include "spatialprior.h"
+#include "cameracalibration.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -46,8 +58,310 @@ float RMS(const cv::Mat& first, const cv::Mat& second)
 	return result / (first.rows * first.cols * (255 / sqrt(3)));
 }
 
+cv::Mat allColours()
+{
+	cv::Mat colours(4096, 4096, CV_8UC3);
+	for (int i = 0; i < colours.rows; i++)
+		for (int j = 0; j < colours.cols; j++)
+		{
+			int colour = i * colours.cols + j;
+			colours.ptr<uchar>(i, j)[0] = colour & 255;
+			colours.ptr<uchar>(i, j)[1] = (colour >> 8) & 255;
+			colours.ptr<uchar>(i, j)[2] = (colour >> 16) & 255;
+		}
+	return colours;
+}
+
+void referenceBGR2HSV(const cv::Mat& src, cv::Mat& dst)
+{
+	dst = cv::Mat(src.size(), CV_8UC3);
+
+	for (int y = 0; y < src.rows; y++)
+		for (int x = 0; x < src.cols; x++)
+		{
+			double b = src.ptr<uchar>(y, x)[0] / 255.0;
+			double g = src.ptr<uchar>(y, x)[1] / 255.0;
+			double r = src.ptr<uchar>(y, x)[2] / 255.0;
+
+			double max = std::max(b, std::max(g, r));
+			double min = std::min(b, std::min(g, r));
+			double difference = max - min;
+			double h, s;
+
+			if (max == min)
+				h = 0;
+			else if (max == r)
+				h = fmod(60 * ((g - b) / difference) + 360, 360) / 2;
+			else if (max == g)
+				h = fmod(60 * ((b - r) / difference) + 120, 360) / 2;
+			else
+				h = fmod(60 * ((r - g) / difference) + 240, 360) / 2;
+
+			if (max == 0)
+				s = 0;
+			else
+				s = (difference / max) * 255;
+
+			dst.ptr<uchar>(y, x)[0] = h;
+			dst.ptr<uchar>(y, x)[1] = s;
+			dst.ptr<uchar>(y, x)[2] = max * 255;
+		}
+}
+
+void referenceHSV2BGR(const cv::Mat& src, cv::Mat& dst)
+{
+	dst = cv::Mat(src.size(), CV_8UC3);
+
+	for (int y = 0; y < src.rows; y++)
+		for (int x = 0; x < src.cols; x++)
+		{
+			double h = src.ptr<uchar>(y, x)[0];
+			double s = src.ptr<uchar>(y, x)[1] / 255.0;
+			double v = src.ptr<uchar>(y, x)[2] / 255.0;
+
+			double chroma = s * v;
+			double scaledHue = h / 30.0;
+			double secondaryComponent = chroma * (1 - std::abs(fmod(scaledHue, 2) - 1));
+			double valueAdjustment = v - chroma;
+
+			double b, g, r;
+			switch (int(scaledHue))
+			{
+			case 0: b = 0; g = secondaryComponent; r = chroma; break;
+			case 1: b = 0; g = chroma; r = secondaryComponent; break;
+			case 2: r = 0; g = chroma; b = secondaryComponent; break;
+			case 3: b = chroma; g = secondaryComponent; r = 0; break;
+			case 4: b = chroma; g = 0; r = secondaryComponent; break;
+			default: b = secondaryComponent; g = 0; r = chroma; break;
+			}
+
+			dst.ptr<uchar>(y, x)[0] = (b + valueAdjustment) * 255;
+			dst.ptr<uchar>(y, x)[1] = (g + valueAdjustment) * 255;
+			dst.ptr<uchar>(y, x)[2] = (r + valueAdjustment) * 255;
+		}
+}
+
+void referenceNonMaximumSuppression(const cv::Mat& src, cv::Mat& dst, const cv::Mat& directions)
+{
+	for (int y = 2; y < src.rows - 2; y++)
+		for (int x = 2; x < src.cols - 2; x++)
+		{
+			float direction = fmod(directions.ptr<float>(y, x)[0], 180);
+
+			uchar pixel = src.ptr<uchar>(y, x)[0];
+			uchar pixel1, pixel2, pixel3, pixel4;
+
+			if ((direction >= 0 && direction < 22.5) || (direction >= 157.5 && direction <= 180))
+			{
+				pixel1 = src.ptr<uchar>(y, x - 1)[0];
+				pixel2 = src.ptr<uchar>(y, x - 2)[0];
+				pixel3 = src.ptr<uchar>(y, x + 1)[0];
+				pixel4 = src.ptr<uchar>(y, x + 2)[0];
+			}
+			else if (direction >= 22.5 && direction < 67.5)
+			{
+				pixel1 = src.ptr<uchar>(y - 1, x - 1)[0];
+				pixel2 = src.ptr<uchar>(y - 2, x - 2)[0];
+				pixel3 = src.ptr<uchar>(y + 1, x + 1)[0];
+				pixel4 = src.ptr<uchar>(y + 2, x + 2)[0];
+			}
+			else if (direction >= 67.5 && direction < 112.5)
+			{
+				pixel1 = src.ptr<uchar>(y - 1, x)[0];
+				pixel2 = src.ptr<uchar>(y - 2, x)[0];
+				pixel3 = src.ptr<uchar>(y + 1, x)[0];
+				pixel4 = src.ptr<uchar>(y + 2, x)[0];
+			}
+			else
+			{
+				pixel1 = src.ptr<uchar>(y - 1, x + 1)[0];
+				pixel2 = src.ptr<uchar>(y - 2, x + 2)[0];
+				pixel3 = src.ptr<uchar>(y + 1, x - 1)[0];
+				pixel4 = src.ptr<uchar>(y + 2, x - 2)[0];
+			}
+
+			if (!(pixel < pixel1 || pixel <= pixel2 || pixel <= pixel3 || pixel <= pixel4))
+				dst.ptr<uchar>(y, x)[0] = 255;
+		}
+}
+
+bool identical(const cv::Mat& first, const cv::Mat& second)
+{
+	if (first.size() != second.size() || first.type() != second.type())
+		return false;
+
+	cv::Mat difference;
+	cv::absdiff(first, second, difference);
+	return !cv::countNonZero(difference.reshape(1));
+}
+
+class CountingAllocator : public cv::MatAllocator
+{
+public:
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		if (!data)
+		{
+			allocations++;
+
+			size_t total = CV_ELEM_SIZE(type);
+			for (int i = 0; i < dims; i++)
+				total *= sizes[i];
+			bytes += total;
+		}
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+
+	bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override
+	{
+		return cv::Mat::getStdAllocator()->allocate(data, accessFlags, usageFlags);
+	}
+
+	void deallocate(cv::UMatData* data) const override
+	{
+		cv::Mat::getStdAllocator()->deallocate(data);
+	}
+
+	mutable std::atomic<int> allocations{ 0 };
+	mutable std::atomic<size_t> bytes{ 0 };
+};
+
 TEST_CLASS(AlgorithmTests)
 {
+private:
+	static bool referenceCornersCoordinates(const cv::Mat& src, std::vector<cv::Point2f>& quadrilateralCoordinates, const std::vector<cv::Point>& largestContour)
+	{
+		cv::Mat erodedRegionContour;
+		cv::erode(src, erodedRegionContour, cv::Mat());
+		cv::Mat edges = src - erodedRegionContour;
+
+		cv::RotatedRect rotatedBBox = cv::minAreaRect(largestContour);
+		float minLineLenght = rotatedBBox.size.height * 0.25;
+		float maxLineGap = rotatedBBox.size.height * 0.1;
+
+		std::vector<cv::Vec4i> lines;
+		std::vector<cv::Vec4i> sortedLines;
+		do {
+			cv::HoughLinesP(edges, lines, 1, CV_PI / 180, 10, minLineLenght, maxLineGap);
+			minLineLenght--;
+		}
+		while (!Algorithm::lineSorting(sortedLines, lines, src.size()) && minLineLenght > 0);
+
+		if (minLineLenght <= 0)
+			return false;
+
+		for (int i = 0; i < sortedLines.size(); i++)
+			quadrilateralCoordinates.push_back(Algorithm::intersection(sortedLines[i], sortedLines[(i + 1) % 4]));
+
+		return true;
+	}
+
+	static void regionContours(std::vector<std::pair<cv::Mat, std::vector<cv::Point>>>& regions)
+	{
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		cv::resize(src, src, cv::Size(src.cols / 2, src.rows / 2));
+
+		cv::Rect roi(src.cols * 0.1, src.rows / 2, src.cols - src.cols * 0.1, src.rows / 2);
+		cv::Mat cropped = src(roi);
+
+		cv::Mat gauss, binary, stats;
+		std::vector<std::pair<int, int>> areas;
+		cv::GaussianBlur(cropped, gauss, cv::Size(3, 3), 0);
+		Algorithm::BGR2Binary(gauss, binary, 125);
+		Algorithm::getConnectedComponents(binary, stats, areas, 10);
+
+		for (const auto& area : areas)
+		{
+			cv::Rect roi;
+			Algorithm::getRoi(stats, roi, area.first);
+			if (!Algorithm::sizeBBox(cropped, roi, 0.01, 0.15) || !Algorithm::heightBBox(roi, 0.2, 0.9))
+				continue;
+
+			Algorithm::paddingRect(roi, roi, 0.05, false, cropped.size());
+
+			cv::Mat hsvConnectedComponent, bgrConnectedComponent, grayConnectedComponent, connectedComponent, edges;
+			Algorithm::BGR2HSV(gauss(roi), hsvConnectedComponent);
+			Algorithm::blueToBlack(hsvConnectedComponent, hsvConnectedComponent);
+			Algorithm::HSV2BGR(hsvConnectedComponent, bgrConnectedComponent);
+			cv::cvtColor(bgrConnectedComponent, grayConnectedComponent, cv::COLOR_BGR2GRAY);
+			cv::cvtColor(cropped(roi), connectedComponent, cv::COLOR_BGR2GRAY);
+
+			cv::threshold(grayConnectedComponent, edges, 0, 255, cv::THRESH_BINARY);
+			edges = 255 - edges;
+			Algorithm::edgeDetection(connectedComponent, edges);
+
+			cv::Mat regionContour;
+			std::vector<cv::Point> largestContour;
+			if (!Algorithm::roiContour(connectedComponent, regionContour, largestContour, edges, 0.8))
+				continue;
+
+			cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
+			cv::erode(regionContour, regionContour, kernel);
+			cv::dilate(regionContour, regionContour, kernel);
+			Algorithm::roiContour(regionContour, regionContour, largestContour);
+
+			regions.push_back({ regionContour, largestContour });
+		}
+
+		std::vector<std::string> plates = { absolutePath("connected_component.jpg") };
+		for (const auto& entry : std::filesystem::directory_iterator(absolutePath("../../../documentation/licenta/segmentari")))
+			plates.push_back(entry.path().string());
+
+		cv::RNG rng(0);
+		for (const auto& path : plates)
+		{
+			cv::Mat plate = cv::imread(path, cv::IMREAD_GRAYSCALE);
+			if (plate.empty())
+				continue;
+
+			cv::Size size(plate.cols * 1.4, plate.rows * 2);
+			cv::Point2f offset((size.width - plate.cols) / 2.0f, (size.height - plate.rows) / 2.0f);
+			std::vector<cv::Point2f> corners = { cv::Point2f(0, 0), cv::Point2f(plate.cols, 0), cv::Point2f(plate.cols, plate.rows), cv::Point2f(0, plate.rows) };
+			std::vector<cv::Point2f> skewedCorners;
+			for (const auto& corner : corners)
+				skewedCorners.push_back(corner + offset + cv::Point2f(rng.uniform(-0.1f, 0.1f) * plate.cols, rng.uniform(-0.2f, 0.2f) * plate.rows));
+
+			cv::Mat skewedPlate;
+			cv::warpPerspective(255 - plate, skewedPlate, cv::getPerspectiveTransform(corners, skewedCorners), size);
+
+			cv::Mat regionContour;
+			std::vector<cv::Point> largestContour;
+			if (Algorithm::roiContour(skewedPlate, regionContour, largestContour))
+				regions.push_back({ regionContour, largestContour });
+		}
+	}
+
+	static void drawnQuadrilaterals(std::vector<std::pair<cv::Mat, std::vector<cv::Point>>>& regions, std::vector<std::vector<cv::Point2f>>& exactCorners)
+	{
+		cv::RNG rng(0);
+		for (int i = 0; i < 200; i++)
+		{
+			float width = rng.uniform(80.0f, 400.0f);
+			float height = width / rng.uniform(3.0f, 5.0f);
+			cv::Size size(width * 1.4, height * 2);
+			cv::Point2f offset((size.width - width) / 2.0f, (size.height - height) / 2.0f);
+
+			std::vector<cv::Point2f> corners = { cv::Point2f(0, 0), cv::Point2f(width, 0), cv::Point2f(width, height), cv::Point2f(0, height) };
+			std::vector<cv::Point> shiftedCorners;
+			for (auto& corner : corners)
+			{
+				corner += offset + cv::Point2f(rng.uniform(-0.1f, 0.1f) * width, rng.uniform(-0.2f, 0.2f) * height);
+				shiftedCorners.push_back(cv::Point(cvRound(corner.x * 16), cvRound(corner.y * 16)));
+			}
+
+			cv::Mat quadrilateral = cv::Mat::zeros(size, CV_8UC1);
+			cv::fillConvexPoly(quadrilateral, shiftedCorners, cv::Scalar(255), cv::LINE_8, 4);
+
+			cv::Mat regionContour;
+			std::vector<cv::Point> largestContour;
+			if (!Algorithm::roiContour(quadrilateral, regionContour, largestContour))
+				continue;
+
+			regions.push_back({ regionContour, largestContour });
+			exactCorners.push_back(corners);
+		}
+	}
+
 public:
 	TEST_METHOD(BGR2HSV_InvalidInput)
 	{
@@ -72,6 +386,16 @@ public:
 		Assert::IsTrue(error < 0.05);
 	}
 
+	TEST_METHOD(BGR2HSV_BitExact)
+	{
+		cv::Mat src, dst, aux;
+
+		src = allColours();
+		referenceBGR2HSV(src, aux);
+		Algorithm::BGR2HSV(src, dst);
+		Assert::IsTrue(identical(dst, aux));
+	}
+
 	TEST_METHOD(HSV2Binary_InvalidInput)
 	{
 		cv::Mat src, dst;
@@ -103,6 +427,32 @@ public:
 		Assert::IsTrue(!cv::countNonZero(255 - dst));
 	}
 
+	TEST_METHOD(BGR2Binary_InvalidInput)
+	{
+		cv::Mat src, dst;
+
+		Algorithm::BGR2Binary(src, dst);
+		Assert::IsTrue(dst.empty());
+
+		src = cv::Mat::zeros(100, 100, CV_16FC3);
+		Algorithm::BGR2Binary(src, dst);
+		Assert::IsTrue(dst.empty());
+	}
+
+	TEST_METHOD(BGR2Binary_ValidInput)
+	{
+		cv::Mat src, hsv, dst, aux;
+
+		src = allColours();
+		for (int threshold : { 0, 60, 125, 200, 255 })
+		{
+			referenceBGR2HSV(src, hsv);
+			Algorithm::HSV2Binary(hsv, aux, threshold);
+			Algorithm::BGR2Binary(src, dst, threshold);
+			Assert::IsTrue(identical(dst, aux));
+		}
+	}
+
 	TEST_METHOD(getConnectedComponents_InvalidInput)
 	{
 		cv::Mat src, stats;
@@ -263,6 +613,75 @@ public:
 		Assert::IsTrue(result);
 	}
 
+	TEST_METHOD(candidateFeatures_InvalidInput)
+	{
+		cv::Mat src, binary, features, integral;
+
+		Algorithm::candidateFeatures(src, binary, features, integral);
+		Assert::IsTrue(integral.empty());
+
+		src = cv::Mat(10, 10, CV_8UC3);
+		binary = cv::Mat(10, 20, CV_8UC1);
+		Algorithm::candidateFeatures(src, binary, features, integral);
+		Assert::IsTrue(integral.empty());
+
+		binary = cv::Mat(10, 10, CV_8UC3);
+		Algorithm::candidateFeatures(src, binary, features, integral);
+		Assert::IsTrue(integral.empty());
+	}
+
+	TEST_METHOD(candidateFeatures_ValidInput)
+	{
+		cv::Mat src(40, 200, CV_8UC3, cv::Scalar(255, 255, 255));
+		cv::rectangle(src, cv::Rect(0, 0, 20, 40), cv::Scalar(153, 51, 0), cv::FILLED);
+		for (int i = 0; i < 7; i++)
+			cv::rectangle(src, cv::Rect(30 + i * 24, 8, 6, 24), cv::Scalar(0, 0, 0), cv::FILLED);
+
+		cv::Mat binary, features, integral;
+		Algorithm::BGR2Binary(src, binary, 125);
+		Algorithm::candidateFeatures(src, binary, features, integral);
+
+		Assert::IsTrue(features.size() == src.size() && features.type() == CV_8UC3);
+		Assert::IsTrue(integral.size() == cv::Size(src.cols + 1, src.rows + 1) && integral.type() == CV_32SC3);
+
+		// Every row through the characters crosses each of their 2 edges, plus the edge of the band.
+		cv::Vec3i total = integral.ptr<cv::Vec3i>(src.rows)[src.cols];
+		Assert::IsTrue(total[1] == 24 * 15 + 16 * 1);
+		Assert::IsTrue(total[2] == 20 * 40);
+	}
+
+	TEST_METHOD(candidateScore_InvalidInput)
+	{
+		cv::Mat integral;
+		float score;
+
+		Assert::IsTrue(!Algorithm::candidateScore(integral, cv::Rect(0, 0, 10, 10), 1, score));
+
+		integral = cv::Mat::zeros(11, 11, CV_32SC3);
+		Assert::IsTrue(!Algorithm::candidateScore(integral, cv::Rect(), 1, score));
+		Assert::IsTrue(!Algorithm::candidateScore(integral, cv::Rect(5, 5, 10, 10), 1, score));
+
+		integral = cv::Mat::zeros(11, 11, CV_32SC1);
+		Assert::IsTrue(!Algorithm::candidateScore(integral, cv::Rect(0, 0, 10, 10), 1, score));
+	}
+
+	TEST_METHOD(candidateScore_ValidInput)
+	{
+		cv::Mat src(40, 400, CV_8UC3, cv::Scalar(255, 255, 255));
+		cv::rectangle(src, cv::Rect(0, 0, 20, 40), cv::Scalar(153, 51, 0), cv::FILLED);
+		for (int i = 0; i < 7; i++)
+			cv::rectangle(src, cv::Rect(30 + i * 24, 8, 6, 24), cv::Scalar(0, 0, 0), cv::FILLED);
+
+		cv::Mat binary, features, integral;
+		Algorithm::BGR2Binary(src, binary, 125);
+		Algorithm::candidateFeatures(src, binary, features, integral);
+
+		float plateScore, blankScore;
+		Assert::IsTrue(Algorithm::candidateScore(integral, cv::Rect(20, 0, 180, 40), 0.8, plateScore));
+		Assert::IsTrue(!Algorithm::candidateScore(integral, cv::Rect(220, 0, 180, 40), 1, blankScore));
+		Assert::IsTrue(plateScore > 0 && blankScore == 0);
+	}
+
 	TEST_METHOD(paddingRect_InvalidInput)
 	{
 		cv::Rect src(0, 0, 10, 10), dst;
@@ -394,6 +813,33 @@ public:
 		Assert::IsTrue(error < 0.001);
 	}
 
+	TEST_METHOD(HSV2BGR_BitExact)
+	{
+		cv::Mat src, dst, aux;
+
+		src = allColours();
+		referenceHSV2BGR(src, aux);
+		Algorithm::HSV2BGR(src, dst);
+		Assert::IsTrue(identical(dst, aux));
+	}
+
+	TEST_METHOD(blueToBlack_BitExact)
+	{
+		cv::Mat src, dst;
+
+		src = allColours();
+		Algorithm::blueToBlack(src, dst);
+
+		for (int i = 0; i < src.rows; i++)
+			for (int j = 0; j < src.cols; j++)
+			{
+				const uchar* pixel = src.ptr<uchar>(i, j);
+				bool isBlue = pixel[0] > 100 && pixel[0] < 130 && pixel[1] > 90 && pixel[1] < 230 && pixel[2] > 110 && pixel[2] < 195;
+				cv::Vec3b expected = isBlue ? cv::Vec3b(0, 0, 0) : cv::Vec3b(pixel[0], pixel[1], pixel[2]);
+				Assert::IsTrue(dst.at<cv::Vec3b>(i, j) == expected);
+			}
+	}
+
 	TEST_METHOD(histogram_InvalidInput)
 	{
 		cv::Mat src, dst;
@@ -603,6 +1049,80 @@ public:
 		Assert::IsTrue(error < 0.01);
 	}
 
+	TEST_METHOD(nonMaximumSuppression_BitExact)
+	{
+		cv::Mat src, dst, direction, aux, gray, x, y, magnitude;
+
+		// Directions exactly on the bin bounds and on the full turn, mixed with the ones of a real image.
+		src = cv::imread(absolutePath("lenna.jpg"));
+		cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+		cv::Sobel(gray, x, CV_32F, 1, 0);
+		cv::Sobel(gray, y, CV_32F, 0, 1);
+		cv::cartToPolar(x, y, magnitude, direction, true);
+		cv::normalize(magnitude, magnitude, 0, 255, cv::NORM_MINMAX);
+		magnitude.convertTo(src, CV_8UC1);
+
+		const float bounds[] = { 0, 22.5, 67.5, 112.5, 157.5, 180, 202.5, 247.5, 292.5, 337.5, 360 };
+		for (int i = 0; i < direction.rows; i += 3)
+			for (int j = i % 7; j < direction.cols; j += 7)
+				direction.ptr<float>(i, j)[0] = bounds[(i + j) % 11];
+
+		// Odd widths leave a scalar tail after the vectorized part of each row.
+		for (int width : { direction.cols, direction.cols - 1, 37, 5, 4 })
+		{
+			cv::Rect roi(0, 0, width, direction.rows);
+
+			dst = cv::Mat::zeros(roi.size(), CV_8UC1);
+			src(roi).copyTo(dst, src(roi) > 200);
+			aux = dst.clone();
+
+			referenceNonMaximumSuppression(src(roi), aux, direction(roi));
+			Algorithm::nonMaximumSuppression(src(roi), dst, direction(roi));
+			Assert::IsTrue(identical(dst, aux));
+		}
+	}
+
+	TEST_METHOD(rowKernels_ThreadBudgetBitExact)
+	{
+		cv::Mat src, gray, sobel, direction;
+
+		// A 4K frame, large enough to be split into bands, and an odd height so that the bands are uneven.
+		src = cv::imread(absolutePath("lenna.jpg"));
+		cv::resize(src, src, cv::Size(3840, 2161));
+		cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+		Algorithm::binarySobel(gray, sobel, direction);
+
+		auto run = [&](const int& threads)
+			{
+				setThreadBudget(threads);
+
+				std::vector<cv::Mat> results(7);
+				Algorithm::BGR2HSV(src, results[0]);
+				Algorithm::HSV2BGR(results[0], results[1]);
+				Algorithm::HSV2Binary(results[0], results[2]);
+				Algorithm::BGR2Binary(src, results[3]);
+				Algorithm::blueToBlack(results[0], results[4]);
+
+				results[5] = gray.clone();
+				Algorithm::bitwiseNand(results[5], sobel);
+
+				results[6] = cv::Mat::zeros(gray.size(), CV_8UC1);
+				Algorithm::nonMaximumSuppression(gray, results[6], direction);
+
+				return results;
+			};
+
+		std::vector<cv::Mat> expected = run(1);
+		for (int threads : { 2, 3, 8, 0 })
+		{
+			std::vector<cv::Mat> results = run(threads);
+			for (size_t i = 0; i < results.size(); i++)
+				Assert::IsTrue(identical(results[i], expected[i]));
+		}
+
+		setThreadBudget(0);
+	}
+
 	TEST_METHOD(edgeDetection_InvalidInput)
 	{
 		cv::Mat src, dst;
@@ -851,44 +1371,24 @@ public:
 		std::vector<cv::Vec4i> lines;
 		cv::Size size;
 
-#ifdef _DEBUG
-		Algorithm::lineSorting(sortedLines, lines, size, cv::Mat());
-#else
 		Algorithm::lineSorting(sortedLines, lines, size);
-#endif
 		Assert::IsTrue(sortedLines.empty());
 
 		lines.push_back(cv::Vec4i(0, 10, 0, 0));
-#ifdef _DEBUG
-		Algorithm::lineSorting(sortedLines, lines, size, cv::Mat());
-#else
 		Algorithm::lineSorting(sortedLines, lines, size);
-#endif	
 		Assert::IsTrue(sortedLines.empty());
 
 		lines.clear();
 		lines.push_back(cv::Vec4i(10, 0, 0, 0));
-#ifdef _DEBUG
-		Algorithm::lineSorting(sortedLines, lines, size, cv::Mat());
-#else
 		Algorithm::lineSorting(sortedLines, lines, size);
-#endif	
 		Assert::IsTrue(sortedLines.empty());
 
 		lines.push_back(cv::Vec4i(0, 10, 0, 0));
-#ifdef _DEBUG
-		Algorithm::lineSorting(sortedLines, lines, size, cv::Mat());
-#else
 		Algorithm::lineSorting(sortedLines, lines, size);
-#endif		
 		Assert::IsTrue(sortedLines.empty());
 
 		size = cv::Size(-1, -1);
-#ifdef _DEBUG
-		Algorithm::lineSorting(sortedLines, lines, size, cv::Mat());
-#else
 		Algorithm::lineSorting(sortedLines, lines, size);
-#endif
 		Assert::IsTrue(sortedLines.empty());
 	}
 
@@ -906,11 +1406,12 @@ public:
 		size = cv::Size(101, 101);
 		src = cv::Mat::zeros(size, CV_8UC1);
 
-#ifdef _DEBUG
 		Algorithm::lineSorting(sortedLines, lines, size, src);
-#else
-		Algorithm::lineSorting(sortedLines, lines, size);
-#endif
+		Assert::IsTrue(sortedLines[0] == lines[2] && sortedLines[1] == lines[0] && sortedLines[2] == lines[3] && sortedLines[3] == lines[1]);
+
+		// The diagnostic instantiation sorts the lines identically.
+		sortedLines.clear();
+		Algorithm::lineSorting<DumpVisualization>(sortedLines, lines, size, src);
 
 		Assert::IsTrue(sortedLines[0] == lines[2] && sortedLines[1] == lines[0] && sortedLines[2] == lines[3] && sortedLines[3] == lines[1]);
 	}
@@ -986,6 +1487,104 @@ public:
 		Assert::IsTrue(quadrilateralCoordinates[3] == cv::Point2f(10, 80));
 	}
 
+	TEST_METHOD(cornersCoordinates_Benchmark)
+	{
+		std::vector<std::pair<cv::Mat, std::vector<cv::Point>>> regions;
+		regionContours(regions);
+		Assert::IsFalse(regions.empty());
+
+		// The drawn quadrilaterals come last, with their exact corners, since the retry loop is itself off by a pixel or more
+		// on skewed sides and cannot be the reference of a one pixel tolerance.
+		size_t realRegions = regions.size();
+		std::vector<std::vector<cv::Point2f>> exactCorners;
+		drawnQuadrilaterals(regions, exactCorners);
+		Assert::IsFalse(exactCorners.empty());
+
+		std::vector<bool> referenceFound(regions.size()), found(regions.size());
+		std::vector<std::vector<cv::Point2f>> referenceCorners(regions.size()), corners(regions.size());
+
+		auto measure = [&](const bool& reference)
+			{
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < regions.size(); i++)
+				{
+					if (reference)
+					{
+						referenceCorners[i].clear();
+						referenceFound[i] = referenceCornersCoordinates(regions[i].first, referenceCorners[i], regions[i].second);
+					}
+					else
+					{
+						corners[i].clear();
+						found[i] = Algorithm::cornersCoordinates(regions[i].first, corners[i], regions[i].second);
+					}
+				}
+				auto end = std::chrono::steady_clock::now();
+				return std::chrono::duration<double, std::milli>(end - start).count() / regions.size();
+			};
+
+		double before = measure(true);
+		double after = measure(false);
+
+		std::vector<double> realDistances;
+		for (int i = 0; i < realRegions; i++)
+		{
+			Assert::IsTrue(found[i] || !referenceFound[i]);
+			if (!found[i] || !referenceFound[i])
+				continue;
+
+			for (int j = 0; j < 4; j++)
+				realDistances.push_back(cv::norm(corners[i][j] - referenceCorners[i][j]));
+		}
+
+		int exactCount = 0, referenceCount = 0, outside = 0;
+		double exactError = 0, referenceError = 0;
+		for (int i = realRegions; i < regions.size(); i++)
+		{
+			const std::vector<cv::Point2f>& exact = exactCorners[i - realRegions];
+
+			Assert::IsTrue(found[i]);
+			for (int j = 0; j < 4; j++)
+			{
+				double error = cv::norm(corners[i][j] - exact[j]);
+				exactError += error;
+				exactCount++;
+				if (error > 1)
+					outside++;
+			}
+
+			if (!referenceFound[i])
+				continue;
+
+			for (int j = 0; j < 4; j++)
+			{
+				referenceError += cv::norm(referenceCorners[i][j] - exact[j]);
+				referenceCount++;
+			}
+		}
+		exactError /= exactCount;
+		referenceError /= std::max(referenceCount, 1);
+
+		std::sort(realDistances.begin(), realDistances.end());
+		auto percentile = [&realDistances](const double& fraction)
+			{
+				return realDistances.empty() ? 0 : realDistances[std::min(static_cast<size_t>(fraction * realDistances.size()), realDistances.size() - 1)];
+			};
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(3) << "cornersCoordinates per region (" << regions.size() << " regions): "
+			<< before << " ms with the retry loop, " << after << " ms with the fitted sides, " << before / after << "x" << std::endl
+			<< "drawn quadrilaterals (" << exactCount / 4 << "): mean corner error " << exactError << " px with the fitted sides, "
+			<< referenceError << " px with the retry loop, " << outside << " of " << exactCount << " corners farther than 1 px" << std::endl
+			<< "real regions (" << realRegions << "): distance to the retry loop p50 " << percentile(0.5) << " px, p90 " << percentile(0.9) << " px" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(exactError <= 0.5);
+		Assert::IsTrue(outside * 100 <= exactCount);
+		Assert::IsTrue(exactError < referenceError);
+		Assert::IsTrue(after < before);
+	}
+
 	TEST_METHOD(resizeToPoints_InvalidInput)
 	{
 		cv::Mat src, dst;
@@ -1374,19 +1973,11 @@ public:
 		std::array<std::vector<cv::Rect>, 3> words;
 		std::array<int, 3> indexes;
 
-#ifdef _DEBUG
-		Algorithm::wordsSeparation(chars, words, indexes, cv::Mat());
-#else
 		Algorithm::wordsSeparation(chars, words, indexes);
-#endif
 		Assert::IsTrue(words[0].empty() && words[1].empty() && words[2].empty());
 
 		chars.push_back(cv::Rect(0, 0, 0, 0));
-#ifdef _DEBUG
-		Algorithm::wordsSeparation(chars, words, indexes, cv::Mat());
-#else
 		Algorithm::wordsSeparation(chars, words, indexes);
-#endif
 		Assert::IsTrue(words[0].empty() && words[1].empty() && words[2].empty());
 	}
 
@@ -1406,11 +1997,7 @@ public:
 		chars.push_back(cv::Rect(80, 0, 10, 10));
 		chars.push_back(cv::Rect(100, 0, 10, 10));
 
-#ifdef _DEBUG
-		Algorithm::wordsSeparation(chars, words, indexes, cv::Mat());
-#else
 		Algorithm::wordsSeparation(chars, words, indexes);
-#endif
 		Assert::IsTrue(words[0].size() == 1 && words[1].size() == 2 && words[2].size() == 3);
 	}
 
@@ -1547,6 +2134,44 @@ public:
 		Assert::IsTrue(dice > 0.9);
 	}
 
+	TEST_METHOD(matching_CachedTemplate)
+	{
+		cv::Mat src, charTemplate;
+		float dice, cachedDice;
+
+		src = cv::imread(absolutePath("I.jpg"), cv::IMREAD_GRAYSCALE);
+		cv::threshold(src, src, 55, 255, cv::THRESH_BINARY);
+		charTemplate = cv::imread(absolutePath("../../assets/I.jpg"), cv::IMREAD_GRAYSCALE);
+
+		for (const float& scale : { 0.25f, 0.5f, 1.0f, 1.5f })
+		{
+			cv::Mat scaledSrc;
+			cv::resize(src, scaledSrc, cv::Size(), scale, scale, cv::INTER_NEAREST);
+
+			cv::Mat resizedCharTemplate;
+			Assert::IsTrue(Algorithm::resizeCharTemplate(charTemplate, resizedCharTemplate, scaledSrc.size()));
+
+			int width = std::max(scaledSrc.cols, resizedCharTemplate.cols);
+			int paddingTop, paddingBottom, paddingLeft, paddingRight;
+			Algorithm::padding(scaledSrc.rows, resizedCharTemplate.rows, paddingTop, paddingBottom);
+			Algorithm::padding(width, resizedCharTemplate.cols, paddingLeft, paddingRight);
+			cv::copyMakeBorder(resizedCharTemplate, resizedCharTemplate, paddingTop, paddingBottom, paddingLeft, paddingRight, cv::BORDER_CONSTANT);
+
+			cv::Mat paddedSrc;
+			Algorithm::padding(width, scaledSrc.cols, paddingLeft, paddingRight);
+			cv::copyMakeBorder(scaledSrc, paddedSrc, 0, 0, paddingLeft, paddingRight, cv::BORDER_CONSTANT);
+
+			cv::Mat intersection;
+			cv::bitwise_and(paddedSrc, resizedCharTemplate, intersection);
+			float referenceDice = (2.0 * cv::countNonZero(intersection)) / (cv::countNonZero(paddedSrc) + cv::countNonZero(resizedCharTemplate));
+
+			Algorithm::matching(scaledSrc, dice);
+			Algorithm::matching(scaledSrc, cachedDice);
+			Assert::AreEqual(referenceDice, dice);
+			Assert::AreEqual(dice, cachedDice);
+		}
+	}
+
 	TEST_METHOD(applyTesseract_InvalidInput)
 	{
 		cv::Mat src;
@@ -1636,46 +2261,298 @@ public:
 		indexes = { 0, 2, 4 };
 		Algorithm::paddingChars(chars, paddedChars, 0.6);
 
-#ifdef _DEBUG
-		Algorithm::wordsSeparation(chars, words, indexes, src);
-		Algorithm::wordsSeparation(paddedChars, paddedWords, indexes, src);
-#else
 		Algorithm::wordsSeparation(chars, words, indexes);
 		Algorithm::wordsSeparation(paddedChars, paddedWords, indexes);
-#endif
 
 		Algorithm::readText(src, text, confidence, words, paddedWords);
 		Assert::IsTrue(text == "CT36NLA" && confidence > 0.95);
 	}
 
-	TEST_METHOD(drawBBoxes_InvalidInput)
+	TEST_METHOD(readText_Benchmark)
 	{
-		cv::Mat dst;
-		cv::Rect roi;
-		std::string time, text;
-		float confidence;
+		cv::Mat src;
+		std::array<std::vector<cv::Rect>, 3> words;
+		std::array<std::vector<cv::Rect>, 3> paddedWords;
+		std::vector<cv::Rect> chars, paddedChars;
+		std::array<int, 3> indexes;
 
-		Algorithm::drawBBoxes(dst, roi, time, text, confidence);
-		Assert::IsTrue(dst.empty());
+		src = cv::imread(absolutePath("connected_component.jpg"), cv::IMREAD_GRAYSCALE);
 
-		dst = cv::Mat::zeros(100, 100, CV_8UC3);
-		roi = cv::Rect(0, 0, 0, 0);
-		time = "";
-		text = "";
-		confidence = -1;
-		Algorithm::drawBBoxes(dst, roi, time, text, confidence);
-		Assert::IsTrue(!dst.empty());
+		cv::threshold(src, src, 55, 255, cv::THRESH_BINARY);
+		Algorithm::charsBBoxes(src, chars);
+		indexes = { 0, 2, 4 };
+		Algorithm::paddingChars(chars, paddedChars, 0.6);
 
-		dst = cv::Mat::zeros(100, 100, CV_16FC1);
-		Algorithm::drawBBoxes(dst, roi, time, text, confidence);
-		Assert::IsTrue(!dst.empty());
+		Algorithm::wordsSeparation(chars, words, indexes);
+		Algorithm::wordsSeparation(paddedChars, paddedWords, indexes);
+
+		auto measure = [&](const bool& cold)
+			{
+				const int iterations = 10;
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < iterations; i++)
+				{
+					if (cold)
+						TesseractPool::getInstance().clear();
+
+					std::string text;
+					float confidence = 0;
+					std::array<std::vector<cv::Rect>, 3> auxPaddedWords = paddedWords;
+					Algorithm::readText(src, text, confidence, words, auxPaddedWords);
+					Assert::IsTrue(text == "CT36NLA");
+				}
+				auto end = std::chrono::steady_clock::now();
+				return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+			};
+
+		double before = measure(true);
+		TesseractPool::getInstance().warmUp(1);
+		double after = measure(false);
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2) << "readText per plate: " << before << " ms with engine initialization, " << after << " ms with pooled engines" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(after < before);
 	}
 
-	TEST_METHOD(drawBBoxes_ValidInput)
+	TEST_METHOD(readText_RecognitionModes)
 	{
-		cv::Mat dst, aux;
-		cv::Rect roi;
-		std::string time, text;
+		cv::Mat src;
+		std::array<std::vector<cv::Rect>, 3> words;
+		std::array<std::vector<cv::Rect>, 3> paddedWords;
+		std::vector<cv::Rect> chars, paddedChars;
+		std::array<int, 3> indexes;
+
+		src = cv::imread(absolutePath("connected_component.jpg"), cv::IMREAD_GRAYSCALE);
+
+		cv::threshold(src, src, 55, 255, cv::THRESH_BINARY);
+		Algorithm::charsBBoxes(src, chars);
+		indexes = { 0, 2, 4 };
+		Algorithm::paddingChars(chars, paddedChars, 0.6);
+
+		Algorithm::wordsSeparation(chars, words, indexes);
+		Algorithm::wordsSeparation(paddedChars, paddedWords, indexes);
+
+		TesseractPool::getInstance().warmUp(1);
+
+		auto measure = [&](const RecognitionMode& mode, double& calls)
+			{
+				const int iterations = 10;
+				Algorithm::ocrCalls = 0;
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < iterations; i++)
+				{
+					std::string text;
+					float confidence = 0;
+					std::array<std::vector<cv::Rect>, 3> auxPaddedWords = paddedWords;
+					Algorithm::readText(src, text, confidence, words, auxPaddedWords, mode);
+					Assert::IsTrue(text == "CT36NLA");
+					Assert::IsTrue(confidence > 0);
+				}
+				auto end = std::chrono::steady_clock::now();
+				calls = static_cast<double>(Algorithm::ocrCalls) / iterations;
+				return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+			};
+
+		double charactersCalls, wordsCalls;
+		double before = measure(RecognitionMode::Characters, charactersCalls);
+		double after = measure(RecognitionMode::Words, wordsCalls);
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2) << "readText per plate: " << charactersCalls << " OCR calls and " << before << " ms per character, "
+			<< wordsCalls << " OCR calls and " << after << " ms per word" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(wordsCalls < charactersCalls);
+		Assert::IsTrue(after < before);
+	}
+
+	TEST_METHOD(CnnBackend_InvalidInput)
+	{
+		CnnBackend backend(absolutePath("missing.onnx"));
+		Assert::IsFalse(backend.isLoaded());
+		Assert::IsTrue(backend.type() == OcrBackendType::Cnn);
+
+		Assert::IsFalse(setOcrBackend(OcrBackendType::Cnn, absolutePath("missing.onnx")));
+		Assert::IsTrue(OcrBackend::current()->type() == OcrBackendType::Tesseract);
+
+		cv::Mat src, dst;
+		Assert::IsFalse(CnnBackend::prepareChar(src, cv::Rect(0, 0, 10, 10), cv::Size(10, 10), dst));
+
+		src = cv::Mat::zeros(100, 100, CV_16FC1);
+		Assert::IsFalse(CnnBackend::prepareChar(src, cv::Rect(0, 0, 10, 10), cv::Size(10, 10), dst));
+
+		src = cv::Mat::zeros(100, 100, CV_8UC1);
+		Assert::IsFalse(CnnBackend::prepareChar(src, cv::Rect(200, 200, 10, 10), cv::Size(10, 10), dst));
+		Assert::IsFalse(CnnBackend::prepareChar(src, cv::Rect(0, 0, 10, 10), cv::Size(), dst));
+		Assert::IsTrue(dst.empty());
+
+		std::array<std::vector<cv::Rect>, 3> words;
+		std::array<std::vector<cv::Rect>, 3> paddedWords;
+		std::array<std::string, 3> texts;
+		std::array<float, 3> confidences;
+		Assert::IsFalse(backend.readWords(src, texts, confidences, words, paddedWords, { false, true, false }, RecognitionMode::Words));
+	}
+
+	TEST_METHOD(CnnBackend_ValidInput)
+	{
+		cv::Mat src, dst;
+		std::vector<cv::Rect> chars, paddedChars;
+
+		src = cv::imread(absolutePath("connected_component.jpg"), cv::IMREAD_GRAYSCALE);
+
+		cv::threshold(src, src, 55, 255, cv::THRESH_BINARY);
+		Algorithm::charsBBoxes(src, chars);
+		Algorithm::paddingChars(chars, paddedChars, 0.6);
+
+		for (int i = 0; i < chars.size(); i++)
+		{
+			Assert::IsTrue(CnnBackend::prepareChar(src, paddedChars[i], chars[i].size(), dst));
+			Assert::IsTrue(dst.size() == cv::Size(CnnBackend::inputSize, CnnBackend::inputSize) && dst.type() == CV_8UC1);
+
+			// The character is centred with a black margin on every side.
+			Assert::IsTrue(cv::countNonZero(dst) > 0);
+			Assert::IsTrue(!cv::countNonZero(dst.row(0)) && !cv::countNonZero(dst.row(dst.rows - 1)));
+			Assert::IsTrue(!cv::countNonZero(dst.col(0)) && !cv::countNonZero(dst.col(dst.cols - 1)));
+		}
+	}
+
+	TEST_METHOD(OcrBackends_Benchmark)
+	{
+		struct Plate
+		{
+			cv::Mat spaced;
+			std::string label;
+			std::array<std::vector<cv::Rect>, 3> words;
+			std::array<std::vector<cv::Rect>, 3> paddedWords;
+		};
+
+		// Restores the default backend even when an assertion fails, so that the tests run after this one still read with Tesseract.
+		struct TesseractGuard
+		{
+			~TesseractGuard()
+			{
+				setOcrBackend(OcrBackendType::Tesseract);
+			}
+		};
+
+		// The plates segmented in the thesis, segmented again exactly as the recognizer does it. Every fourth plate chose the best epoch
+		// of the CNN in training/train_platechars.py, so both backends are compared on the other ones, which the CNN never saw.
+		std::vector<Plate> plates, heldOutPlates;
+		std::ifstream labels(absolutePath("../../../documentation/licenta/segmentari/labels.txt"));
+		std::string name, label;
+		for (int index = 0; labels >> name >> label; index++)
+		{
+			cv::Mat src = cv::imread(absolutePath("../../../documentation/licenta/segmentari/" + name), cv::IMREAD_GRAYSCALE);
+			Assert::IsFalse(src.empty());
+
+			Plate plate;
+			plate.label = label;
+
+			std::vector<cv::Rect> chars, paddedChars;
+			std::array<int, 3> indexes;
+			cv::threshold(src, src, 55, 255, cv::THRESH_BINARY);
+			Algorithm::charsBBoxes(src, chars);
+			if (!Algorithm::firstIndexes(chars, indexes))
+				continue;
+
+			Algorithm::paddingChars(chars, paddedChars, 0.6);
+			Algorithm::charsSpacing(src, plate.spaced, chars, paddedChars);
+			Algorithm::wordsSeparation(chars, plate.words, indexes);
+			Algorithm::wordsSeparation(paddedChars, plate.paddedWords, indexes);
+
+			plates.push_back(plate);
+			if (index % 4)
+				heldOutPlates.push_back(plate);
+		}
+		Assert::IsTrue(plates.size() > 150);
+
+		auto measure = [](const std::vector<Plate>& readPlates, double& plateAccuracy, double& charAccuracy)
+			{
+				int correctPlates = 0, correctChars = 0, totalChars = 0;
+				auto start = std::chrono::steady_clock::now();
+				for (const Plate& plate : readPlates)
+				{
+					std::string text;
+					float confidence = 0;
+					std::array<std::vector<cv::Rect>, 3> auxPaddedWords = plate.paddedWords;
+					Algorithm::readText(plate.spaced, text, confidence, plate.words, auxPaddedWords);
+
+					correctPlates += text == plate.label;
+					totalChars += static_cast<int>(plate.label.size());
+					for (int i = 0; i < std::min(text.size(), plate.label.size()); i++)
+						correctChars += text[i] == plate.label[i];
+				}
+				auto end = std::chrono::steady_clock::now();
+
+				plateAccuracy = static_cast<double>(correctPlates) / readPlates.size();
+				charAccuracy = static_cast<double>(correctChars) / totalChars;
+				return std::chrono::duration<double, std::milli>(end - start).count() / readPlates.size();
+			};
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2);
+
+		TesseractPool::getInstance().warmUp(1);
+		double tesseractPlates, tesseractChars;
+		double tesseract = measure(plates, tesseractPlates, tesseractChars);
+		stream << "Tesseract on " << plates.size() << " plates: " << tesseractPlates * 100 << "% plates and " << tesseractChars * 100 << "% characters read, "
+			<< tesseract << " ms per plate" << std::endl;
+
+		Assert::IsTrue(tesseractPlates > 0.9);
+
+		tesseract = measure(heldOutPlates, tesseractPlates, tesseractChars);
+		stream << "Tesseract on " << heldOutPlates.size() << " held out plates: " << tesseractPlates * 100 << "% plates and " << tesseractChars * 100 << "% characters read, "
+			<< tesseract << " ms per plate" << std::endl;
+
+		{
+			TesseractGuard guard;
+
+			// The model shipped next to the application, as CnnBackend loads it by default.
+			Assert::IsTrue(setOcrBackend(OcrBackendType::Cnn, absolutePath("../../platechars.onnx")));
+
+			// The first pass creates the network, as the warm up does for the Tesseract engines.
+			double cnnPlates, cnnChars;
+			measure(heldOutPlates, cnnPlates, cnnChars);
+			double cnn = measure(heldOutPlates, cnnPlates, cnnChars);
+			stream << "CNN on " << heldOutPlates.size() << " held out plates: " << cnnPlates * 100 << "% plates and " << cnnChars * 100 << "% characters read, "
+				<< cnn << " ms per plate" << std::endl;
+		}
+
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(OcrBackend::current()->type() == OcrBackendType::Tesseract);
+	}
+
+	TEST_METHOD(drawBBoxes_InvalidInput)
+	{
+		cv::Mat dst;
+		cv::Rect roi;
+		std::string time, text;
+		float confidence;
+
+		Algorithm::drawBBoxes(dst, roi, time, text, confidence);
+		Assert::IsTrue(dst.empty());
+
+		dst = cv::Mat::zeros(100, 100, CV_8UC3);
+		roi = cv::Rect(0, 0, 0, 0);
+		time = "";
+		text = "";
+		confidence = -1;
+		Algorithm::drawBBoxes(dst, roi, time, text, confidence);
+		Assert::IsTrue(!dst.empty());
+
+		dst = cv::Mat::zeros(100, 100, CV_16FC1);
+		Algorithm::drawBBoxes(dst, roi, time, text, confidence);
+		Assert::IsTrue(!dst.empty());
+	}
+
+	TEST_METHOD(drawBBoxes_ValidInput)
+	{
+		cv::Mat dst, aux;
+		cv::Rect roi;
+		std::string time, text;
 		float confidence;
 
 		dst = cv::Mat::zeros(1000, 3000, CV_8UC3);
@@ -1701,6 +2578,923 @@ public:
 		Assert::IsTrue(error < 0.01);
 	}
 
+	TEST_METHOD(plateFromImage_InvalidInput)
+	{
+		PlateResult result;
+
+		result = plateFromImage(cv::Mat());
+		Assert::IsTrue(result.plate == "N/A");
+		Assert::IsTrue(result.annotated.empty());
+		Assert::IsFalse(result.dateTime.empty());
+
+		result = plateFromImage(cv::Mat::zeros(100, 100, CV_16FC1));
+		Assert::IsTrue(result.plate == "N/A");
+
+		result = plateFromImage(std::vector<uchar>{ 1, 2, 3 });
+		Assert::IsTrue(result.plate == "N/A");
+	}
+
+	TEST_METHOD(plateFromImage_ValidInput)
+	{
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+
+		PlateResult result = plateFromImage(src);
+		Assert::IsTrue(result.plate == "CT36NLA");
+		Assert::IsTrue(result.confidence > 0);
+		Assert::IsTrue(result.annotated.size() == src.size());
+		Assert::IsTrue((result.roi & cv::Rect(0, 0, src.cols, src.rows)) == result.roi && !result.roi.empty());
+
+		std::vector<uchar> buffer;
+		cv::imencode(".jpg", src, buffer);
+		Assert::IsFalse(plateFromImage(buffer).plate.empty());
+
+		std::string path = absolutePath("annotated.jpg");
+		Assert::IsTrue(saveImage(result.annotated, path).get());
+		Assert::IsTrue(cv::imread(path).size() == src.size());
+		std::filesystem::remove(path);
+	}
+
+	TEST_METHOD(ImageDecoder_InvalidInput)
+	{
+		std::vector<uchar> buffer;
+		cv::Mat dst;
+
+		Assert::IsFalse(ImageDecoder::readFile(absolutePath("missing.jpg"), buffer));
+		Assert::IsTrue(buffer.empty());
+
+		Assert::IsTrue(ImageDecoder::encodedSize(buffer).empty());
+		Assert::IsTrue(ImageDecoder::encodedSize(std::vector<uchar>{ 0xFF, 0xD8, 0xFF }).empty());
+		Assert::IsTrue(ImageDecoder::encodedSize(std::vector<uchar>{ 1, 2, 3 }).empty());
+
+		Assert::IsTrue(ImageDecoder::reductionFor(cv::Size(), 0) == 1);
+
+		Assert::IsFalse(ImageDecoder::decode(buffer, dst, 2));
+		Assert::IsFalse(ImageDecoder::decode(std::vector<uchar>{ 1, 2, 3 }, dst, 2));
+		Assert::IsTrue(dst.empty());
+	}
+
+	TEST_METHOD(ImageDecoder_ValidInput)
+	{
+		std::vector<uchar> buffer;
+		cv::Mat src, dst;
+
+		Assert::IsTrue(ImageDecoder::readFile(absolutePath("10_d1.jpg"), buffer));
+		src = cv::imdecode(buffer, cv::IMREAD_COLOR);
+		Assert::IsTrue(ImageDecoder::encodedSize(buffer) == src.size());
+
+		Assert::IsTrue(ImageDecoder::reductionFor(src.size(), 1080) == 4);
+		Assert::IsTrue(ImageDecoder::reductionFor(cv::Size(512, 512), 1080) == 1);
+		Assert::IsTrue(ImageDecoder::reductionFor(cv::Size(20000, 100), 1080) == 8);
+
+		for (int reduction : { 1, 2, 4, 8 })
+		{
+			Assert::IsTrue(ImageDecoder::decode(buffer, dst, reduction));
+			Assert::IsTrue(dst.type() == CV_8UC3);
+			Assert::IsTrue(std::abs(dst.cols - src.cols / reduction) <= 1 && std::abs(dst.rows - src.rows / reduction) <= 1);
+		}
+
+		Assert::IsTrue(ImageDecoder::decode(buffer, dst, 2, true));
+		Assert::IsTrue(dst.type() == CV_8UC1);
+
+		cv::imencode(".png", src(cv::Rect(0, 0, 300, 200)), buffer);
+		Assert::IsTrue(ImageDecoder::encodedSize(buffer) == cv::Size(300, 200));
+		Assert::IsTrue(ImageDecoder::decode(buffer, dst, 2) && dst.size() == cv::Size(150, 100));
+	}
+
+	TEST_METHOD(ImageDecoder_ReducedDecodeSavings)
+	{
+		const int iterations = 5;
+		std::vector<std::string> imagePaths = { absolutePath("10_d1.jpg"), absolutePath("../../../documentation/licenta/images/input.jpg"), absolutePath("lenna.jpg") };
+
+		CountingAllocator allocator;
+		cv::MatAllocator* defaultAllocator = cv::Mat::getDefaultAllocator();
+		cv::Mat::setDefaultAllocator(&allocator);
+
+		// The full decode is measured as the pipeline used it: the whole image decoded and then halved.
+		auto measure = [&](const std::vector<uchar>& buffer, const bool& reduced, double& megabytes, cv::Size& size)
+			{
+				allocator.bytes = 0;
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < iterations; i++)
+				{
+					cv::Mat full, halved;
+					if (reduced)
+						Assert::IsTrue(ImageDecoder::decode(buffer, halved, 2));
+					else
+					{
+						Assert::IsTrue(ImageDecoder::decode(buffer, full, 1));
+						cv::resize(full, halved, cv::Size(full.cols / 2, full.rows / 2));
+					}
+					size = halved.size();
+				}
+				auto end = std::chrono::steady_clock::now();
+				megabytes = allocator.bytes / (1024.0 * 1024.0) / iterations;
+				return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+			};
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2);
+
+		for (const std::string& imagePath : imagePaths)
+		{
+			std::vector<uchar> buffer;
+			Assert::IsTrue(ImageDecoder::readFile(imagePath, buffer));
+
+			double fullMegabytes, reducedMegabytes;
+			cv::Size fullSize, reducedSize;
+			double full = measure(buffer, false, fullMegabytes, fullSize);
+			double reduced = measure(buffer, true, reducedMegabytes, reducedSize);
+
+			Assert::IsTrue(std::abs(fullSize.width - reducedSize.width) <= 1 && std::abs(fullSize.height - reducedSize.height) <= 1);
+			Assert::IsTrue(reducedMegabytes * 4 < fullMegabytes);
+
+			stream << std::filesystem::path(imagePath).filename().string() << " (" << ImageDecoder::encodedSize(buffer) << "): "
+				<< full << " ms and " << fullMegabytes << " MB decoded and halved, "
+				<< reduced << " ms and " << reducedMegabytes << " MB decoded at half resolution" << std::endl;
+		}
+
+		cv::Mat::setDefaultAllocator(defaultAllocator);
+
+		Logger::WriteMessage(stream.str().c_str());
+	}
+
+	TEST_METHOD(PlateRecognizer_ReducedDecode)
+	{
+		std::vector<uchar> buffer;
+		Assert::IsTrue(ImageDecoder::readFile(absolutePath("10_d1.jpg"), buffer));
+		cv::Size size = ImageDecoder::encodedSize(buffer);
+
+		PlateRecognizer recognizer;
+		PlateResult result = recognizer.recognize(buffer);
+		Assert::IsTrue(result.plate == "CT36NLA");
+		Assert::IsTrue(std::abs(result.annotated.cols - size.width / 2) <= 1 && std::abs(result.annotated.rows - size.height / 2) <= 1);
+		Assert::IsTrue((result.roi & cv::Rect(0, 0, result.annotated.cols, result.annotated.rows)) == result.roi && !result.roi.empty());
+
+		// The decoded frame is halved by the decoder instead of the pipeline, so the candidates are the same.
+		PlateResult decoded = recognizer.recognize(cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR));
+		Assert::IsTrue(decoded.plate == result.plate);
+		Assert::IsTrue(std::abs(decoded.roi.x / 2 - result.roi.x) <= 2 && std::abs(decoded.roi.width / 2 - result.roi.width) <= 2);
+
+		// A stored image is decoded fully, and is then recognized and annotated exactly like the decoded frame.
+		PlateResult full = recognizer.recognize(buffer, true);
+		Assert::IsTrue(full.annotated.size() == size);
+		Assert::IsTrue(full.plate == decoded.plate && full.roi == decoded.roi);
+	}
+
+	TEST_METHOD(PlateRecognizer_ThreadBudget)
+	{
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		PlateRecognizer recognizer;
+
+		setThreadBudget(0);
+		PlateResult expected = recognizer.recognize(src);
+		Assert::IsTrue(expected.plate == "CT36NLA");
+
+		// The lowest ranked candidate that is read wins whatever the number of candidates evaluated at once.
+		for (int threads : { 1, 2, 3 })
+		{
+			setThreadBudget(threads);
+			Assert::IsTrue(getThreadBudget() == threads);
+
+			PlateResult result = recognizer.recognize(src);
+			Assert::IsTrue(result.plate == expected.plate && result.roi == expected.roi);
+		}
+
+		setThreadBudget(0);
+		Assert::IsTrue(getThreadBudget() >= 1);
+	}
+
+	TEST_METHOD(PlateRecognizer_Allocations)
+	{
+		const int frames = 5;
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+
+		CountingAllocator allocator;
+		cv::MatAllocator* defaultAllocator = cv::Mat::getDefaultAllocator();
+		cv::Mat::setDefaultAllocator(&allocator);
+
+		auto measure = [&](PlateRecognizer* recognizer, double& allocations)
+			{
+				allocator.allocations = 0;
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < frames; i++)
+				{
+					PlateRecognizer freshRecognizer;
+					PlateResult result = (recognizer ? *recognizer : freshRecognizer).recognize(src);
+					Assert::IsTrue(result.plate == "CT36NLA");
+				}
+				auto end = std::chrono::steady_clock::now();
+				allocations = static_cast<double>(allocator.allocations) / frames;
+				return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+			};
+
+		double freshAllocations, steadyAllocations;
+		double before = measure(nullptr, freshAllocations);
+
+		PlateRecognizer recognizer;
+		recognizer.recognize(src);
+		recognizer.recognize(src);
+		double after = measure(&recognizer, steadyAllocations);
+
+		// The candidates are straightened again without the OCR, whose allocations belong to Tesseract.
+		PlateRecognizer rectifier;
+		auto rectify = [&]()
+			{
+				Assert::IsTrue(rectifier.propose(src));
+				for (int i = 0; i < rectifier.candidateCount; i++)
+					PlateRecognizer::rectifyCandidate(rectifier.candidates[i], rectifier.cropped, rectifier.gauss, []() { return false; }, rectifier.profile);
+				return rectifier.candidateCount;
+			};
+
+		// A std::vector that keeps its data pointer was not reallocated. The flat vectors and the images owned by the candidates are compared this way,
+		// because an operator new replaced in the tests would not see the allocations made by the library.
+		auto snapshot = [&]()
+			{
+				std::vector<const void*> buffers;
+				for (int i = 0; i < rectifier.candidateCount; i++)
+				{
+					const PlateRecognizer::Candidate& candidate = rectifier.candidates[i];
+					const AlgorithmBuffers& scratch = candidate.buffers;
+
+					for (const cv::Mat* image : { &candidate.hsv, &candidate.bgr, &candidate.gray, &candidate.connectedComponent, &candidate.edges, &candidate.regionContour,
+						&candidate.resized, &candidate.transformed, &candidate.text, &candidate.denoised, &candidate.spaced,
+						&scratch.sobelX, &scratch.sobelY, &scratch.magnitude, &scratch.sobel, &scratch.direction, &scratch.eroded, &scratch.gradient, &scratch.binary,
+						&scratch.floatSrc, &scratch.hist, &scratch.cumulativeHist, &scratch.thresholded, &scratch.otsu, &scratch.dilatedEdges, &scratch.bordered,
+						&scratch.contoursRegion, &scratch.labels, &scratch.stats, &scratch.centroids })
+						buffers.push_back(image->data);
+
+					buffers.insert(buffers.end(), { candidate.largestContour.data(), candidate.quadrilateralCoordinates.data(), candidate.chars.data(), candidate.paddedChars.data(),
+						scratch.areas.data(), scratch.heights.data(), scratch.hull.data(), scratch.approximation.data(),
+						scratch.corners.data(), scratch.contourPoints.data(), scratch.sidePoints.data() });
+				}
+				return buffers;
+			};
+
+		rectify();
+		rectify();
+		std::vector<const void*> warmBuffers = snapshot();
+
+		int candidates = 0;
+		allocator.allocations = 0;
+		for (int i = 0; i < frames; i++)
+			candidates += rectify();
+		double rectifyAllocations = static_cast<double>(allocator.allocations) / frames;
+		double candidatesPerFrame = static_cast<double>(candidates) / frames;
+
+		cv::Mat::setDefaultAllocator(defaultAllocator);
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2) << "plate recognition per frame: " << freshAllocations << " image allocations and " << before << " ms with a new recognizer, "
+			<< steadyAllocations << " image allocations and " << after << " ms with a reused recognizer, "
+			<< rectifyAllocations << " image allocations for " << candidatesPerFrame << " straightened candidates" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(steadyAllocations < freshAllocations);
+
+		// What is left are the temporaries of OpenCV itself, such as the copy findContours makes of its input and the perspective matrix.
+		Assert::IsTrue(candidatesPerFrame > 0);
+		Assert::IsTrue(rectifyAllocations <= 8 + 24 * candidatesPerFrame);
+		Assert::IsTrue(snapshot() == warmBuffers);
+	}
+
+	TEST_METHOD(StageProfiler_Statistics)
+	{
+		StageProfiler& profiler = StageProfiler::getInstance();
+		profiler.reset();
+
+		{
+			ScopedStageTimer timer(PipelineStage::Denoise);
+		}
+		{
+			ScopedStageTimer timer(PipelineStage::Denoise);
+			Assert::IsFalse(timer.reject());
+		}
+
+		profiler.setEnabled(false);
+		{
+			ScopedStageTimer timer(PipelineStage::Denoise);
+		}
+		profiler.setEnabled(true);
+
+		StageStatistics denoise = profiler.statistics()[static_cast<size_t>(PipelineStage::Denoise)];
+		Assert::IsTrue(denoise.stage == "denoise");
+		Assert::IsTrue(denoise.reached == 2 && denoise.rejected == 1 && denoise.samples == 2);
+		Assert::IsTrue(denoise.p50 <= denoise.p95 && denoise.p95 <= denoise.p99);
+
+		for (size_t i = 0; i < StageProfiler::windowSize + 10; i++)
+			profiler.record(PipelineStage::ReadText, std::chrono::milliseconds(i < 10 ? 1000 : 1), false);
+
+		StageStatistics readText = profiler.statistics()[static_cast<size_t>(PipelineStage::ReadText)];
+		Assert::IsTrue(readText.samples == StageProfiler::windowSize);
+		Assert::IsTrue(readText.p99 == 1);
+
+		profiler.reset();
+		Assert::IsTrue(profiler.statistics()[static_cast<size_t>(PipelineStage::ReadText)].reached == 0);
+	}
+
+	TEST_METHOD(StageProfiler_Pipeline)
+	{
+		StageProfiler& profiler = StageProfiler::getInstance();
+		profiler.reset();
+
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		PlateRecognizer recognizer;
+		Assert::IsTrue(recognizer.recognize(src).plate == "CT36NLA");
+
+		std::vector<StageStatistics> stages = profiler.statistics();
+		Assert::IsTrue(stages[static_cast<size_t>(PipelineStage::Total)].reached == 1);
+		Assert::IsTrue(stages[static_cast<size_t>(PipelineStage::ReadText)].reached >= 1);
+
+		// A candidate only reaches a stage if no earlier stage rejected it.
+		for (int i = static_cast<int>(PipelineStage::ColourConversion); i < static_cast<int>(PipelineStage::ReadText); i++)
+			Assert::IsTrue(stages[i + 1].reached <= stages[i].reached - stages[i].rejected);
+
+		std::string json = profiler.toJson();
+		Logger::WriteMessage((json + "\n").c_str());
+
+		for (const StageStatistics& stage : stages)
+			Assert::IsTrue(json.find("\"stage\":\"" + stage.stage + "\"") != std::string::npos);
+	}
+
+	TEST_METHOD(PlateRecognizer_CandidateScoring)
+	{
+		std::vector<cv::Mat> frames = { cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR),
+			cv::imread(absolutePath("../../../documentation/licenta/images/input.jpg"), cv::IMREAD_COLOR) };
+
+		StageProfiler& profiler = StageProfiler::getInstance();
+		std::array<size_t, 2> rectified, read;
+
+		for (int scoring = 0; scoring < 2; scoring++)
+		{
+			PlateRecognizer recognizer;
+			recognizer.setCandidateScoring(scoring);
+
+			profiler.reset();
+			Assert::IsTrue(recognizer.recognize(frames[0]).plate == "CT36NLA");
+			recognizer.recognize(frames[1]);
+
+			std::vector<StageStatistics> stages = profiler.statistics();
+			rectified[scoring] = stages[static_cast<size_t>(PipelineStage::ColourConversion)].reached;
+			read[scoring] = stages[static_cast<size_t>(PipelineStage::ReadText)].reached;
+		}
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2) << "candidates per frame, by area: " << static_cast<double>(rectified[0]) / frames.size()
+			<< " rectified, " << static_cast<double>(read[0]) / frames.size() << " read; scored: " << static_cast<double>(rectified[1]) / frames.size()
+			<< " rectified, " << static_cast<double>(read[1]) / frames.size() << " read" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(rectified[1] <= rectified[0]);
+	}
+
+	TEST_METHOD(PlateRecognizer_ThresholdProfiles)
+	{
+		static_assert(DistantProfile::minPlateArea < DefaultProfile::minPlateArea && DefaultProfile::minPlateArea < CloseProfile::minPlateArea,
+			"The profiles are ordered by the size of the plates");
+		static_assert(DistantProfile::charPadding == DefaultProfile::charPadding, "A profile only overrides the thresholds that differ");
+
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+
+		PlateRecognizer recognizer;
+		Assert::IsTrue(recognizer.recognize(src).plate == "CT36NLA");
+
+		// The plate covers about 5.5% of the searched region, which is more than a distant camera expects.
+		recognizer.setProfile(ThresholdProfile::Distant);
+		Assert::IsTrue(recognizer.recognize(src).plate != "CT36NLA");
+
+		recognizer.setProfile(ThresholdProfile::Default);
+		Assert::IsTrue(recognizer.recognize(src).plate == "CT36NLA");
+	}
+
+	TEST_METHOD(DumpVisualization_WritesImages)
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "lpr_dump_test";
+		std::filesystem::remove_all(directory);
+
+		std::vector<cv::Vec4i> sortedLines;
+		std::vector<cv::Vec4i> lines = { cv::Vec4i(0, 0, 100, 0), cv::Vec4i(0, 100, 100, 100), cv::Vec4i(0, 0, 0, 100), cv::Vec4i(100, 0, 100, 100) };
+		cv::Mat src = cv::Mat::zeros(101, 101, CV_8UC1);
+
+		Algorithm::lineSorting<DumpVisualization>(sortedLines, lines, src.size(), src);
+		Assert::IsTrue(!std::filesystem::exists(directory));
+
+		DumpVisualization::setDirectory(directory.string());
+		sortedLines.clear();
+		Algorithm::lineSorting<DumpVisualization>(sortedLines, lines, src.size(), src);
+
+		sortedLines.clear();
+		Algorithm::lineSorting<NoVisualization>(sortedLines, lines, src.size(), src);
+		DumpVisualization::setDirectory("");
+
+		size_t images = std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator());
+		Assert::IsTrue(images == 3);
+
+		std::filesystem::remove_all(directory);
+	}
+
+	TEST_METHOD(textFromImages_MatchesSingleImages)
+	{
+		std::vector<std::string> imagePaths = { absolutePath("10_d1.jpg"), absolutePath("missing.jpg"), absolutePath("lenna.jpg"), absolutePath("connected_component.jpg") };
+		for (int i = 0; i < 4; i++)
+			imagePaths.push_back(imagePaths[i]);
+
+		BatchOptions options;
+		options.queueCapacity = 2;
+		BatchRecognizer recognizer(options);
+
+		BatchReport report;
+		std::vector<PlateResult> results = recognizer.recognize(imagePaths, "", report);
+
+		Assert::IsTrue(results.size() == imagePaths.size() && report.images == imagePaths.size());
+		for (size_t i = 0; i < imagePaths.size(); i++)
+		{
+			std::vector<uchar> buffer;
+			ImageDecoder::readFile(imagePaths[i], buffer);
+
+			PlateResult expected = plateFromImage(buffer);
+			Assert::IsTrue(results[i].plate == expected.plate && results[i].confidence == expected.confidence && results[i].roi == expected.roi);
+			Assert::IsTrue(results[i].annotated.empty());
+		}
+		Assert::IsTrue(results[0].plate == "CT36NLA" && results[1].plate == "N/A");
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2) << "batch of " << report.images << " images: " << report.imagesPerSecond << " images/s";
+		for (const StageUtilization& stage : report.stages)
+		{
+			stream << ", " << stage.stage << " " << stage.utilization * 100 << "%";
+			Assert::IsTrue(stage.workers >= 1 && stage.utilization >= 0 && stage.utilization <= 1.01);
+		}
+		stream << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+	}
+
+	TEST_METHOD(RecognitionPool_InvalidInput)
+	{
+		RecognitionPool pool(0, 0);
+		Assert::IsTrue(pool.getWorkers() == 1 && pool.getCapacity() == 1);
+
+		std::future<PlateResult> future;
+		Assert::IsTrue(pool.submit(std::vector<uchar>(), future));
+
+		PlateResult result = future.get();
+		Assert::IsTrue(result.plate == "N/A" && result.roi.empty() && result.annotated.empty());
+	}
+
+	TEST_METHOD(RecognitionPool_ValidInput)
+	{
+		std::vector<uchar> buffer;
+		Assert::IsTrue(ImageDecoder::readFile(absolutePath("10_d1.jpg"), buffer));
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+
+		RecognitionPool pool(2, 4);
+		Assert::IsTrue(pool.isLoaded());
+
+		std::future<PlateResult> future;
+		Assert::IsTrue(pool.submit(buffer, future));
+
+		PlateResult result = future.get();
+		Assert::IsTrue(result.plate == "CT36NLA");
+		Assert::IsTrue((result.roi & cv::Rect(0, 0, src.cols, src.rows)) == result.roi && !result.roi.empty());
+
+		// The region is in the coordinates of the uploaded image, as for a recognition at full resolution.
+		PlateResult expected = plateFromImage(src);
+		Assert::IsTrue(std::abs(expected.roi.x - result.roi.x) <= 4 && std::abs(expected.roi.width - result.roi.width) <= 4);
+
+		// A burst larger than the queue is partly rejected at once instead of waiting.
+		std::vector<std::future<PlateResult>> futures;
+		int rejected = 0;
+		for (int i = 0; i < 20; i++)
+		{
+			std::future<PlateResult> burstFuture;
+			if (pool.submit(buffer, burstFuture))
+				futures.push_back(std::move(burstFuture));
+			else
+				rejected++;
+		}
+		Assert::IsTrue(rejected > 0 && futures.size() <= static_cast<size_t>(pool.getCapacity() + pool.getWorkers()));
+
+		for (auto& burstFuture : futures)
+			Assert::IsTrue(burstFuture.get().plate == "CT36NLA");
+
+		WorkerPoolStatistics statistics = pool.getStatistics();
+		Assert::IsTrue(statistics.accepted == futures.size() + 1 && statistics.rejected == static_cast<size_t>(rejected) && statistics.completed == statistics.accepted);
+	}
+
+	TEST_METHOD(RecognitionPool_LoadTest)
+	{
+		std::vector<uchar> buffer;
+		Assert::IsTrue(ImageDecoder::readFile(absolutePath("10_d1.jpg"), buffer));
+
+		const int workers = std::max(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1);
+		const int clients = workers * 4;
+		const auto duration = std::chrono::seconds(10);
+
+		// The baseline is a single client recognizing its images itself, as a gate computer does.
+		const int iterations = 5;
+		plateFromImage(buffer);
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+			Assert::IsTrue(plateFromImage(buffer).plate == "CT36NLA");
+		double sequential = iterations / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// More clients than workers keep the queue full, and the rejected clients retry after a short pause, as told by the server.
+		RecognitionPool pool(workers, workers * 2);
+		std::atomic<int> completed(0);
+		std::atomic<int> misread(0);
+		std::atomic<long long> latency(0);
+
+		start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (int i = 0; i < clients; i++)
+			threads.emplace_back([&]()
+				{
+					while (std::chrono::steady_clock::now() - start < duration)
+					{
+						auto submitted = std::chrono::steady_clock::now();
+
+						std::future<PlateResult> future;
+						if (!pool.submit(buffer, future))
+						{
+							std::this_thread::sleep_for(std::chrono::milliseconds(10));
+							continue;
+						}
+
+						if (future.get().plate != "CT36NLA")
+							misread++;
+
+						latency += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - submitted).count();
+						completed++;
+					}
+				});
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double sustained = completed / elapsed;
+		WorkerPoolStatistics statistics = pool.getStatistics();
+
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2) << "recognition pool with " << workers << " workers and " << clients << " clients: "
+			<< sustained << " requests/s sustained over " << elapsed << " s, " << latency / 1000.0 / std::max(completed.load(), 1) << " ms average latency, "
+			<< statistics.rejected << " rejections, " << sequential << " requests/s for a single client" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(!misread && completed > 0);
+		Assert::IsTrue(statistics.rejected > 0);
+		Assert::IsTrue(statistics.accepted == statistics.completed);
+		Assert::IsTrue(workers == 1 || sustained > sequential);
+	}
+
+	TEST_METHOD(SpatialPrior_InvalidInput)
+	{
+		SpatialPrior prior;
+		cv::Rect hotspot;
+
+		Assert::IsFalse(prior.hotspot(cv::Size(), hotspot));
+		Assert::IsFalse(prior.hotspot(cv::Size(200, 100), hotspot));
+
+		prior.update(cv::Rect(), cv::Size(200, 100));
+		prior.update(cv::Rect(10, 10, 20, 10), cv::Size());
+		prior.update(cv::Rect(300, 300, 20, 10), cv::Size(200, 100));
+		Assert::IsTrue(cv::countNonZero(prior.getHeatmap()) == 0);
+
+		// The hotspot is not trusted before the warm-up detections.
+		for (int i = 0; i < SpatialPriorOptions().warmUpDetections - 1; i++)
+			prior.update(cv::Rect(10, 10, 20, 10), cv::Size(200, 100));
+		Assert::IsFalse(prior.hotspot(cv::Size(200, 100), hotspot));
+
+		SpatialPriorStatistics statistics = prior.getStatistics();
+		Assert::IsTrue(statistics.frames == 0 && statistics.hitRate == 0 && statistics.searchedFraction == 0);
+	}
+
+	TEST_METHOD(SpatialPrior_ValidInput)
+	{
+		const cv::Size region(640, 320);
+		const cv::Rect roi(100, 120, 120, 40);
+
+		SpatialPrior prior;
+		for (int i = 0; i < SpatialPriorOptions().warmUpDetections; i++)
+			prior.update(roi, region);
+
+		cv::Rect hotspot;
+		Assert::IsTrue(prior.hotspot(region, hotspot));
+		Assert::IsTrue((hotspot & roi) == roi);
+		Assert::IsTrue(hotspot.area() <= region.area() / 2);
+
+		// Plates spread over the whole region leave no hotspot worth searching first.
+		SpatialPrior spread;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				spread.update(cv::Rect(i * region.width / 4, j * region.height / 4, 40, 20), region);
+		Assert::IsFalse(spread.hotspot(region, hotspot));
+
+		prior.record(true, true, region.area() / 4, region.area());
+		prior.record(true, false, region.area() * 5 / 4, region.area());
+		prior.record(false, false, region.area(), region.area());
+
+		SpatialPriorStatistics statistics = prior.getStatistics();
+		Assert::IsTrue(statistics.frames == 3 && statistics.hits == 1 && statistics.misses == 1);
+		Assert::IsTrue(statistics.hitRate == 0.5 && statistics.missRate == 0.5);
+		Assert::IsTrue(std::abs(statistics.searchedFraction - 2.5 / 3) < 1e-6);
+
+		prior.reset();
+		Assert::IsFalse(prior.hotspot(region, hotspot));
+		Assert::IsTrue(prior.getStatistics().frames == 0 && cv::countNonZero(prior.getHeatmap()) == 0);
+	}
+
+	TEST_METHOD(PlateRecognizer_SpatialPrior)
+	{
+		std::vector<uchar> buffer;
+		Assert::IsTrue(ImageDecoder::readFile(absolutePath("10_d1.jpg"), buffer));
+
+		PlateResult expected = plateFromImage(buffer);
+		Assert::IsTrue(expected.plate == "CT36NLA");
+
+		// The frames after the warm-up are searched in the hotspot first, and the plate is found there in the same place.
+		const int frames = SpatialPriorOptions().warmUpDetections + 5;
+		SpatialPrior prior;
+		for (int i = 0; i < frames; i++)
+		{
+			PlateResult result = plateFromImage(buffer, prior);
+			Assert::IsTrue(result.plate == expected.plate);
+			Assert::IsTrue(result.roi == expected.roi);
+		}
+
+		SpatialPriorStatistics statistics = prior.getStatistics();
+		Assert::IsTrue(statistics.frames == static_cast<size_t>(frames) && statistics.hits == 5 && statistics.misses == 0);
+		Assert::IsTrue(statistics.searchedFraction < 1);
+
+		// A plate outside the hotspot is still read, in the whole region.
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		cv::Mat shifted;
+		cv::hconcat(src(cv::Rect(src.cols / 2, 0, src.cols - src.cols / 2, src.rows)), src(cv::Rect(0, 0, src.cols / 2, src.rows)), shifted);
+
+		std::vector<uchar> shiftedBuffer;
+		cv::imencode(".jpg", shifted, shiftedBuffer);
+		Assert::IsTrue(plateFromImage(shiftedBuffer, prior).plate == expected.plate);
+		Assert::IsTrue(prior.getStatistics().misses == 1);
+
+		statistics = prior.getStatistics();
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(2) << "spatial prior over " << statistics.frames << " frames: " << statistics.hitRate * 100 << "% hits, "
+			<< statistics.missRate * 100 << "% misses, " << statistics.searchedFraction * 100 << "% of the region searched per frame" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		// The prior is not kept by the recognizer of the thread once the call returns.
+		Assert::IsTrue(plateFromImage(buffer).plate == expected.plate);
+		Assert::IsTrue(prior.getStatistics().frames == statistics.frames);
+	}
+
+	TEST_METHOD(CameraCalibration_InvalidInput)
+	{
+		CameraCalibration calibration;
+		Assert::IsFalse(calibration.isLoaded());
+		Assert::IsFalse(calibration.load(absolutePath("missing.yml")));
+		Assert::IsFalse(calibration.load(absolutePath("10_d1.jpg")));
+
+		cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << 1000, 0, 500, 0, 1000, 400, 0, 0, 1);
+		Assert::IsFalse(calibration.create("gate", cv::Size(), cameraMatrix, cv::Mat(), cv::Vec3d()));
+		Assert::IsFalse(calibration.create("gate", cv::Size(1000, 800), cv::Mat(), cv::Mat(), cv::Vec3d()));
+		Assert::IsFalse(calibration.create("gate", cv::Size(1000, 800), cameraMatrix, cv::Mat::zeros(1, 3, CV_64F), cv::Vec3d()));
+		Assert::IsFalse(calibration.isLoaded());
+
+		cv::Mat frame(400, 500, CV_8UC3, cv::Scalar(0, 0, 255)), normalized;
+		Assert::IsFalse(calibration.normalize(frame, normalized));
+		Assert::IsTrue(calibration.toSource(cv::Rect(10, 20, 30, 40)) == cv::Rect(10, 20, 30, 40));
+
+		PlateBounds bounds;
+		Assert::IsFalse(calibration.getPlateBounds(bounds));
+		Assert::IsFalse(calibration.setPlateBounds(PlateBounds{ 0.2f, 0.1f, 0.2f, 0.9f }));
+		Assert::IsFalse(calibration.setPlateBounds(PlateBounds{ 0.01f, 1.5f, 0.2f, 0.9f }));
+		Assert::IsFalse(calibration.setPlateBounds(PlateBounds{ 0.01f, 0.15f, 0.9f, 0.2f }));
+
+		// A frame of another camera is left as it is.
+		Assert::IsTrue(calibration.create("gate", cv::Size(1000, 800), cameraMatrix, cv::Mat(), cv::Vec3d()));
+		Assert::IsFalse(calibration.normalize(cv::Mat(200, 250, CV_8UC3), normalized));
+		Assert::IsFalse(calibration.normalize(cv::Mat(400, 500, CV_8UC1), normalized));
+
+		std::map<std::string, CameraCalibration> calibrations;
+		Assert::IsFalse(loadCalibrations(absolutePath("missing"), calibrations));
+		Assert::IsTrue(calibrations.empty());
+	}
+
+	TEST_METHOD(CameraCalibration_ValidInput)
+	{
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		cv::Mat halved;
+		cv::resize(src, halved, cv::Size(src.cols / 2, src.rows / 2));
+
+		// Without distortion nor mounting angles, the normalized frame is the frame itself.
+		cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << src.cols, 0, src.cols / 2.0, 0, src.cols, src.rows / 2.0, 0, 0, 1);
+		CameraCalibration calibration;
+		Assert::IsTrue(calibration.create("gate", src.size(), cameraMatrix, cv::Mat(), cv::Vec3d()));
+		Assert::IsTrue(calibration.isLoaded() && calibration.getName() == "gate");
+
+		cv::Mat normalized;
+		Assert::IsTrue(calibration.normalize(halved, normalized));
+		Assert::IsTrue(normalized.size() == halved.size());
+		Assert::IsTrue(cv::norm(normalized, halved, cv::NORM_L1) / normalized.total() < 3);
+
+		cv::Rect roi(100, 200, 300, 100);
+		cv::Rect source = calibration.toSource(roi);
+		Assert::IsTrue(std::abs(source.x - roi.x) <= 1 && std::abs(source.y - roi.y) <= 1 && std::abs(source.width - roi.width) <= 1 && std::abs(source.height - roi.height) <= 1);
+
+		// A strong barrel distortion bends the top edge of a wide region beyond its corners in the source frame.
+		// The region is normalized from a frame that is black only inside its source, so none of its pixels may be lit.
+		cv::Mat distortion = (cv::Mat_<double>(1, 5) << -0.3, 0, 0, 0, 0);
+		CameraCalibration distorted;
+		Assert::IsTrue(distorted.create("gate", src.size(), cameraMatrix, distortion, cv::Vec3d()));
+
+		cv::Rect wide(halved.cols / 8, halved.rows / 8, halved.cols * 3 / 4, halved.rows / 4);
+		cv::Rect wideSource = distorted.toSource(wide);
+
+		// The interpolation also reads the pixel after the integer part of every source.
+		cv::Mat frame(halved.size(), CV_8UC3, cv::Scalar::all(255));
+		frame(cv::Rect(wideSource.x, wideSource.y, wideSource.width + 1, wideSource.height + 1) & cv::Rect(0, 0, frame.cols, frame.rows)).setTo(0);
+		Assert::IsTrue(distorted.normalize(frame, normalized));
+
+		cv::Mat lit;
+		cv::cvtColor(normalized(wide), lit, cv::COLOR_BGR2GRAY);
+		Assert::IsTrue(cv::countNonZero(lit) == 0);
+
+		// The profiles of a directory are loaded by camera.
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "lpr_calibration_test";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+
+		{
+			cv::FileStorage storage((directory / "entrance.yml").string(), cv::FileStorage::WRITE);
+			storage << "name" << "gate" << "image_width" << src.cols << "image_height" << src.rows;
+			storage << "camera_matrix" << cameraMatrix << "distortion_coefficients" << cv::Mat::zeros(1, 5, CV_64F);
+			storage << "mounting_angles" << std::vector<double>{ 3, 0, 6 };
+			storage << "plate_bounds" << "{" << "min_area" << 0.02 << "max_area" << 0.1 << "min_height" << 0.3 << "max_height" << 0.8 << "}";
+		}
+		{
+			cv::FileStorage storage((directory / "exit.yml").string(), cv::FileStorage::WRITE);
+			storage << "image_width" << src.cols << "image_height" << src.rows << "camera_matrix" << cameraMatrix;
+		}
+		std::ofstream(directory / "notes.txt") << "not a profile";
+
+		std::map<std::string, CameraCalibration> calibrations;
+		Assert::IsTrue(loadCalibrations(directory.string(), calibrations));
+		Assert::IsTrue(calibrations.size() == 2 && calibrations.count("gate") && calibrations.count("exit"));
+
+		PlateBounds bounds;
+		Assert::IsTrue(calibrations["gate"].getPlateBounds(bounds));
+		Assert::IsTrue(std::abs(bounds.minArea - 0.02f) < 1e-6 && std::abs(bounds.maxArea - 0.1f) < 1e-6);
+		Assert::IsTrue(std::abs(bounds.minHeight - 0.3f) < 1e-6 && std::abs(bounds.maxHeight - 0.8f) < 1e-6);
+		Assert::IsFalse(calibrations["exit"].getPlateBounds(bounds));
+
+		std::filesystem::remove_all(directory);
+	}
+
+	TEST_METHOD(PlateRecognizer_Calibration)
+	{
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << src.cols, 0, src.cols / 2.0, 0, src.cols, src.rows / 2.0, 0, 0, 1);
+		const cv::Vec3d mountingAngles(3, 0, 6);
+
+		// The frame of a camera mounted with a pitch of 3 degrees and a roll of 6 degrees.
+		cv::Mat pitch, roll;
+		cv::Rodrigues(cv::Vec3d(mountingAngles[0] * CV_PI / 180, 0, 0), pitch);
+		cv::Rodrigues(cv::Vec3d(0, 0, mountingAngles[2] * CV_PI / 180), roll);
+		cv::Mat mounting = cameraMatrix * roll * pitch * cameraMatrix.inv();
+
+		cv::Mat tilted;
+		cv::warpPerspective(src, tilted, mounting, src.size());
+
+		CameraCalibration calibration;
+		Assert::IsTrue(calibration.create("gate", src.size(), cameraMatrix, cv::Mat(), mountingAngles));
+
+		PlateRecognizer recognizer;
+		PlateResult expected = recognizer.recognize(src);
+		Assert::IsTrue(expected.plate == "CT36NLA");
+
+		recognizer.setCalibration(&calibration);
+		PlateResult result = recognizer.recognize(tilted);
+		Assert::IsTrue(result.plate == expected.plate);
+		Assert::IsTrue(result.annotated.size() == tilted.size());
+
+		// The region is returned in the tilted frame, where the plate of the straight frame was moved by the mounting.
+		cv::Point offset(src.cols / 2 * 0.1, src.rows / 2 / 2);
+		std::vector<cv::Point2f> corners = { expected.roi.tl() + offset, cv::Point(expected.roi.br().x, expected.roi.y) + offset,
+			cv::Point(expected.roi.x, expected.roi.br().y) + offset, expected.roi.br() + offset };
+		for (cv::Point2f& corner : corners)
+			corner *= 2;
+		cv::perspectiveTransform(corners, corners, mounting);
+		for (cv::Point2f& corner : corners)
+			corner /= 2;
+		cv::Rect moved = cv::boundingRect(corners) - offset;
+		Assert::IsTrue((moved & result.roi).area() > 0.8 * (moved | result.roi).area());
+
+		// The plate bounds of the profile replace the size thresholds.
+		Assert::IsTrue(calibration.setPlateBounds(PlateBounds{ 0.5f, 0.9f, 0.2f, 0.9f }));
+		Assert::IsTrue(recognizer.recognize(tilted).plate == "N/A");
+
+		// A profile of another resolution does not normalize the frames, so its plate bounds do not apply to them either.
+		cv::Mat otherMatrix = (cv::Mat_<double>(3, 3) << src.cols * 2, 0, src.cols, 0, src.cols * 2, src.rows, 0, 0, 1);
+		CameraCalibration other;
+		Assert::IsTrue(other.create("other", src.size() * 2, otherMatrix, cv::Mat(), cv::Vec3d()));
+		Assert::IsTrue(other.setPlateBounds(PlateBounds{ 0.5f, 0.9f, 0.2f, 0.9f }));
+		recognizer.setCalibration(&other);
+		Assert::IsTrue(recognizer.recognize(src).plate == expected.plate);
+
+		recognizer.setCalibration(nullptr);
+		Assert::IsTrue(recognizer.recognize(src).roi == expected.roi);
+	}
+
+	TEST_METHOD(StreamRecognizer_VotesOnePass)
+	{
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		cv::Mat empty = cv::Mat::zeros(src.size(), src.type());
+
+		// An empty gate, a vehicle slowly moving in front of the camera, some of its frames blurred, and the empty gate again.
+		std::vector<cv::Mat> frames(5, empty);
+		for (int i = 0; i < 12; i++)
+		{
+			cv::Mat shift = (cv::Mat_<double>(2, 3) << 1, 0, i * 4, 0, 1, 0);
+			cv::Mat frame;
+			cv::warpAffine(src, frame, shift, src.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+			if (i % 3)
+				cv::GaussianBlur(frame, frame, cv::Size(9, 9), 0);
+			frames.push_back(frame);
+		}
+		for (int i = 0; i < 20; i++)
+			frames.push_back(empty);
+
+		StreamOptions options;
+		StreamRecognizer recognizer(options);
+
+		int callsBefore = Algorithm::ocrCalls;
+		std::vector<PlateResult> results;
+		for (const cv::Mat& frame : frames)
+		{
+			PlateResult result;
+			if (recognizer.process(frame, result))
+				results.push_back(result);
+		}
+		PlateResult result;
+		if (recognizer.flush(result))
+			results.push_back(result);
+
+		const StreamStatistics& statistics = recognizer.getStatistics();
+
+		std::ostringstream stream;
+		stream << statistics.frames << " frames: " << statistics.idleFrames << " idle, " << statistics.detections << " detections, "
+			<< statistics.trackedFrames << " tracked, " << statistics.ocrFrames << " read, " << Algorithm::ocrCalls - callsBefore << " OCR calls" << std::endl;
+		Logger::WriteMessage(stream.str().c_str());
+
+		Assert::IsTrue(results.size() == 1);
+		Assert::IsTrue(results[0].plate == "CT36NLA");
+		Assert::IsTrue(!results[0].annotated.empty());
+		Assert::IsTrue(statistics.frames == frames.size() && statistics.idleFrames > 0 && statistics.trackedFrames > 0);
+		Assert::IsTrue(statistics.ocrFrames <= options.ocrFrames);
+	}
+
+	TEST_METHOD(StreamRecognizer_RepeatedPasses)
+	{
+		cv::Mat src = cv::imread(absolutePath("10_d1.jpg"), cv::IMREAD_COLOR);
+		cv::Mat empty = cv::Mat::zeros(src.size(), src.type());
+
+		// The same vehicle passes twice in front of the camera, about 30 frames apart.
+		std::vector<cv::Mat> frames(5, empty);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int i = 0; i < 12; i++)
+			{
+				cv::Mat shift = (cv::Mat_<double>(2, 3) << 1, 0, i * 4, 0, 1, 0);
+				cv::Mat frame;
+				cv::warpAffine(src, frame, shift, src.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+				frames.push_back(frame);
+			}
+			for (int i = 0; i < 20; i++)
+				frames.push_back(empty);
+		}
+
+		auto passes = [&](const int& repeatFrames)
+			{
+				StreamOptions options;
+				options.repeatFrames = repeatFrames;
+				StreamRecognizer recognizer(options);
+
+				int count = 0;
+				for (const cv::Mat& frame : frames)
+				{
+					PlateResult result;
+					if (recognizer.process(frame, result))
+					{
+						Assert::IsTrue(result.plate == "CT36NLA");
+						count++;
+					}
+				}
+				return count;
+			};
+
+		Assert::IsTrue(passes(1000) == 1);
+		Assert::IsTrue(passes(10) == 2);
+	}
+
 	TEST_METHOD(textFromImage_InvalidInput)
 	{
 		std::string src, dst;
@@ -79,6 +79,34 @@
 		<source>Vehicles</source>
 		<translation>Vehicles</translation>
 	</message>
+    <message>
+      <source>Camera:</source>
+      <translation>Camera:</translation>
+    </message>
+    <message>
+      <source>Entrance</source>
+      <translation>Entrance</translation>
+    </message>
+    <message>
+      <source>Exit</source>
+      <translation>Exit</translation>
+    </message>
+    <message>
+      <source>Start</source>
+      <translation>Start</translation>
+    </message>
+    <message>
+      <source>Stop</source>
+      <translation>Stop</translation>
+    </message>
+    <message>
+      <source>Stream</source>
+      <translation>Stream</translation>
+    </message>
+    <message>
+      <source>The video source could not be opened.</source>
+      <translation>The video source could not be opened.</translation>
+    </message>
   </context>
 
   <context>
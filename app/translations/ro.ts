@@ -79,6 +79,34 @@
 		<source>Vehicles</source>
 		<translation>Vehicule</translation>
 	</message>
+    <message>
+      <source>Camera:</source>
+      <translation>Cameră:</translation>
+    </message>
+    <message>
+      <source>Entrance</source>
+      <translation>Intrare</translation>
+    </message>
+    <message>
+      <source>Exit</source>
+      <translation>Ieșire</translation>
+    </message>
+    <message>
+      <source>Start</source>
+      <translation>Pornește</translation>
+    </message>
+    <message>
+      <source>Stop</source>
+      <translation>Oprește</translation>
+    </message>
+    <message>
+      <source>Stream</source>
+      <translation>Flux video</translation>
+    </message>
+    <message>
+      <source>The video source could not be opened.</source>
+      <translation>Sursa video nu a putut fi deschisă.</translation>
+    </message>
   </context>
 
   <context>
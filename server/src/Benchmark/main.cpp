@@ -0,0 +1,295 @@
+#include "httplib.h"
+#include "qrdecodingpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Prints the percentiles of the latencies of a list of uploads, in milliseconds.
+	void printLatencies(const std::string& name, std::vector<double> latencies)
+	{
+		if (latencies.empty())
+			return;
+
+		std::sort(latencies.begin(), latencies.end());
+
+		size_t count = latencies.size();
+		std::cout << std::fixed << std::setprecision(2) << name << ": p50 " << latencies[count / 2] << " ms, p99 "
+			<< latencies[std::min(count - 1, count * 99 / 100)] << " ms over " << count << " uploads" << std::endl;
+	}
+
+	// Decodes the same ticket from as many clients as the server has HTTP threads and prints the percentiles of the latency of an upload,
+	// then of the uploads decoded by ZXing directly and of the ones decoded by the rectification, whose latency includes waiting
+	// for the racing direct decoding in the speculative mode.
+	template <typename Decode>
+	void measureUploads(const std::string& name, const std::vector<unsigned char>& ticket, const int& uploads, const int& clients, const Decode& decode)
+	{
+		std::vector<double> latencies(uploads);
+		std::vector<QRDecodePath> paths(uploads, QRDecodePath::None);
+		std::atomic<int> next(0);
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < clients; i++)
+			threads.emplace_back([&]()
+				{
+					for (int upload = next++; upload < uploads; upload = next++)
+					{
+						auto start = std::chrono::steady_clock::now();
+						paths[upload] = decode(ticket);
+						latencies[upload] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+					}
+				});
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		printLatencies(name, latencies);
+
+		for (const auto& [pathName, path] : { std::make_pair(std::string("  decoded by ZXing directly"), QRDecodePath::Direct),
+			std::make_pair(std::string("  decoded by the rectification"), QRDecodePath::Rectified) })
+		{
+			std::vector<double> pathLatencies;
+			for (int upload = 0; upload < uploads; upload++)
+				if (paths[upload] == path)
+					pathLatencies.push_back(latencies[upload]);
+
+			printLatencies(pathName, pathLatencies);
+		}
+	}
+
+	// Compares a QR code decoder built for every upload, which loads the model each time, with the shared decoding service,
+	// first with the rectification tried before plain ZXing and then with both racing, and then with the bounded pool of the server.
+	int benchmarkQR(const std::string& ticketPath, const int& uploads)
+	{
+		std::ifstream file(ticketPath, std::ios::binary);
+		std::vector<unsigned char> ticket((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (ticket.empty())
+		{
+			std::cerr << "Cannot read the ticket image: " << ticketPath << std::endl;
+			return 1;
+		}
+
+		const int clients = static_cast<int>(CPPHTTPLIB_THREAD_POOL_COUNT);
+
+		measureUploads("QRCode per upload", ticket, uploads, clients, [](const std::vector<unsigned char>& src)
+			{
+				std::vector<unsigned char> dst;
+				QRDecodePath decodedPath;
+				QRCode qr;
+				qr.setDecodeMode(QRDecodeMode::Sequential);
+				qr.decodeQR(src, dst, decodedPath);
+				return decodedPath;
+			});
+
+		for (QRDecodeMode mode : { QRDecodeMode::Sequential, QRDecodeMode::Speculative })
+		{
+			QRDecodingService service(clients);
+			if (!service.isLoaded())
+			{
+				std::cerr << "Cannot load the QR code model." << std::endl;
+				return 1;
+			}
+
+			service.setDecodeMode(mode);
+
+			bool speculative = mode == QRDecodeMode::Speculative;
+			measureUploads(speculative ? "Shared decoding service, speculative" : "Shared decoding service, sequential", ticket, uploads, clients,
+				[&service](const std::vector<unsigned char>& src)
+				{
+					std::vector<unsigned char> dst;
+					std::string id;
+					QRDecodePath decodedPath = QRDecodePath::None;
+					service.decodeQR(src, dst, id, decodedPath);
+					return decodedPath;
+				});
+		}
+
+		// The same uploads through the bounded pool of the server, sized as by default, where the rejected uploads are answered at once.
+		int poolWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) / 4, 1);
+		int poolCapacity = poolWorkers * 2;
+		const int qrUploads = std::max(clients / 2, 2);
+		if (poolWorkers + poolCapacity > qrUploads)
+		{
+			poolWorkers = std::min(poolWorkers, qrUploads - 1);
+			poolCapacity = std::min(poolCapacity, qrUploads - poolWorkers);
+		}
+
+		QRDecodingPool pool(poolWorkers, poolCapacity);
+		measureUploads("Bounded decoding pool", ticket, uploads, clients, [&pool](const std::vector<unsigned char>& src)
+			{
+				std::future<QRDecodingResult> result;
+				if (!pool.submit(src, result))
+					return QRDecodePath::None;
+
+				try
+				{
+					return result.get().decodedPath;
+				}
+				catch (...)
+				{
+					return QRDecodePath::None;
+				}
+			});
+
+		WorkerPoolStatistics statistics = pool.getStatistics();
+		std::cout << "  " << statistics.accepted << " accepted, " << statistics.rejected << " rejected, mean wait "
+			<< (statistics.completed ? statistics.totalWaitTime / statistics.completed : 0) << " ms (max " << statistics.maxWaitTime << " ms), mean decoding "
+			<< (statistics.completed ? statistics.totalProcessTime / statistics.completed : 0) << " ms (max " << statistics.maxProcessTime << " ms)" << std::endl;
+
+		return 0;
+	}
+
+	// Checks that the anchors found by a pyramid search are the ones of the full-frame search: every centroid must lie within half
+	// the side of one of the full-frame finder patterns.
+	bool sameAnchors(const std::vector<std::vector<cv::Point>>& anchors, const std::vector<std::vector<cv::Point>>& reference)
+	{
+		for (const std::vector<cv::Point>& anchor : anchors)
+		{
+			cv::Moments moments = cv::moments(anchor);
+			if (moments.m00 == 0)
+				return false;
+
+			cv::Point2d centroid(moments.m10 / moments.m00, moments.m01 / moments.m00);
+			bool matched = std::any_of(reference.begin(), reference.end(), [&centroid](const std::vector<cv::Point>& other)
+				{
+					cv::Moments otherMoments = cv::moments(other);
+					if (otherMoments.m00 == 0)
+						return false;
+
+					cv::Point2d otherCentroid(otherMoments.m10 / otherMoments.m00, otherMoments.m01 / otherMoments.m00);
+					return cv::norm(centroid - otherCentroid) < std::sqrt(otherMoments.m00) / 2;
+				});
+
+			if (!matched)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Searches the finder patterns of every image of a directory on the full frame and from the 2x and 4x pyramid levels, and prints
+	// the latency and the detection rate of each search. Since a pyramid search falls back to the full frame, its detection rate
+	// is at least the one of the full frame, so how often the pyramid alone found the anchors is printed too, with how often
+	// they are the anchors of the full-frame search, differ from them, or cannot be checked because the full-frame search failed.
+	// The images are first scaled so that their longer side has the given size, unless it is 0, since the finder patterns of small
+	// images are only searched on the full frame. The figures of upscaled images are synthetic: upscaling does not add the blur,
+	// noise and perspective of a full-size ticket photo.
+	int benchmarkAnchors(const std::string& directory, const int& size)
+	{
+		std::vector<cv::Mat> images;
+		int upscaled = 0;
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+		{
+			std::string extension = entry.path().extension().string();
+			if (!entry.is_regular_file() || (extension != ".png" && extension != ".jpg" && extension != ".jpeg"))
+				continue;
+
+			cv::Mat image = cv::imread(entry.path().string(), cv::IMREAD_GRAYSCALE);
+			if (image.empty())
+				continue;
+
+			if (size > 0)
+			{
+				double scale = static_cast<double>(size) / std::max(image.cols, image.rows);
+				cv::resize(image, image, cv::Size(), scale, scale, scale > 1 ? cv::INTER_CUBIC : cv::INTER_AREA);
+				upscaled += scale > 1;
+			}
+
+			images.push_back(image);
+		}
+
+		if (images.empty())
+		{
+			std::cerr << "Cannot read the images of: " << directory << std::endl;
+			return 1;
+		}
+
+		if (upscaled > 0)
+			std::cout << upscaled << " of the " << images.size() << " images were upscaled to " << size
+				<< " pixels, so their figures are synthetic and do not stand for full-size ticket photos." << std::endl;
+
+		// The anchors of the full-frame search are the reference of the pyramid searches.
+		std::vector<std::vector<std::vector<cv::Point>>> references(images.size());
+		std::vector<char> referenced(images.size(), false);
+
+		const std::pair<std::string, int> searches[] = { { "Full frame", 0 }, { "2x pyramid", 1 }, { "4x pyramid", 2 } };
+		for (const auto& [name, levels] : searches)
+		{
+			std::vector<double> latencies;
+			int detected = 0, pyramidOnly = 0, matching = 0, mismatched = 0, unverified = 0;
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				std::vector<std::vector<cv::Point>> anchors;
+				bool fromPyramid = false;
+				auto start = std::chrono::steady_clock::now();
+				bool found = QRCode::findAnchors(images[i], anchors, levels, &fromPyramid);
+				latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+				detected += found;
+
+				if (levels == 0)
+				{
+					referenced[i] = found;
+					references[i] = anchors;
+					continue;
+				}
+
+				if (!fromPyramid)
+					continue;
+
+				pyramidOnly++;
+				if (!referenced[i])
+					unverified++;
+				else if (sameAnchors(anchors, references[i]))
+					matching++;
+				else
+					mismatched++;
+			}
+
+			std::sort(latencies.begin(), latencies.end());
+
+			double mean = 0;
+			for (double latency : latencies)
+				mean += latency / latencies.size();
+
+			std::cout << std::fixed << std::setprecision(2) << name << ": " << 100.0 * detected / images.size() << "% detected, mean "
+				<< mean << " ms, p99 " << latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)] << " ms over " << images.size() << " images" << std::endl;
+
+			if (levels > 0)
+				std::cout << "  " << 100.0 * pyramidOnly / images.size() << "% found by the pyramid alone: " << matching << " with the full-frame anchors, "
+					<< mismatched << " with other anchors, " << unverified << " unverified since the full frame found none" << std::endl;
+		}
+
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// "ServerBenchmark --qr <ticket image> [uploads]" measures the latency of the QR code uploads.
+	if (argc >= 3 && std::string(argv[1]) == "--qr")
+		return benchmarkQR(argv[2], argc >= 4 ? std::max(std::atoi(argv[3]), 1) : 200);
+
+	// "ServerBenchmark --anchors <image directory> [size]" compares the finder pattern searches, for instance on documentation/disertatie/dataset.
+	// The images are scaled to the 1080 pixels of the uploaded tickets by default, since the 128 pixel crops of the dataset never reach the pyramid,
+	// which makes their figures synthetic. A directory of full-size ticket photos gives the real ones.
+	if (argc >= 3 && std::string(argv[1]) == "--anchors")
+		return benchmarkAnchors(argv[2], argc >= 4 ? std::max(std::atoi(argv[3]), 0) : 1080);
+
+	std::cerr << "Usage: " << argv[0] << " --qr <ticket image> [uploads]" << std::endl;
+	std::cerr << "       " << argv[0] << " --anchors <image directory> [size]" << std::endl;
+	return 1;
+}
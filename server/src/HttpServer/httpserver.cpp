@@ -1,5 +1,4 @@
 ﻿#include "httpserver.h"
-#include "qrcodedetection.h"
 
 #include <nlohmann/json.hpp>
 
@@ -33,6 +32,72 @@ HttpServer::HttpServer() : logger(Logger::getInstance())
 			}
 		});
 
+	// The plates and the tickets are recognized apart from the HTTP threads, which wait for them, so only a bounded number of uploads
+	// may hold an HTTP thread and the other requests of the API are still answered during a burst of uploads. The workers and the queue
+	// of the plate recognition never hold more than a quarter of the HTTP threads, and the ones of the QR code decoding never more
+	// than half of them, so at least a quarter of the HTTP threads is always left to the rest of the API.
+	const int httpThreads = static_cast<int>(CPPHTTPLIB_THREAD_POOL_COUNT);
+	const int recognitionUploads = std::max(httpThreads / 4, 2);
+	const int qrUploads = std::max(httpThreads / 2, 2);
+
+	// Every recognition worker evaluates the candidates of an image on its own thread only, so half of the cores recognize plates by default,
+	// within the share of the HTTP threads.
+	int recognitionWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1);
+	if (const char* workers = std::getenv("LPR_WORKERS"))
+		recognitionWorkers = std::max(std::atoi(workers), 1);
+
+	int recognitionCapacity = recognitionWorkers * 2;
+	if (const char* capacity = std::getenv("LPR_QUEUE_CAPACITY"))
+		recognitionCapacity = std::max(std::atoi(capacity), 1);
+
+	if (recognitionWorkers + recognitionCapacity > recognitionUploads)
+	{
+		recognitionWorkers = std::min(recognitionWorkers, recognitionUploads - 1);
+		recognitionCapacity = std::min(recognitionCapacity, recognitionUploads - recognitionWorkers);
+
+		LOG_MESSAGE(WARNING) << "The license plate uploads are limited to a quarter of the " << httpThreads << " HTTP threads: "
+			<< recognitionWorkers << " workers and a queue of " << recognitionCapacity << " images." << std::endl;
+	}
+
+	recognitionPool = std::make_unique<RecognitionPool>(recognitionWorkers, recognitionCapacity);
+
+	// The plate recognition is an optional service of the gate computers, so the rest of the API is served even without its traineddata.
+	if (recognitionPool->isLoaded())
+		LOG_MESSAGE(INFO) << "License plate recognition started with " << recognitionPool->getWorkers() << " workers and a queue of "
+			<< recognitionPool->getCapacity() << " images." << std::endl;
+	else
+	{
+		const char* tessdata = std::getenv("TESSDATA_PREFIX");
+		LOG_MESSAGE(CRITICAL) << "DIN1451Mittelschrift.traineddata could not be loaded from TESSDATA_PREFIX (" << (tessdata ? tessdata : "not set")
+			<< "), the license plate recognition is disabled." << std::endl;
+	}
+
+	// Every QR code worker decodes on two threads, so only a quarter of the cores decode tickets by default.
+	int qrWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) / 4, 1);
+	if (const char* workers = std::getenv("QR_WORKERS"))
+		qrWorkers = std::max(std::atoi(workers), 1);
+
+	int qrCapacity = qrWorkers * 2;
+	if (const char* capacity = std::getenv("QR_QUEUE_CAPACITY"))
+		qrCapacity = std::max(std::atoi(capacity), 1);
+
+	if (qrWorkers + qrCapacity > qrUploads)
+	{
+		qrWorkers = std::min(qrWorkers, qrUploads - 1);
+		qrCapacity = std::min(qrCapacity, qrUploads - qrWorkers);
+
+		LOG_MESSAGE(WARNING) << "The QR code uploads are limited to half of the " << httpThreads << " HTTP threads: "
+			<< qrWorkers << " workers and a queue of " << qrCapacity << " tickets." << std::endl;
+	}
+
+	qrDecodingPool = std::make_unique<QRDecodingPool>(qrWorkers, qrCapacity);
+
+	if (qrDecodingPool->isLoaded())
+		LOG_MESSAGE(INFO) << "QR code decoding started with " << qrDecodingPool->getWorkers() << " workers and a queue of "
+			<< qrDecodingPool->getCapacity() << " tickets." << std::endl;
+	else
+		LOG_MESSAGE(CRITICAL) << "The QR code model could not be loaded." << std::endl;
+
 	server.Post("/api/endpoint", [this](const httplib::Request& request, httplib::Response& response) {
 		response.set_header("Access-Control-Allow-Origin", "*");
 		response.set_header("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
@@ -41,6 +106,14 @@ HttpServer::HttpServer() : logger(Logger::getInstance())
 		this->post(request, response);
 		});
 
+	server.Post("/api/recognizePlate", [this](const httplib::Request& request, httplib::Response& response) {
+		response.set_header("Access-Control-Allow-Origin", "*");
+		response.set_header("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
+		response.set_header("Access-Control-Allow-Headers", "Content-Type");
+
+		this->recognizePlate(request, response);
+		});
+
 	server.Post("/api/createAccount", [this](const httplib::Request& request, httplib::Response& response) {
 		response.set_header("Access-Control-Allow-Origin", "*");
 		response.set_header("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
@@ -410,15 +483,44 @@ void HttpServer::post(const httplib::Request& request, httplib::Response& respon
 	}
 	else if (request.has_file("qrCodeImage"))
 	{
+		const auto& data = request.get_file_value("qrCodeImage");
+
+		std::future<QRDecodingResult> futureResult;
+		if (!qrDecodingPool->submit(std::vector<unsigned char>(data.content.begin(), data.content.end()), futureResult))
+		{
+			WorkerPoolStatistics statistics = qrDecodingPool->getStatistics();
+			LOG_MESSAGE(WARNING) << "QR code decoding queue is full, request rejected. Mean wait " << (statistics.completed ? statistics.totalWaitTime / statistics.completed : 0)
+				<< " ms, mean decoding " << (statistics.completed ? statistics.totalProcessTime / statistics.completed : 0) << " ms over "
+				<< statistics.completed << " tickets, " << statistics.rejected << " rejected." << std::endl;
+
+			responseJson = {
+				{"success", false},
+				{"message", "The server is busy. Please retry later."}
+			};
+
+			response.status = 503;
+			response.set_header("Retry-After", "1");
+			response.set_content(responseJson.dump(), "application/json");
+			return;
+		}
+
+		bool decoded;
 		try
 		{
-			auto data = request.get_file_value("qrCodeImage");
-			std::vector<unsigned char> rawImage(data.content.begin(), data.content.end());
+			QRDecodingResult result = futureResult.get();
+
+			LOG_MESSAGE(DEBUG) << "QR code decoded in " << result.decodeTime << " ms after waiting " << result.waitTime << " ms for a worker." << std::endl;
 
-			QRCode qr;
-			id = qr.decodeQR(rawImage, ticketImage);
+			decoded = result.decoded;
+			id = result.id;
+			ticketImage = std::move(result.annotated);
 		}
 		catch (...)
+		{
+			decoded = false;
+		}
+
+		if (!decoded)
 		{
 			responseJson = {
 				{"success", false},
@@ -515,6 +617,115 @@ void HttpServer::post(const httplib::Request& request, httplib::Response& respon
 	}
 }
 
+void HttpServer::recognizePlate(const httplib::Request& request, httplib::Response& response)
+{
+	nlohmann::json responseJson;
+	std::string requestKey;
+
+	if (request.has_param("key"))
+		requestKey = request.get_param_value("key");
+
+	if (request.has_file("key"))
+		requestKey = request.get_file_value("key").content;
+
+	if (requestKey != key)
+	{
+		LOG_MESSAGE(CRITICAL) << "Invalid API key received." << std::endl;
+
+		responseJson = {
+			{"success", false},
+			{"message", "Invalid API key."}
+		};
+
+		response.set_content(responseJson.dump(), "application/json");
+		return;
+	}
+
+	if (!request.has_file("image"))
+	{
+		responseJson = {
+			{"success", false},
+			{"message", "No image was received."}
+		};
+
+		response.set_content(responseJson.dump(), "application/json");
+		return;
+	}
+
+	if (!recognitionPool->isLoaded())
+	{
+		responseJson = {
+			{"success", false},
+			{"message", "The license plate recognition is unavailable."}
+		};
+
+		response.status = 503;
+		response.set_content(responseJson.dump(), "application/json");
+		return;
+	}
+
+	const auto& data = request.get_file_value("image");
+
+	std::future<PlateResult> futureResult;
+	if (!recognitionPool->submit(std::vector<unsigned char>(data.content.begin(), data.content.end()), futureResult))
+	{
+		LOG_MESSAGE(WARNING) << "License plate recognition queue is full, request rejected." << std::endl;
+
+		responseJson = {
+			{"success", false},
+			{"message", "The server is busy. Please retry later."}
+		};
+
+		response.status = 503;
+		response.set_header("Retry-After", "1");
+		response.set_content(responseJson.dump(), "application/json");
+		return;
+	}
+
+	PlateResult result;
+	try
+	{
+		result = futureResult.get();
+	}
+	catch (const std::exception& error)
+	{
+		LOG_MESSAGE(CRITICAL) << "Error while recognizing the license plate: " << error.what() << std::endl;
+
+		responseJson = {
+			{"success", false},
+			{"message", "Internal error while recognizing the license plate."}
+		};
+
+		response.set_content(responseJson.dump(), "application/json");
+		return;
+	}
+
+	if (result.roi.empty())
+	{
+		responseJson = {
+			{"success", false},
+			{"message", "No license plate was found."}
+		};
+
+		response.set_content(responseJson.dump(), "application/json");
+		return;
+	}
+
+	responseJson = {
+		{"success", true},
+		{"licensePlate", result.plate},
+		{"confidence", result.confidence},
+		{"roi", {
+			{"x", result.roi.x},
+			{"y", result.roi.y},
+			{"width", result.roi.width},
+			{"height", result.roi.height}
+		}}
+	};
+
+	response.set_content(responseJson.dump(), "application/json");
+}
+
 void HttpServer::createAccount(const httplib::Request& request, httplib::Response& response)
 {
 	nlohmann::json responseJson;
@@ -5,6 +5,8 @@
 #include "subscriptionmanager.h"
 #include "websocketserver.h"
 #include "logger.h"
+#include "recognitionpool.h"
+#include "qrdecodingpool.h"
 
 #include <memory>
 #include <thread>
@@ -99,7 +101,8 @@ private:
 	 * @details This function processes POST requests by first checking the validity of the API key.
 	 *          If valid, it checks for the presence of a "licensePlate" parameter or a file named "qrCodeImage".
 	 *          If a license plate is provided, the function attempts to pay for the parking using the provided vehicle data.
-	 *          If a QR code image is provided, it is decoded to extract the ticket number, which is then used for parking validation.
+	 *          If a QR code image is provided, it is queued on the QR decoding pool to extract the ticket number, which is then used for parking validation.
+	 *          When the queue of the pool is full, the request is answered at once with the status 503 and a Retry-After header.
 	 *          If the vehicle is found and the payment is successful, a success message is returned with the vehicle's details.
 	 *          If any error occurs during the validation or payment process, an error message is returned.
 	 * @param[in] request The HTTP request object containing the incoming parameters and files.
@@ -108,6 +111,19 @@ private:
 	 */
 	void post(const httplib::Request& request, httplib::Response& response);
 
+	/**
+	 * @brief Recognizes the license plate in an uploaded image, for the gate computers that cannot run the recognition themselves.
+	 * @details This function checks the validity of the API key and queues the image received in the "image" file
+	 *          on the recognition pool, then waits for its result. The plate, its confidence and its region in the image
+	 *          are returned. When the queue of the pool is full, the request is answered at once with the status 503
+	 *          and a Retry-After header, so the gate computer can retry or fall back to its local recognition. If the Tesseract
+	 *          engines could not load their traineddata at startup, every request is answered with the status 503 without a Retry-After header.
+	 * @param[in] request The HTTP request object containing the API key and the image.
+	 * @param[out] response The HTTP response object to be populated with the recognition result.
+	 * @return void
+	 */
+	void recognizePlate(const httplib::Request& request, httplib::Response& response);
+
 	/**
 	 * @brief Creates a new user account after validating input data.
 	 * @details This function processes POST requests for creating new accounts. It first checks the API key validity,
@@ -402,6 +418,8 @@ private:
 	std::thread thread;
 	httplib::Server server;
 	std::unique_ptr<WebSocketServer> webSocketServer;
+	std::unique_ptr<RecognitionPool> recognitionPool;
+	std::unique_ptr<QRDecodingPool> qrDecodingPool;
 	SubscriptionManager subscriptionManager;
 	Logger& logger;
 	std::string key;
@@ -1,11 +1,80 @@
 ﻿#include "qrcodedetection.h"
+#include "imagedecoder.h"
+#include "licenseplatedetection.h"
 
+#include <atomic>
+#include <thread>
 #include <opencv2/core/utils/logger.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <ZXing/ReadBarcode.h>
 #include <ZXing/BarcodeFormat.h>
 #include <ZXing/DecodeHints.h>
 #include <ZXing/ImageView.h>
 
+namespace
+{
+	// The size of the images fed to the network and of the bit matrix it returns, for a version 1 QR code.
+	const int inputSize = 210;
+	const int matrixSize = 21;
+
+	// The rectified image and its 5 padded and 5 cropped variants tried by QRCode::getIdWithPadding.
+	const int paddingVariants = 11;
+
+	// The finder pattern candidates of the coarse pyramid level refined at full resolution, and the shortest side of a coarse
+	// level below which the finder patterns are too small to be told apart from the modules.
+	const int coarseCandidates = 6;
+	const int minCoarseSide = 200;
+
+	// The neighbours compared along each quantized gradient direction, as { dy, dx } offsets in the order of the suppression test.
+	const int suppressionOffsets[4][4][2] =
+	{
+		{ { 0, -1 }, { 0, -2 }, { 0, 1 }, { 0, 2 } },
+		{ { -1, -1 }, { -2, -2 }, { 1, 1 }, { 2, 2 } },
+		{ { -1, 0 }, { -2, 0 }, { 1, 0 }, { 2, 0 } },
+		{ { -1, 1 }, { -2, 2 }, { 1, -1 }, { 2, -2 } }
+	};
+
+	// Maps gradient directions in degrees, as returned by cv::cartToPolar, to the 4 bins of the suppression:
+	// 0 for [0, 22.5) and [157.5, 180], 1 for [22.5, 67.5), 2 for [67.5, 112.5) and 3 for [112.5, 157.5), modulo 180.
+	void quantizeDirections(const float* directions, uchar* bins, const int& cols)
+	{
+		int x = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+		const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+		const cv::v_float32 halfTurn = cv::vx_setall_f32(180.f);
+		const cv::v_float32 bound1 = cv::vx_setall_f32(22.5f), bound2 = cv::vx_setall_f32(67.5f);
+		const cv::v_float32 bound3 = cv::vx_setall_f32(112.5f), bound4 = cv::vx_setall_f32(157.5f);
+		const cv::v_int32 wrap = cv::vx_setall_s32(3);
+
+		// Every bound passed sets a comparison mask to -1, so the negated sum of the masks is the bin, with 4 wrapping back to 0.
+		auto quantize = [&](const float* src)
+			{
+				cv::v_float32 direction = cv::vx_load(src);
+				direction = cv::v_sub(direction, cv::v_and(cv::v_ge(direction, halfTurn), halfTurn));
+
+				cv::v_int32 passed = cv::v_add(
+					cv::v_add(cv::v_reinterpret_as_s32(cv::v_ge(direction, bound1)), cv::v_reinterpret_as_s32(cv::v_ge(direction, bound2))),
+					cv::v_add(cv::v_reinterpret_as_s32(cv::v_ge(direction, bound3)), cv::v_reinterpret_as_s32(cv::v_ge(direction, bound4))));
+
+				return cv::v_and(cv::v_sub(cv::vx_setzero_s32(), passed), wrap);
+			};
+
+		for (; x <= cols - lanes * 4; x += lanes * 4)
+		{
+			cv::v_int16 low = cv::v_pack(quantize(directions + x), quantize(directions + x + lanes));
+			cv::v_int16 high = cv::v_pack(quantize(directions + x + lanes * 2), quantize(directions + x + lanes * 3));
+			cv::v_store(bins + x, cv::v_pack_u(low, high));
+		}
+#endif
+		for (; x < cols; x++)
+		{
+			float direction = directions[x] >= 180 ? directions[x] - 180 : directions[x];
+			bins[x] = ((direction >= 22.5f) + (direction >= 67.5f) + (direction >= 112.5f) + (direction >= 157.5f)) & 3;
+		}
+	}
+}
+
 QRCode::QRCode()
 {
 	cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_SILENT);
@@ -17,6 +86,13 @@ QRCode::QRCode()
 #endif
 }
 
+// The network and the direct decoder of a longer-lived owner, such as a worker of the decoding service of the server,
+// are used instead of loading the model again and starting a thread for every ticket.
+QRCode::QRCode(const cv::dnn::Net& model, QRDirectDecoder* directDecoder) : aiModel(model), directDecoder(directDecoder)
+{
+	cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_SILENT);
+}
+
 void QRCode::resize(const cv::Mat& src, cv::Mat& dst, const int& max)
 {
 	if (src.rows > src.cols && src.rows > max)
@@ -69,46 +145,55 @@ void QRCode::nonMaximumSuppression(const cv::Mat& src, cv::Mat& dst, const cv::M
 	if (src.size() != directions.size())
 		return;
 
+	std::vector<uchar> bins(src.cols);
+
 	for (int y = 2; y < src.rows - 2; y++)
-		for (int x = 2; x < src.cols - 2; x++)
-		{
-			float direction = fmod(directions.ptr<float>(y, x)[0], 180);
+	{
+		quantizeDirections(directions.ptr<float>(y), bins.data(), src.cols);
 
-			uchar pixel = src.ptr<uchar>(y, x)[0];
-			uchar pixel1, pixel2, pixel3, pixel4;
+		const uchar* rows[5];
+		for (int i = 0; i < 5; i++)
+			rows[i] = src.ptr<uchar>(y - 2 + i);
 
-			if ((direction >= 0 && direction < 22.5) || (direction >= 157.5 && direction <= 180))
-			{
-				pixel1 = src.ptr<uchar>(y, x - 1)[0];
-				pixel2 = src.ptr<uchar>(y, x - 2)[0];
-				pixel3 = src.ptr<uchar>(y, x + 1)[0];
-				pixel4 = src.ptr<uchar>(y, x + 2)[0];
-			}
-			else if (direction >= 22.5 && direction < 67.5)
-			{
-				pixel1 = src.ptr<uchar>(y - 1, x - 1)[0];
-				pixel2 = src.ptr<uchar>(y - 2, x - 2)[0];
-				pixel3 = src.ptr<uchar>(y + 1, x + 1)[0];
-				pixel4 = src.ptr<uchar>(y + 2, x + 2)[0];
-			}
-			else if (direction >= 67.5 && direction < 112.5)
-			{
-				pixel1 = src.ptr<uchar>(y - 1, x)[0];
-				pixel2 = src.ptr<uchar>(y - 2, x)[0];
-				pixel3 = src.ptr<uchar>(y + 1, x)[0];
-				pixel4 = src.ptr<uchar>(y + 2, x)[0];
-			}
-			else if (direction >= 112.5 && direction <= 157.5)
+		const uchar* srcRow = rows[2];
+		uchar* dstRow = dst.ptr<uchar>(y);
+
+		int x = 2;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+		const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+
+		// Each direction is tested on the whole vector and the bins select which test applies to each pixel.
+		for (; x <= src.cols - 2 - lanes; x += lanes)
+		{
+			cv::v_uint8 pixel = cv::vx_load(srcRow + x);
+			cv::v_uint8 bin = cv::vx_load(bins.data() + x);
+			cv::v_uint8 maxima = cv::vx_setzero_u8();
+
+			for (int direction = 0; direction < 4; direction++)
 			{
-				pixel1 = src.ptr<uchar>(y - 1, x + 1)[0];
-				pixel2 = src.ptr<uchar>(y - 2, x + 2)[0];
-				pixel3 = src.ptr<uchar>(y + 1, x - 1)[0];
-				pixel4 = src.ptr<uchar>(y + 2, x - 2)[0];
+				const int(*offsets)[2] = suppressionOffsets[direction];
+
+				cv::v_uint8 isMaximum = cv::v_ge(pixel, cv::vx_load(rows[2 + offsets[0][0]] + x + offsets[0][1]));
+				for (int i = 1; i < 4; i++)
+					isMaximum = cv::v_and(isMaximum, cv::v_gt(pixel, cv::vx_load(rows[2 + offsets[i][0]] + x + offsets[i][1])));
+
+				maxima = cv::v_or(maxima, cv::v_and(isMaximum, cv::v_eq(bin, cv::vx_setall_u8(static_cast<uchar>(direction)))));
 			}
 
-			if (!(pixel < pixel1 || pixel <= pixel2 || pixel <= pixel3 || pixel <= pixel4))
-				dst.ptr<uchar>(y, x)[0] = 255;
+			cv::v_store(dstRow + x, cv::v_or(cv::vx_load(dstRow + x), maxima));
+		}
+#endif
+		for (; x < src.cols - 2; x++)
+		{
+			const int(*offsets)[2] = suppressionOffsets[bins[x]];
+			uchar pixel = srcRow[x];
+
+			if (pixel >= rows[2 + offsets[0][0]][x + offsets[0][1]] && pixel > rows[2 + offsets[1][0]][x + offsets[1][1]] &&
+				pixel > rows[2 + offsets[2][0]][x + offsets[2][1]] && pixel > rows[2 + offsets[3][0]][x + offsets[3][1]])
+				dstRow[x] = 255;
 		}
+	}
 }
 
 void QRCode::edgeDetection(const cv::Mat& src, cv::Mat& dst)
@@ -136,7 +221,7 @@ bool QRCode::isQuadrilateral(const std::vector<cv::Point>& contour)
 	return approx.size() == 4;
 }
 
-bool QRCode::detectQRAnchors(const cv::Mat& binary, std::vector<std::vector<cv::Point>>& anchors)
+bool QRCode::detectQRAnchors(const cv::Mat& binary, std::vector<std::vector<cv::Point>>& anchors, const int& count, std::vector<float>* anchorScores)
 {
 	cv::Mat dilated;
 	cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
@@ -193,20 +278,145 @@ bool QRCode::detectQRAnchors(const cv::Mat& binary, std::vector<std::vector<cv::
 		scores.push_back({ mean, i });
 	}
 
-	if (scores.size() < 3)
+	if (scores.size() < static_cast<size_t>(count))
 		return false;
 
 	std::sort(scores.begin(), scores.end());
 
-	for (int i = 0; i < 3; i++)
+	for (int i = 0; i < count; i++)
 	{
 		int index = scores[i].second;
 		anchors.push_back(contours[index]);
+
+		if (anchorScores)
+			anchorScores->push_back(scores[i].first);
+	}
+
+	return true;
+}
+
+void QRCode::coarseAnchorCandidates(const cv::Mat& coarse, std::vector<std::vector<cv::Point>>& candidates)
+{
+	// The edges of a finder pattern merge at this scale, but its dark ring, light ring and dark core stay nested regions of the
+	// binarized ticket.
+	cv::Mat binary;
+	cv::threshold(coarse, binary, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+
+	std::vector<std::vector<cv::Point>> contours;
+	std::vector<cv::Vec4i> hierarchy;
+	cv::findContours(binary, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+
+	std::vector<std::pair<float, int>> scores;
+	for (int i = 0; i < contours.size(); i++)
+	{
+		int ring = hierarchy[i][2];
+		if (ring == -1 || hierarchy[ring][2] == -1)
+			continue;
+
+		if (!isQuadrilateral(contours[i]))
+			continue;
+
+		int core = hierarchy[ring][2];
+		float score = cv::matchShapes(contours[i], contours[ring], cv::CONTOURS_MATCH_I2, 0) + cv::matchShapes(contours[ring], contours[core], cv::CONTOURS_MATCH_I2, 0);
+		scores.push_back({ score, i });
 	}
 
+	std::sort(scores.begin(), scores.end());
+
+	for (int i = 0; i < std::min(static_cast<int>(scores.size()), coarseCandidates); i++)
+		candidates.push_back(contours[scores[i].second]);
+}
+
+bool QRCode::detectQRAnchorsPyramid(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, const int& levels)
+{
+	cv::Mat coarse = gray;
+	for (int i = 0; i < levels; i++)
+		cv::pyrDown(coarse, coarse);
+
+	if (std::min(coarse.cols, coarse.rows) < minCoarseSide)
+		return false;
+
+	std::vector<std::vector<cv::Point>> candidates;
+	coarseAnchorCandidates(coarse, candidates);
+	if (candidates.size() < 3)
+		return false;
+
+	// Every candidate is searched again at full resolution, in a window of twice its size, with the edges of the full-frame search.
+	const int factor = 1 << levels;
+	const cv::Rect frame(0, 0, gray.cols, gray.rows);
+
+	std::vector<std::pair<float, std::vector<cv::Point>>> refined;
+	for (const auto& candidate : candidates)
+	{
+		cv::Rect box = cv::boundingRect(candidate);
+		int margin = std::max(box.width, box.height) / 2;
+		cv::Rect window = cv::Rect((box.x - margin) * factor, (box.y - margin) * factor, (box.width + 2 * margin) * factor, (box.height + 2 * margin) * factor) & frame;
+		if (window.empty())
+			continue;
+
+		cv::Mat edges;
+		edgeDetection(gray(window), edges);
+
+		std::vector<std::vector<cv::Point>> anchor;
+		std::vector<float> score;
+		if (!detectQRAnchors(edges, anchor, 1, &score))
+			continue;
+
+		for (cv::Point& point : anchor[0])
+			point += window.tl();
+
+		// Overlapping windows find the same finder pattern.
+		cv::Point2f centroid = getContourCentroid(anchor[0]);
+		bool duplicate = std::any_of(refined.begin(), refined.end(), [&centroid](const std::pair<float, std::vector<cv::Point>>& other)
+			{
+				return cv::norm(getContourCentroid(other.second) - centroid) < 3;
+			});
+
+		if (!duplicate)
+			refined.push_back({ score[0], anchor[0] });
+	}
+
+	if (refined.size() < 3)
+		return false;
+
+	std::sort(refined.begin(), refined.end(), [](const std::pair<float, std::vector<cv::Point>>& first, const std::pair<float, std::vector<cv::Point>>& second)
+		{
+			return first.first < second.first;
+		});
+
+	for (int i = 0; i < 3; i++)
+		anchors.push_back(refined[i].second);
+
 	return true;
 }
 
+bool QRCode::findAnchors(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, const int& pyramidLevels, bool* fromPyramid)
+{
+	if (fromPyramid)
+		*fromPyramid = false;
+
+	if (gray.empty() || gray.type() != CV_8UC1)
+		return false;
+
+	if (pyramidLevels > 0 && detectQRAnchorsPyramid(gray, anchors, pyramidLevels))
+	{
+		if (fromPyramid)
+			*fromPyramid = true;
+
+		return true;
+	}
+
+	cv::Mat edges;
+	edgeDetection(gray, edges);
+
+	return detectQRAnchors(edges, anchors);
+}
+
+void QRCode::setPyramidLevels(const int& levels)
+{
+	pyramidLevels = std::clamp(levels, 0, 2);
+}
+
 cv::Point2f QRCode::getContourCentroid(const std::vector<cv::Point>& contour)
 {
 	cv::Moments moments = cv::moments(contour);
@@ -671,35 +881,60 @@ bool QRCode::geometricalTransformation(const cv::Mat& src, cv::Mat& dst, const s
 	return cv::countNonZero(dst);
 }
 
-bool QRCode::getMatrixFromImage(const cv::Mat& src, cv::Mat& dst)
+bool QRCode::getMatricesFromImages(const std::vector<cv::Mat>& images, std::vector<cv::Mat>& matrices)
 {
-	cv::Mat image;
-	cv::resize(src, image, cv::Size(210, 210), 0, 0, cv::INTER_NEAREST);
+	if (images.empty())
+		return false;
+
+	std::vector<cv::Mat> inputs(images.size());
+	for (int i = 0; i < images.size(); i++)
+	{
+		cv::resize(images[i], inputs[i], cv::Size(inputSize, inputSize), 0, 0, cv::INTER_NEAREST);
 
-	if (image.channels() == 3)
-		cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
+		if (inputs[i].channels() == 3)
+			cv::cvtColor(inputs[i], inputs[i], cv::COLOR_BGR2GRAY);
+	}
 
-	cv::Mat blob = cv::dnn::blobFromImage(image, 1.0 / 255.0);
+	// Every image is a sample of the same NCHW blob, so the network runs once for all of them.
+	cv::Mat blob = cv::dnn::blobFromImages(inputs, 1.0 / 255.0);
 
 	aiModel.setInput(blob);
 
 	cv::Mat bits = aiModel.forward();
 
-	if (bits.total() != 21 * 21)
+	const int count = static_cast<int>(images.size());
+	if (bits.total() != static_cast<size_t>(count) * matrixSize * matrixSize)
 		return false;
 
-	cv::Mat reshaped = bits.reshape(1, 21);
-	cv::threshold(reshaped, dst, 0.5, 255, cv::THRESH_BINARY_INV);
-	dst.convertTo(dst, CV_8UC1);
+	cv::Mat samples = bits.reshape(1, count);
+
+	matrices.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		cv::threshold(samples.row(i).reshape(1, matrixSize), matrices[i], 0.5, 255, cv::THRESH_BINARY_INV);
+		matrices[i].convertTo(matrices[i], CV_8UC1);
+	}
 
 	return true;
 }
 
-bool QRCode::getID(const cv::Mat& src, std::string& id, ZXing::Position* position)
+bool QRCode::warmUp(cv::dnn::Net& net)
+{
+	std::vector<cv::Mat> blanks(paddingVariants, cv::Mat::zeros(inputSize, inputSize, CV_8UC1));
+
+	QRCode qr(net);
+	std::vector<cv::Mat> matrices;
+
+	return qr.getMatricesFromImages(blanks, matrices);
+}
+
+bool QRCode::getID(const cv::Mat& src, std::string& id, ZXing::Position* position, const bool& tryHarder)
 {
 	ZXing::ImageView imageView(src.data, src.cols, src.rows, ZXing::ImageFormat::Lum);
 	ZXing::DecodeHints hints;
 	hints.setFormats(ZXing::BarcodeFormat::QRCode);
+	hints.setTryHarder(tryHarder);
+	hints.setTryRotate(tryHarder);
 
 	auto result = ZXing::ReadBarcode(imageView, hints);
 	if (!result.isValid())
@@ -717,28 +952,17 @@ bool QRCode::getID(const cv::Mat& src, std::string& id, ZXing::Position* positio
 	return true;
 }
 
-bool QRCode::tryDecode(const cv::Mat& src, cv::Mat& dst, std::string& id)
-{
-	if (!getMatrixFromImage(src, dst))
-		return false;
-
-	if (!getID(dst, id))
-		return false;
-
-	return true;
-}
-
 bool QRCode::getIdWithPadding(const cv::Mat& src, cv::Mat& dst, std::string& id)
 {
 	if (src.empty() || src.type() != CV_8UC1)
 		return false;
 
-	if (tryDecode(src, dst, id))
-		return true;
-
 	float max = 0.05f;
 	float step = 0.01f;
 
+	// The rectified image is tried first, then the padded variants and then the cropped ones.
+	std::vector<cv::Mat> variants = { src };
+
 	for (float padding = step; padding <= max + 0.0001f; padding += step)
 	{
 		int paddingX = static_cast<int>(src.cols * padding);
@@ -746,9 +970,7 @@ bool QRCode::getIdWithPadding(const cv::Mat& src, cv::Mat& dst, std::string& id)
 
 		cv::Mat padded;
 		cv::copyMakeBorder(src, padded, paddingY, paddingY, paddingX, paddingX, cv::BORDER_REPLICATE);
-
-		if (tryDecode(padded, dst, id))
-			return true;
+		variants.push_back(padded);
 	}
 
 	for (float crop = step; crop <= max + 0.0001f; crop += step)
@@ -760,13 +982,44 @@ bool QRCode::getIdWithPadding(const cv::Mat& src, cv::Mat& dst, std::string& id)
 			continue;
 
 		cv::Rect roi(cropX, cropY, src.cols - cropX * 2, src.rows - cropY * 2);
-		cv::Mat cropped = src(roi).clone();
-
-		if (tryDecode(cropped, dst, id))
-			return true;
+		variants.push_back(src(roi));
 	}
 
-	return false;
+	std::vector<cv::Mat> matrices;
+	if (!getMatricesFromImages(variants, matrices))
+		return false;
+
+	// The matrices are decoded concurrently, but the first variant in the order above that is decoded still wins.
+	// Once a variant is decoded, the variants after it that were not started yet are skipped. At most as many variants as the
+	// thread budget of the caller are decoded at once, each stripe taking every stripes-th variant so that the first ones go first.
+	const int count = static_cast<int>(matrices.size());
+	const int stripes = std::min(count, getThreadBudget());
+	std::vector<std::string> ids(count);
+	std::atomic<int> winner(count);
+
+	cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range)
+		{
+			for (int stripe = range.start; stripe < range.end; stripe++)
+				for (int i = stripe; i < count; i += stripes)
+				{
+					if (i > winner.load())
+						continue;
+
+					if (!getID(matrices[i], ids[i]))
+						continue;
+
+					int current = winner.load();
+					while (i < current && !winner.compare_exchange_weak(current, i));
+				}
+		}, static_cast<double>(stripes));
+
+	if (winner.load() == count)
+		return false;
+
+	dst = matrices[winner.load()];
+	id = ids[winner.load()];
+
+	return true;
 }
 
 std::vector<cv::Point2f> QRCode::cvtPositionToCoordinates(const ZXing::Position& position)
@@ -856,12 +1109,155 @@ void QRCode::drawBBox(const cv::Mat& src, std::vector<unsigned char>& dst, const
 	cv::imencode(".png", drawnCoordinates, dst);
 }
 
+bool QRCode::decodeRectified(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, std::vector<cv::Point2f>& coordinates, std::string& id, const std::function<bool()>& isCancelled)
+{
+	if (!findAnchors(gray, anchors, pyramidLevels) || isCancelled())
+		return false;
+
+	sortAnchors(anchors);
+	coordinates = rectificationCoordinates(anchors, 0.07);
+
+	cv::Mat resizedConnectedComponent;
+	if (isCancelled() || !resizeToPoints(gray, resizedConnectedComponent, coordinates, 0.2))
+		return false;
+
+	cv::Mat transformedConnectedComponent;
+	if (isCancelled() || !geometricalTransformation(resizedConnectedComponent, transformedConnectedComponent, coordinates))
+		return false;
+
+	if (isCancelled())
+		return false;
+
+	cv::Mat qrCode;
+	return getIdWithPadding(transformedConnectedComponent, qrCode, id) || getID(transformedConnectedComponent, id);
+}
+
+QRDirectDecoder::~QRDirectDecoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_all();
+
+	if (thread.joinable())
+		thread.join();
+}
+
+void QRDirectDecoder::start(const cv::Mat& gray)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// The thread is started by the first ticket and then reused by the next ones.
+		if (!thread.joinable())
+			thread = std::thread(&QRDirectDecoder::run, this);
+
+		image = gray;
+		decoded = false;
+		pending = true;
+	}
+
+	condition.notify_all();
+}
+
+bool QRDirectDecoder::isDecoded() const
+{
+	return decoded.load();
+}
+
+bool QRDirectDecoder::wait(std::string& id, ZXing::Position& position)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this]()
+		{
+			return !pending && !running;
+		});
+
+	image.release();
+
+	if (!decoded)
+		return false;
+
+	id = decodedId;
+	position = decodedPosition;
+	return true;
+}
+
+void QRDirectDecoder::run()
+{
+	while (true)
+	{
+		cv::Mat gray;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]()
+				{
+					return pending || stopping;
+				});
+
+			if (!pending)
+				return;
+
+			gray = image;
+			pending = false;
+			running = true;
+		}
+
+		// The racing decoding skips the harder and rotated scans, so that a rectification that wins never waits long for it.
+		std::string id;
+		ZXing::Position position;
+		bool success = false;
+		try
+		{
+			success = QRCode::getID(gray, id, &position, false);
+		}
+		catch (...)
+		{
+			success = false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decodedId = id;
+			decodedPosition = position;
+			decoded = success;
+			running = false;
+		}
+
+		condition.notify_all();
+	}
+}
+
+void QRCode::setDecodeMode(const QRDecodeMode& mode)
+{
+	decodeMode = mode;
+}
+
 std::string QRCode::decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst)
 {
+	QRDecodePath decodedPath;
+	return decodeQR(src, dst, decodedPath);
+}
+
+std::string QRCode::decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst, QRDecodePath& decodedPath)
+{
+	static const std::function<bool()> notCancelled = []()
+		{
+			return false;
+		};
+
 	std::string id;
 	std::vector<cv::Point2f> coordinates;
-	ZXing::Position position;
-	cv::Mat image = cv::imdecode(src, cv::IMREAD_COLOR);
+	std::vector<std::vector<cv::Point>> anchors;
+	decodedPath = QRDecodePath::None;
+
+	// A JPEG image is decoded directly at the largest reduction that keeps its longer side above the working size,
+	// so the full resolution of a phone photo is never decoded.
+	cv::Mat image;
+	ImageDecoder::decode(src, image, ImageDecoder::reductionFor(ImageDecoder::encodedSize(src), 1080));
 
 	cv::Mat resized;
 	resize(image, resized, 1080);
@@ -869,47 +1265,71 @@ std::string QRCode::decodeQR(const std::vector<unsigned char>& src, std::vector<
 	cv::Mat gray;
 	cv::cvtColor(resized, gray, cv::COLOR_BGR2GRAY);
 
-	cv::Mat edges;
-	edgeDetection(gray, edges);
-
-	std::vector<std::vector<cv::Point>> anchors;
-	if (!detectQRAnchors(edges, anchors))
+	if (decodeMode == QRDecodeMode::Sequential)
 	{
-		if (getID(gray, id, &position))
+		ZXing::Position position;
+		if (decodeRectified(gray, anchors, coordinates, id, notCancelled))
+			decodedPath = QRDecodePath::Rectified;
+		else if (getID(gray, id, &position))
+		{
+			// The anchors found by a failed rectification are not the ones of the decoded code.
+			anchors.clear();
 			coordinates = cvtPositionToCoordinates(position);
+			decodedPath = QRDecodePath::Direct;
+		}
 
 		drawBBox(resized, dst, anchors, coordinates, id);
 		return id;
 	}
 
-	sortAnchors(anchors);
-	coordinates = rectificationCoordinates(anchors, 0.07);
-
-	cv::Mat resizedConnectedComponent;
-	if (!resizeToPoints(gray, resizedConnectedComponent, coordinates, 0.2))
+	// Most photos of a ticket are decoded by ZXing directly, so it races the rectification instead of waiting for it to fail.
+	// The rectification stops at its next stage once the direct decoding has succeeded. The racing decoding skips the harder
+	// scans, so a rectification that wins waits little for it, and runs on the thread of a direct decoder reused from one ticket
+	// to the next, the one of the owner of the network if any. It is waited for before returning, so a decoding never runs
+	// on more than the caller's thread and that one.
+	if (!directDecoder)
 	{
-		if (getID(gray, id, &position))
-			coordinates = cvtPositionToCoordinates(position);
+		if (!ownDirectDecoder)
+			ownDirectDecoder = std::make_unique<QRDirectDecoder>();
 
-		drawBBox(resized, dst, anchors, coordinates, id);
-		return id;
+		directDecoder = ownDirectDecoder.get();
 	}
 
-	cv::Mat transformedConnectedComponent;
-	if (!geometricalTransformation(resizedConnectedComponent, transformedConnectedComponent, coordinates))
-	{
-		if (getID(gray, id, &position))
-			coordinates = cvtPositionToCoordinates(position);
+	directDecoder->start(gray);
 
-		drawBBox(resized, dst, anchors, coordinates, id);
-		return id;
+	QRDirectDecoder* racing = directDecoder;
+	auto isDirectDecoded = [racing]()
+		{
+			return racing->isDecoded();
+		};
+
+	std::string directId;
+	ZXing::Position position;
+
+	bool rectified = false;
+	try
+	{
+		rectified = decodeRectified(gray, anchors, coordinates, id, isDirectDecoded);
+	}
+	catch (...)
+	{
+		directDecoder->wait(directId, position);
+		throw;
 	}
 
-	cv::Mat qrCode;
-	if (!getIdWithPadding(transformedConnectedComponent, qrCode, id))
-		if (!getID(transformedConnectedComponent, id))
-			if (getID(gray, id, &position))
-				coordinates = cvtPositionToCoordinates(position);
+	bool directDecoded = directDecoder->wait(directId, position);
+
+	// A ticket that neither path decoded gets the harder scans of the sequential mode.
+	if (rectified)
+		decodedPath = QRDecodePath::Rectified;
+	else if (directDecoded || getID(gray, directId, &position))
+	{
+		// The anchors found by the cancelled rectification are not the ones of the decoded code.
+		id = directId;
+		anchors.clear();
+		coordinates = cvtPositionToCoordinates(position);
+		decodedPath = QRDecodePath::Direct;
+	}
 
 	drawBBox(resized, dst, anchors, coordinates, id);
 	return id;
@@ -17,12 +17,70 @@
 #include <opencv2/opencv.hpp>
 #include <algorithm>
 #include <ZXing/Result.h> 
+#include <functional>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+enum class QRDecodeMode
+{
+	Sequential,
+	Speculative
+};
+
+enum class QRDecodePath
+{
+	None,
+	Direct,
+	Rectified
+};
+
+class QRCODEDETECTION_API QRDirectDecoder
+{
+public:
+	QRDirectDecoder() = default;
+
+	~QRDirectDecoder();
+
+	QRDirectDecoder(const QRDirectDecoder&) = delete;
+
+	QRDirectDecoder& operator=(const QRDirectDecoder&) = delete;
+
+	void start(const cv::Mat& gray);
+
+	bool isDecoded() const;
+
+	bool wait(std::string& id, ZXing::Position& position);
+
+private:
+	void run();
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::thread thread;
+	cv::Mat image;
+	bool pending = false;
+	bool running = false;
+	bool stopping = false;
+	std::atomic<bool> decoded = false;
+	std::string decodedId;
+	ZXing::Position decodedPosition;
+};
 
 class QRCODEDETECTION_API QRCode
 {
 public:
 	QRCode();
 
+	explicit QRCode(const cv::dnn::Net& model, QRDirectDecoder* directDecoder = nullptr);
+
+	void setDecodeMode(const QRDecodeMode& mode);
+
+	void setPyramidLevels(const int& levels);
+
 private:
 	static void resize(const cv::Mat& src, cv::Mat& dst, const int& max);
 
@@ -34,7 +92,11 @@ private:
 
 	static bool isQuadrilateral(const std::vector<cv::Point>& contour);
 
-	static bool detectQRAnchors(const cv::Mat& binary, std::vector<std::vector<cv::Point>>& anchors);
+	static bool detectQRAnchors(const cv::Mat& binary, std::vector<std::vector<cv::Point>>& anchors, const int& count = 3, std::vector<float>* anchorScores = nullptr);
+
+	static void coarseAnchorCandidates(const cv::Mat& coarse, std::vector<std::vector<cv::Point>>& candidates);
+
+	static bool detectQRAnchorsPyramid(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, const int& levels);
 
 	static cv::Point2f getContourCentroid(const std::vector<cv::Point>& contour);
 
@@ -62,21 +124,33 @@ private:
 
 	static bool geometricalTransformation(const cv::Mat& src, cv::Mat& dst, const std::vector<cv::Point2f>& coordinates);
 
-	bool getMatrixFromImage(const cv::Mat& src, cv::Mat& dst);
-
-	static bool getID(const cv::Mat& src, std::string& id, ZXing::Position* position = nullptr);
+	bool getMatricesFromImages(const std::vector<cv::Mat>& images, std::vector<cv::Mat>& matrices);
 
-	bool tryDecode(const cv::Mat& image, cv::Mat& dst, std::string& id);
+	static bool getID(const cv::Mat& src, std::string& id, ZXing::Position* position = nullptr, const bool& tryHarder = true);
 
 	bool getIdWithPadding(const cv::Mat& src, cv::Mat& matrix, std::string& id);
 
 	static std::vector<cv::Point2f> cvtPositionToCoordinates(const ZXing::Position& position);
 
+	bool decodeRectified(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, std::vector<cv::Point2f>& coordinates, std::string& id, const std::function<bool()>& isCancelled);
+
 	static void drawBBox(const cv::Mat& src, std::vector<unsigned char>& dst, const std::vector<std::vector<cv::Point>>& contours, const std::vector<cv::Point2f>& coordinates, const std::string& id);
 
 public:
+	static bool findAnchors(const cv::Mat& gray, std::vector<std::vector<cv::Point>>& anchors, const int& pyramidLevels, bool* fromPyramid = nullptr);
+
+	static bool warmUp(cv::dnn::Net& net);
+
 	std::string decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst);
 
+	std::string decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst, QRDecodePath& decodedPath);
+
 private:
 	cv::dnn::Net aiModel;
+	QRDecodeMode decodeMode = QRDecodeMode::Speculative;
+	int pyramidLevels = 1;
+	QRDirectDecoder* directDecoder = nullptr;
+	std::unique_ptr<QRDirectDecoder> ownDirectDecoder;
+
+	friend class QRDirectDecoder;
 };
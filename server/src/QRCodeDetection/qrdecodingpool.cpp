@@ -0,0 +1,75 @@
+#include "qrdecodingpool.h"
+
+#include <algorithm>
+#include <chrono>
+
+QRDecodingPool::QRDecodingPool(const int& workers, const int& capacity, const std::string& modelPath)
+	: service(std::max(workers, 1), modelPath), pool(std::max(workers, 1), capacity, [this]()
+		{
+			return makeHandler();
+		})
+{
+}
+
+bool QRDecodingPool::isLoaded() const
+{
+	return service.isLoaded();
+}
+
+bool QRDecodingPool::submit(std::vector<unsigned char> buffer, std::future<QRDecodingResult>& result)
+{
+	Job job{ std::move(buffer), std::promise<QRDecodingResult>() };
+	std::future<QRDecodingResult> future = job.result.get_future();
+
+	if (!pool.trySubmit(job))
+		return false;
+
+	result = std::move(future);
+	return true;
+}
+
+size_t QRDecodingPool::pending() const
+{
+	return pool.pending();
+}
+
+int QRDecodingPool::getWorkers() const
+{
+	return pool.getWorkers();
+}
+
+int QRDecodingPool::getCapacity() const
+{
+	return pool.getCapacity();
+}
+
+WorkerPoolStatistics QRDecodingPool::getStatistics() const
+{
+	return pool.getStatistics();
+}
+
+WorkerPool<QRDecodingPool::Job>::Handler QRDecodingPool::makeHandler()
+{
+	// The pool runs every worker with a thread budget of 1, so the variants of a ticket are decoded on the worker's thread only.
+	// With the direct decoding that races the rectification, a worker runs on exactly two threads.
+	return [this](Job& job, const double& waitTime)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			QRDecodingResult result;
+			result.waitTime = waitTime;
+
+			// A failure is handed to the waiting caller instead of ending the worker.
+			try
+			{
+				result.decoded = service.decodeQR(job.buffer, result.annotated, result.id, result.decodedPath);
+				result.decodeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				job.result.set_value(result);
+			}
+			catch (...)
+			{
+				job.result.set_exception(std::current_exception());
+			}
+		};
+}
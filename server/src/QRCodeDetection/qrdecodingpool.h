@@ -0,0 +1,123 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef QRCODEDETECTION_EXPORTS
+#define QRCODEDETECTION_API __declspec(dllexport)
+#else
+#define QRCODEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define QRCODEDETECTION_API __attribute__((visibility("default")))
+#else
+#define QRCODEDETECTION_API
+#endif
+
+#include "qrdecodingservice.h"
+#include "workerpool.h"
+
+#include <future>
+#include <string>
+#include <vector>
+
+/**
+ * @struct QRDecodingResult
+ * @brief Holds the QR code decoded from an uploaded ticket and the time spent on it by the pool.
+ */
+struct QRDecodingResult
+{
+	bool decoded = false;
+	std::string id;
+	QRDecodePath decodedPath = QRDecodePath::None;
+	std::vector<unsigned char> annotated;
+	double waitTime = 0;
+	double decodeTime = 0;
+};
+
+/**
+ * @class QRDecodingPool
+ * @brief Decodes the QR codes of the uploaded tickets on a fixed number of worker threads, apart from the HTTP threads.
+ *
+ * A ticket photo costs far more CPU than any other request of the API, so a burst of uploads decoded on the HTTP threads
+ * would hold all of them and stall the cheap requests behind it. The tickets are instead decoded by the workers of the pool,
+ * each with a network of a decoding service that has exactly one network per worker, and the tickets waiting for a worker
+ * are kept in the bounded queue of a WorkerPool. When the queue is full, new tickets are rejected at once, so at most the workers
+ * and the capacity of the queue hold an HTTP thread and the client is told to retry. The time every ticket waited in the queue
+ * and the time it was decoded are measured separately, to tell an overloaded pool from a slow decoding. Every worker decodes
+ * on its own thread, with a thread budget of 1, and on the thread of the direct decoding that races the rectification,
+ * so the pool runs on twice as many threads as it has workers.
+ */
+class QRCODEDETECTION_API QRDecodingPool
+{
+public:
+	/**
+	 * @brief Loads the model and starts the workers of the pool.
+	 * @param[in] workers The number of worker threads, at least 1.
+	 * @param[in] capacity The number of tickets that can wait for a worker, at least 1.
+	 * @param[in] modelPath The path of the ONNX model, or an empty string for the default model next to the executable.
+	 */
+	QRDecodingPool(const int& workers, const int& capacity, const std::string& modelPath = "");
+
+	QRDecodingPool(const QRDecodingPool&) = delete;
+
+	QRDecodingPool& operator=(const QRDecodingPool&) = delete;
+
+public:
+	/**
+	 * @brief Checks whether the model of the pool was loaded.
+	 * @return Returns true if the networks of the workers were created, false otherwise.
+	 */
+	bool isLoaded() const;
+
+	/**
+	 * @brief Queues an uploaded ticket for decoding.
+	 * @param[in] buffer The encoded image of the ticket, moved into the queue.
+	 * @param[out] result The future decoding result, valid only if the ticket was queued.
+	 * @return Returns true if the ticket was queued, false if the queue is full or the pool is stopping.
+	 */
+	bool submit(std::vector<unsigned char> buffer, std::future<QRDecodingResult>& result);
+
+	/**
+	 * @brief Returns the number of tickets waiting for a worker.
+	 * @return The number of queued tickets.
+	 */
+	size_t pending() const;
+
+	/**
+	 * @brief Returns the number of worker threads.
+	 * @return The number of workers.
+	 */
+	int getWorkers() const;
+
+	/**
+	 * @brief Returns the number of tickets that can wait for a worker.
+	 * @return The capacity of the queue.
+	 */
+	int getCapacity() const;
+
+	/**
+	 * @brief Returns how many tickets were accepted, rejected and decoded since the pool started, and how long they waited and were decoded.
+	 * @return The statistics of the pool.
+	 */
+	WorkerPoolStatistics getStatistics() const;
+
+private:
+	/**
+	 * @struct Job
+	 * @brief Holds a queued ticket and the promise of its result.
+	 */
+	struct Job
+	{
+		std::vector<unsigned char> buffer;
+		std::promise<QRDecodingResult> result;
+	};
+
+	/**
+	 * @brief Builds the handler of a worker, which decodes the queued tickets with the networks of the service.
+	 * @return The handler of the worker.
+	 */
+	WorkerPool<Job>::Handler makeHandler();
+
+private:
+	QRDecodingService service;
+	WorkerPool<Job> pool;
+};
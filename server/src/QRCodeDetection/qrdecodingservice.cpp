@@ -0,0 +1,137 @@
+#include "qrdecodingservice.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <opencv2/core/utils/logger.hpp>
+
+namespace
+{
+#ifdef _DEBUG
+	const std::string defaultModelPath = "../../../qrbitnet.onnx";
+#else
+	const std::string defaultModelPath = "qrbitnet.onnx";
+#endif
+}
+
+QRDecodingService::QRDecodingService(const int& workers, const std::string& modelPath)
+{
+	cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_SILENT);
+
+	std::ifstream file(modelPath.empty() ? defaultModelPath : modelPath, std::ios::binary);
+	if (!file)
+		return;
+
+	model.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	int count = std::max(workers, 1);
+	nets.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		cv::dnn::Net net;
+		if (!createNet(net))
+		{
+			model.clear();
+			nets.clear();
+			directDecoders.clear();
+			return;
+		}
+
+		nets.push_back(net);
+		directDecoders.push_back(std::make_unique<QRDirectDecoder>());
+	}
+}
+
+bool QRDecodingService::isLoaded() const
+{
+	return !model.empty();
+}
+
+size_t QRDecodingService::idleNetworks() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return nets.size();
+}
+
+bool QRDecodingService::decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst, std::string& id)
+{
+	QRDecodePath decodedPath;
+	return decodeQR(src, dst, id, decodedPath);
+}
+
+bool QRDecodingService::decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst, std::string& id, QRDecodePath& decodedPath)
+{
+	cv::dnn::Net net;
+	std::unique_ptr<QRDirectDecoder> directDecoder;
+	if (!acquire(net, directDecoder))
+		return false;
+
+	// The network goes back to the service even if the decoding throws, so that it is not lost for the next tickets.
+	try
+	{
+		QRCode qr(net, directDecoder.get());
+		qr.setDecodeMode(decodeMode);
+		id = qr.decodeQR(src, dst, decodedPath);
+	}
+	catch (...)
+	{
+		release(net, std::move(directDecoder));
+		throw;
+	}
+
+	release(net, std::move(directDecoder));
+
+	return true;
+}
+
+void QRDecodingService::setDecodeMode(const QRDecodeMode& mode)
+{
+	decodeMode = mode;
+}
+
+bool QRDecodingService::createNet(cv::dnn::Net& net) const
+{
+	if (model.empty())
+		return false;
+
+	try
+	{
+		net = cv::dnn::readNetFromONNX(model);
+		if (net.empty())
+			return false;
+
+		return QRCode::warmUp(net);
+	}
+	catch (const cv::Exception&)
+	{
+		return false;
+	}
+}
+
+bool QRDecodingService::acquire(cv::dnn::Net& net, std::unique_ptr<QRDirectDecoder>& directDecoder)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!nets.empty())
+		{
+			net = nets.back();
+			nets.pop_back();
+			directDecoder = std::move(directDecoders.back());
+			directDecoders.pop_back();
+			return true;
+		}
+	}
+
+	if (!createNet(net))
+		return false;
+
+	directDecoder = std::make_unique<QRDirectDecoder>();
+	return true;
+}
+
+void QRDecodingService::release(const cv::dnn::Net& net, std::unique_ptr<QRDirectDecoder> directDecoder)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	nets.push_back(net);
+	directDecoders.push_back(std::move(directDecoder));
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#ifdef _WIN32
+#ifdef QRCODEDETECTION_EXPORTS
+#define QRCODEDETECTION_API __declspec(dllexport)
+#else
+#define QRCODEDETECTION_API __declspec(dllimport)
+#endif
+#elif __linux__
+#define QRCODEDETECTION_API __attribute__((visibility("default")))
+#else
+#define QRCODEDETECTION_API
+#endif
+
+#include "qrcodedetection.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class QRDecodingService
+ * @brief Decodes the QR codes of the uploaded tickets with networks loaded once, for the lifetime of the server.
+ *
+ * Parsing the ONNX model of the QR bits and setting up its graph costs far more than decoding a ticket, so the model is read
+ * from disk once and a network is created from it for every worker thread at startup. A network cannot be used by two
+ * threads at once, so each decoding borrows one from the service and gives it back afterwards; a new one is created only if
+ * more threads decode at the same time than there are networks. Every network runs a forward pass on a blank batch of the size
+ * decoded for a ticket when it is created, so the lazy allocations of its layers are not paid by the first ticket.
+ * Every network is lent with a direct decoder, whose thread runs the plain ZXing decoding that races the rectification,
+ * so that thread is also started once per worker instead of once per ticket.
+ */
+class QRCODEDETECTION_API QRDecodingService
+{
+public:
+	/**
+	 * @brief Loads the model and warms up a network for every worker thread.
+	 * @param[in] workers The number of threads that decode tickets at the same time, at least 1.
+	 * @param[in] modelPath The path of the ONNX model, or an empty string for the default model next to the executable.
+	 */
+	explicit QRDecodingService(const int& workers, const std::string& modelPath = "");
+
+	QRDecodingService(const QRDecodingService&) = delete;
+
+	QRDecodingService& operator=(const QRDecodingService&) = delete;
+
+public:
+	/**
+	 * @brief Checks whether the model was loaded.
+	 * @return Returns true if the model was read and its networks created, false otherwise.
+	 */
+	bool isLoaded() const;
+
+	/**
+	 * @brief Returns the number of networks ready to decode.
+	 * @return The number of idle networks.
+	 */
+	size_t idleNetworks() const;
+
+	/**
+	 * @brief Decodes the QR code of a ticket with a borrowed network.
+	 * @param[in] src The encoded image of the ticket.
+	 * @param[out] dst The encoded annotated image of the ticket.
+	 * @param[out] id The ticket number, empty if no QR code was decoded.
+	 * @return Returns false if no network could be borrowed, true otherwise, even if no QR code was decoded.
+	 */
+	bool decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst, std::string& id);
+
+	/**
+	 * @brief Decodes the QR code of a ticket with a borrowed network and reports which path decoded it.
+	 * @param[in] src The encoded image of the ticket.
+	 * @param[out] dst The encoded annotated image of the ticket.
+	 * @param[out] id The ticket number, empty if no QR code was decoded.
+	 * @param[out] decodedPath The path that decoded the QR code, QRDecodePath::None if no QR code was decoded.
+	 * @return Returns false if no network could be borrowed, true otherwise, even if no QR code was decoded.
+	 */
+	bool decodeQR(const std::vector<unsigned char>& src, std::vector<unsigned char>& dst, std::string& id, QRDecodePath& decodedPath);
+
+	/**
+	 * @brief Selects whether plain ZXing races the rectification of the tickets, which is the default, or is only tried after it.
+	 * @details The mode must be selected before the first ticket is decoded.
+	 * @param[in] mode The decoding mode.
+	 * @return void
+	 */
+	void setDecodeMode(const QRDecodeMode& mode);
+
+private:
+	/**
+	 * @brief Creates a network from the loaded model and runs a forward pass on a blank batch.
+	 * @param[out] net The warmed network.
+	 * @return Returns false if the model is not loaded or is invalid, true otherwise.
+	 */
+	bool createNet(cv::dnn::Net& net) const;
+
+	/**
+	 * @brief Borrows an idle network and its direct decoder, or creates them if every network is busy.
+	 * @param[out] net The borrowed network.
+	 * @param[out] directDecoder The borrowed direct decoder.
+	 * @return Returns false if no network could be created, true otherwise.
+	 */
+	bool acquire(cv::dnn::Net& net, std::unique_ptr<QRDirectDecoder>& directDecoder);
+
+	/**
+	 * @brief Gives a borrowed network and its direct decoder back to the service.
+	 * @param[in] net The network.
+	 * @param[in] directDecoder The direct decoder.
+	 * @return void
+	 */
+	void release(const cv::dnn::Net& net, std::unique_ptr<QRDirectDecoder> directDecoder);
+
+private:
+	std::vector<unsigned char> model;
+	mutable std::mutex mutex;
+	std::vector<cv::dnn::Net> nets;
+	std::vector<std::unique_ptr<QRDirectDecoder>> directDecoders;
+	QRDecodeMode decodeMode = QRDecodeMode::Speculative;
+};
@@ -0,0 +1,373 @@
+"""Trains the character classifier of CnnBackend and exports it to app/platechars.onnx.
+
+This is the NumPy version of train_platechars.ipynb, with the same network, input preparation, augmentations, optimizer
+and ONNX outputs, so that the shipped model can be reproduced on a machine without PyTorch or a GPU:
+
+    python train_platechars.py [output.onnx]
+
+The network is trained on characters rendered from the DIN 1451 font. The segmented plates of the thesis are split in two:
+every fourth plate chooses the best epoch and the others are held out, so that OcrBackends_Benchmark evaluates the model
+on plates that took no part in its training.
+"""
+
+import os
+import random
+import sys
+import time
+from typing import List, Tuple
+
+import cv2
+import numpy as np
+import onnx
+from onnx import TensorProto, helper, numpy_helper
+from PIL import Image, ImageDraw, ImageFont
+
+TRAINING_DIR = os.path.dirname(os.path.abspath(__file__))
+FONT_PATH = os.path.join(TRAINING_DIR, "DIN1451Mittelschrift.ttf")
+SEGMENTS_DIR = os.path.join(TRAINING_DIR, "..", "documentation", "licenta", "segmentari")
+LABELS_PATH = os.path.join(SEGMENTS_DIR, "labels.txt")
+ONNX_PATH = sys.argv[1] if len(sys.argv) > 1 else os.path.join(TRAINING_DIR, "..", "app", "platechars.onnx")
+
+LETTERS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+DIGITS = "0123456789"
+
+# Must match CnnBackend::inputSize and CnnBackend::prepareChar.
+INPUT_SIZE = 32
+GLYPH_SIZE = 96
+
+# Every VALIDATION_STRIDE-th plate of labels.txt chooses the best epoch, the others are held out.
+VALIDATION_STRIDE = 4
+
+SAMPLES_PER_CLASS = 1000
+BATCH_SIZE = 128
+EPOCHS = 15
+
+LEARNING_RATE = 2e-3
+WEIGHT_DECAY = 1e-4
+SEED = 42
+
+random.seed(SEED)
+np.random.seed(SEED)
+
+
+def prepare_char(binary: np.ndarray) -> np.ndarray:
+    """Same steps as CnnBackend::prepareChar: tight crop, centred in a black square with a margin of side / 8, area resize."""
+    ys, xs = np.nonzero(binary)
+    if len(xs) == 0:
+        return np.zeros((INPUT_SIZE, INPUT_SIZE), np.uint8)
+
+    char = binary[ys.min():ys.max() + 1, xs.min():xs.max() + 1]
+    height, width = char.shape
+    side = max(width, height)
+    margin = side // 8
+    top = (side - height) // 2
+    left = (side - width) // 2
+
+    square = cv2.copyMakeBorder(char, top + margin, side - height - top + margin, left + margin, side - width - left + margin,
+                                cv2.BORDER_CONSTANT, value=0)
+    return cv2.resize(square, (INPUT_SIZE, INPUT_SIZE), interpolation=cv2.INTER_AREA)
+
+
+def render_glyph(char: str, font: ImageFont.FreeTypeFont) -> np.ndarray:
+    canvas = Image.new("L", (GLYPH_SIZE * 2, GLYPH_SIZE * 2), 0)
+    ImageDraw.Draw(canvas).text((GLYPH_SIZE // 2, GLYPH_SIZE // 4), char, fill=255, font=font)
+    return np.array(canvas)
+
+
+def augment(glyph: np.ndarray) -> np.ndarray:
+    """Distorts a rendered glyph the way the segmentation of a real plate does: perspective, stroke width, blur and noise."""
+    height, width = glyph.shape
+    jitter = 0.08 * GLYPH_SIZE
+    source = np.float32([[0, 0], [width, 0], [width, height], [0, height]])
+    target = source + np.random.uniform(-jitter, jitter, source.shape).astype(np.float32)
+    warped = cv2.warpPerspective(glyph, cv2.getPerspectiveTransform(source, target), (width, height))
+
+    kernel = np.ones((random.randint(1, 5), random.randint(1, 5)), np.uint8)
+    warped = random.choice([cv2.erode, cv2.dilate, lambda image, _: image])(warped, kernel)
+
+    if random.random() < 0.5:
+        warped = cv2.GaussianBlur(warped, (5, 5), random.uniform(0.5, 2.0))
+
+    noise = np.random.normal(0, random.uniform(0, 40), warped.shape)
+    warped = np.clip(warped.astype(np.float32) + noise, 0, 255).astype(np.uint8)
+
+    _, binary = cv2.threshold(warped, 127, 255, cv2.THRESH_BINARY)
+    return binary
+
+
+def is_validation_plate(index: int) -> bool:
+    """Must match the split of OcrBackends_Benchmark, which reads the CNN only on the held out plates."""
+    return index % VALIDATION_STRIDE == 0
+
+
+def load_plate_chars(validation: bool) -> Tuple[np.ndarray, List[str]]:
+    """Cuts the characters of the validation or of the held out segmented plates, with their labels, in NCHW format."""
+    images, labels = [], []
+    with open(LABELS_PATH) as file:
+        for index, line in enumerate(file):
+            if is_validation_plate(index) != validation:
+                continue
+
+            name, text = line.split()
+            plate = cv2.imread(os.path.join(SEGMENTS_DIR, name), cv2.IMREAD_GRAYSCALE)
+            _, binary = cv2.threshold(plate, 127, 255, cv2.THRESH_BINARY)
+            count, components, stats, _ = cv2.connectedComponentsWithStats(binary)
+
+            chars = [i for i in range(1, count) if stats[i, cv2.CC_STAT_AREA] > 30 and stats[i, cv2.CC_STAT_HEIGHT] > plate.shape[0] * 0.3]
+            chars.sort(key=lambda i: stats[i, cv2.CC_STAT_LEFT])
+            if len(chars) != len(text):
+                print(f"Skipping {name}: {len(chars)} components for {text}")
+                continue
+
+            for i, char in zip(chars, text):
+                images.append(prepare_char(np.where(components == i, 255, 0).astype(np.uint8)))
+                labels.append(char)
+
+    return np.stack(images).astype(np.float32)[:, None] / 255.0, labels
+
+
+def im2col(x: np.ndarray) -> np.ndarray:
+    """Unfolds the 3x3 neighbourhoods of an NHWC tensor, padded by 1, into rows."""
+    n, h, w, c = x.shape
+    padded = np.pad(x, ((0, 0), (1, 1), (1, 1), (0, 0)))
+    s = padded.strides
+    patches = np.lib.stride_tricks.as_strided(padded, (n, h, w, 3, 3, c), (s[0], s[1], s[2], s[1], s[2], s[3]))
+    return np.ascontiguousarray(patches).reshape(n * h * w, 9 * c)
+
+
+def col2im(columns: np.ndarray, shape: Tuple[int, int, int, int]) -> np.ndarray:
+    """Adds the gradients of the unfolded neighbourhoods back to the NHWC tensor they came from."""
+    n, h, w, c = shape
+    d = columns.reshape(n, h, w, 3, 3, c)
+    padded = np.zeros((n, h + 2, w + 2, c), np.float32)
+    for i in range(3):
+        for j in range(3):
+            padded[:, i:i + h, j:j + w, :] += d[:, :, :, i, j, :]
+    return padded[:, 1:-1, 1:-1, :]
+
+
+class PlateCharNet:
+    """The PlateCharNet of the notebook: three blocks of convolution, batch normalization, ReLU and max pooling,
+    a 128-wide embedding with dropout, and one head for letters and one for digits. Tensors are NHWC internally."""
+
+    CHANNELS = [(1, 16), (16, 32), (32, 64)]
+
+    def __init__(self) -> None:
+        self.p = {}
+        for k, (ci, co) in enumerate(self.CHANNELS):
+            bound = np.sqrt(6.0 / (9 * ci))
+            self.p[f"w{k}"] = np.random.uniform(-bound, bound, (9 * ci, co)).astype(np.float32)
+            self.p[f"g{k}"] = np.ones(co, np.float32)
+            self.p[f"b{k}"] = np.zeros(co, np.float32)
+
+        flat = 64 * (INPUT_SIZE // 8) ** 2
+        for name, (fi, fo) in {"fc": (flat, 128), "letters": (128, len(LETTERS)), "digits": (128, len(DIGITS))}.items():
+            bound = 1 / np.sqrt(fi)
+            self.p[name + "_w"] = np.random.uniform(-bound, bound, (fi, fo)).astype(np.float32)
+            self.p[name + "_b"] = np.random.uniform(-bound, bound, fo).astype(np.float32)
+
+        self.running = {f"m{k}": np.zeros(co, np.float32) for k, (_, co) in enumerate(self.CHANNELS)}
+        self.running.update({f"v{k}": np.ones(co, np.float32) for k, (_, co) in enumerate(self.CHANNELS)})
+
+    def forward(self, x: np.ndarray, train: bool):
+        cache = []
+        for k in range(len(self.CHANNELS)):
+            n, h, w, _ = x.shape
+            columns = im2col(x)
+            z = columns @ self.p[f"w{k}"]
+            if train:
+                mean = z.mean(0)
+                var = z.var(0)
+                self.running[f"m{k}"] = 0.9 * self.running[f"m{k}"] + 0.1 * mean
+                self.running[f"v{k}"] = 0.9 * self.running[f"v{k}"] + 0.1 * var * z.shape[0] / (z.shape[0] - 1)
+            else:
+                mean, var = self.running[f"m{k}"], self.running[f"v{k}"]
+
+            inv = 1 / np.sqrt(var + 1e-5)
+            zhat = (z - mean) * inv
+            y = zhat * self.p[f"g{k}"] + self.p[f"b{k}"]
+            r = np.maximum(y, 0)
+            r = r.reshape(n, h // 2, 2, w // 2, 2, r.shape[1])
+            pooled = r.max(axis=(2, 4))
+            mask = r == pooled[:, :, None, :, None, :]
+            cache.append((x.shape, columns, zhat, inv, y, mask))
+            x = pooled
+
+        flat = x.reshape(x.shape[0], -1)
+        e = flat @ self.p["fc_w"] + self.p["fc_b"]
+        embedding = np.maximum(e, 0)
+        drop = None
+        if train:
+            drop = (np.random.rand(*embedding.shape) >= 0.2).astype(np.float32) / 0.8
+            embedding = embedding * drop
+
+        letters = embedding @ self.p["letters_w"] + self.p["letters_b"]
+        digits = embedding @ self.p["digits_w"] + self.p["digits_b"]
+        return letters, digits, (cache, x.shape, flat, e, embedding, drop)
+
+    def backward(self, dletters: np.ndarray, ddigits: np.ndarray, state) -> dict:
+        cache, pooled_shape, flat, e, embedding, drop = state
+        g = {}
+        g["letters_w"] = embedding.T @ dletters
+        g["letters_b"] = dletters.sum(0)
+        g["digits_w"] = embedding.T @ ddigits
+        g["digits_b"] = ddigits.sum(0)
+
+        dembedding = (dletters @ self.p["letters_w"].T + ddigits @ self.p["digits_w"].T) * drop
+        de = dembedding * (e > 0)
+        g["fc_w"] = flat.T @ de
+        g["fc_b"] = de.sum(0)
+
+        dx = (de @ self.p["fc_w"].T).reshape(pooled_shape)
+        for k in reversed(range(len(self.CHANNELS))):
+            x_shape, columns, zhat, inv, y, mask = cache[k]
+            co = y.shape[1]
+            dy = (mask * dx[:, :, None, :, None, :]).reshape(-1, co) * (y > 0)
+            g[f"g{k}"] = (dy * zhat).sum(0)
+            g[f"b{k}"] = dy.sum(0)
+            dzhat = dy * self.p[f"g{k}"]
+            m = dzhat.shape[0]
+            dz = inv / m * (m * dzhat - dzhat.sum(0) - zhat * (dzhat * zhat).sum(0))
+            g[f"w{k}"] = columns.T @ dz
+            if k > 0:
+                dx = col2im(dz @ self.p[f"w{k}"].T, x_shape)
+        return g
+
+
+def cross_entropy(logits: np.ndarray, labels: np.ndarray) -> Tuple[float, np.ndarray]:
+    """The loss and gradient of nn.CrossEntropyLoss(ignore_index=-100)."""
+    valid = labels >= 0
+    grad = np.zeros_like(logits)
+    if not valid.any():
+        return 0.0, grad
+
+    z = logits[valid]
+    p = np.exp(z - z.max(1, keepdims=True))
+    p /= p.sum(1, keepdims=True)
+    target = labels[valid]
+    loss = -np.log(p[np.arange(len(target)), target] + 1e-12).mean()
+    p[np.arange(len(target)), target] -= 1
+    grad[valid] = p / len(target)
+    return loss, grad
+
+
+def accuracy(letters: np.ndarray, digits: np.ndarray, labels: List[str]) -> float:
+    """Character accuracy, each character read from the head of its type, as CnnBackend does."""
+    correct = 0
+    for i, char in enumerate(labels):
+        if char in DIGITS:
+            correct += DIGITS[digits[i].argmax()] == char
+        else:
+            correct += LETTERS[letters[i].argmax()] == char
+    return correct / max(len(labels), 1)
+
+
+def export(net: PlateCharNet, path: str) -> None:
+    """Writes the graph torch.onnx.export produces for the notebook's model in eval mode, with the batch normalization folded."""
+    nodes, initializers = [], []
+    previous = "chars"
+    for k, (ci, co) in enumerate(PlateCharNet.CHANNELS):
+        scale = net.p[f"g{k}"] / np.sqrt(net.running[f"v{k}"] + 1e-5)
+        weight = net.p[f"w{k}"].reshape(3, 3, ci, co).transpose(3, 2, 0, 1) * scale[:, None, None, None]
+        bias = net.p[f"b{k}"] - net.running[f"m{k}"] * scale
+        initializers += [numpy_helper.from_array(weight.astype(np.float32), f"conv{k}.weight"),
+                         numpy_helper.from_array(bias.astype(np.float32), f"conv{k}.bias")]
+        nodes += [helper.make_node("Conv", [previous, f"conv{k}.weight", f"conv{k}.bias"], [f"conv{k}"], kernel_shape=[3, 3], pads=[1, 1, 1, 1]),
+                  helper.make_node("Relu", [f"conv{k}"], [f"relu{k}"]),
+                  helper.make_node("MaxPool", [f"relu{k}"], [f"pool{k}"], kernel_shape=[2, 2], strides=[2, 2])]
+        previous = f"pool{k}"
+
+    # The embedding was trained on NHWC features, the graph flattens NCHW ones.
+    side = INPUT_SIZE // 8
+    fc = net.p["fc_w"].reshape(side, side, 64, 128).transpose(2, 0, 1, 3).reshape(-1, 128)
+    initializers += [numpy_helper.from_array(fc.astype(np.float32), "embedding.weight"), numpy_helper.from_array(net.p["fc_b"], "embedding.bias")]
+    nodes += [helper.make_node("Flatten", [previous], ["flat"], axis=1),
+              helper.make_node("Gemm", ["flat", "embedding.weight", "embedding.bias"], ["embedding_linear"]),
+              helper.make_node("Relu", ["embedding_linear"], ["embedding"])]
+
+    for head in ["letters", "digits"]:
+        initializers += [numpy_helper.from_array(net.p[head + "_w"], head + ".weight"), numpy_helper.from_array(net.p[head + "_b"], head + ".bias")]
+        nodes.append(helper.make_node("Gemm", ["embedding", head + ".weight", head + ".bias"], [head]))
+
+    graph = helper.make_graph(nodes, "PlateCharNet",
+                              [helper.make_tensor_value_info("chars", TensorProto.FLOAT, ["batch", 1, INPUT_SIZE, INPUT_SIZE])],
+                              [helper.make_tensor_value_info("letters", TensorProto.FLOAT, ["batch", len(LETTERS)]),
+                               helper.make_tensor_value_info("digits", TensorProto.FLOAT, ["batch", len(DIGITS)])], initializers)
+    model = helper.make_model(graph, opset_imports=[helper.make_opsetid("", 17)], producer_name="train_platechars")
+    model.ir_version = 8
+    onnx.checker.check_model(model)
+    onnx.save(model, path)
+
+
+def main() -> None:
+    font = ImageFont.truetype(FONT_PATH, GLYPH_SIZE)
+    glyphs = [render_glyph(char, font) for char in LETTERS + DIGITS]
+
+    val_x, val_labels = load_plate_chars(validation=True)
+    test_x, test_labels = load_plate_chars(validation=False)
+    val_nhwc = val_x.transpose(0, 2, 3, 1)
+    print(f"Validation characters: {len(val_labels)} | Held out characters: {len(test_labels)}", flush=True)
+
+    net = PlateCharNet()
+    first_moment = {k: np.zeros_like(v) for k, v in net.p.items()}
+    second_moment = {k: np.zeros_like(v) for k, v in net.p.items()}
+    step = 0
+    best_accuracy, best_epoch, best_state = -1.0, -1, None
+
+    for epoch in range(EPOCHS):
+        start = time.time()
+
+        # Fresh augmentations every epoch, as the notebook's dataset draws them on the fly.
+        labels = np.repeat(np.arange(len(glyphs)), SAMPLES_PER_CLASS)
+        np.random.shuffle(labels)
+        images = np.stack([prepare_char(augment(glyphs[label])) for label in labels]).astype(np.float32)[..., None] / 255.0
+
+        # AdamW with a cosine annealed learning rate.
+        learning_rate = 0.5 * LEARNING_RATE * (1 + np.cos(np.pi * epoch / EPOCHS))
+        total_loss = 0.0
+        for s in range(0, len(labels), BATCH_SIZE):
+            batch = labels[s:s + BATCH_SIZE]
+            letter = np.where(batch < len(LETTERS), batch, -100)
+            digit = np.where(batch >= len(LETTERS), batch - len(LETTERS), -100)
+
+            letters, digits, state = net.forward(images[s:s + BATCH_SIZE], True)
+            letters_loss, dletters = cross_entropy(letters, letter)
+            digits_loss, ddigits = cross_entropy(digits, digit)
+            grads = net.backward(dletters, ddigits, state)
+
+            step += 1
+            for k in net.p:
+                net.p[k] *= (1 - learning_rate * WEIGHT_DECAY)
+                first_moment[k] = 0.9 * first_moment[k] + 0.1 * grads[k]
+                second_moment[k] = 0.999 * second_moment[k] + 0.001 * grads[k] ** 2
+                corrected_first = first_moment[k] / (1 - 0.9 ** step)
+                corrected_second = second_moment[k] / (1 - 0.999 ** step)
+                net.p[k] -= (learning_rate * corrected_first / (np.sqrt(corrected_second) + 1e-8)).astype(np.float32)
+
+            total_loss += (letters_loss + digits_loss) * len(batch)
+
+        letters, digits, _ = net.forward(val_nhwc, False)
+        val_accuracy = accuracy(letters, digits, val_labels)
+        print(f"Epoch {epoch + 1}/{EPOCHS} | Training loss: {total_loss / len(labels):.4f} | "
+              f"Validation character accuracy: {val_accuracy:.4f} | {time.time() - start:.0f} s", flush=True)
+
+        if val_accuracy > best_accuracy:
+            best_accuracy, best_epoch = val_accuracy, epoch + 1
+            best_state = ({k: v.copy() for k, v in net.p.items()}, {k: v.copy() for k, v in net.running.items()})
+
+    net.p, net.running = best_state
+    export(net, ONNX_PATH)
+    print(f"Best validation character accuracy: {best_accuracy:.4f}; best epoch: {best_epoch}.")
+
+    # The held out plates are read once, by the exported model through OpenCV as in the application.
+    dnn = cv2.dnn.readNetFromONNX(ONNX_PATH)
+    dnn.setInput(test_x)
+    letters, digits = dnn.forward(["letters", "digits"])
+    numpy_letters, numpy_digits, _ = net.forward(test_x.transpose(0, 2, 3, 1), False)
+    print(f"Held out character accuracy: {accuracy(letters, digits, test_labels):.4f}")
+    print("Letters match:", np.array_equal(letters.argmax(1), numpy_letters.argmax(1)))
+    print("Digits match:", np.array_equal(digits.argmax(1), numpy_digits.argmax(1)))
+
+
+if __name__ == "__main__":
+    main()